@@ -0,0 +1,222 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef EXAMPLES_BENCHMARK_BENCHMARK_H__INCLUDED
+#define EXAMPLES_BENCHMARK_BENCHMARK_H__INCLUDED
+
+#include <tiled_array.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+
+/// Benchmark case interface
+
+/// A benchmark case is set up before each repetition, and only \c run() is
+/// timed. All processes call \c setup() and \c run() collectively.
+class Benchmark {
+public:
+  virtual ~Benchmark() { }
+
+  /// The benchmark name, which is used as the key for baseline comparison
+  virtual std::string name() const = 0;
+
+  /// Prepare the data for the next repetition (not timed)
+  virtual void setup() { }
+
+  /// Run the benchmark (timed)
+  virtual void run() = 0;
+
+  /// The number of floating point operations done by \c run()
+  virtual double flops() const { return 0.0; }
+}; // class Benchmark
+
+/// Timing statistics for a benchmark
+struct BenchmarkResult {
+  std::string name; ///< The benchmark name
+  std::size_t reps; ///< Number of timed repetitions
+  double min; ///< Minimum wall time (seconds)
+  double max; ///< Maximum wall time (seconds)
+  double mean; ///< Mean wall time (seconds)
+  double median; ///< Median wall time (seconds)
+  double stddev; ///< Sample standard deviation of the wall time (seconds)
+  double gflops; ///< GFLOPS computed from the median wall time
+
+  /// Compute statistics from a list of timings
+  BenchmarkResult(const std::string& n, std::vector<double> times, const double flops) :
+      name(n), reps(times.size()), min(0.0), max(0.0), mean(0.0), median(0.0),
+      stddev(0.0), gflops(0.0)
+  {
+    if(times.empty())
+      return;
+
+    std::sort(times.begin(), times.end());
+    min = times.front();
+    max = times.back();
+    const std::size_t mid = times.size() / 2;
+    median = ((times.size() % 2) ? times[mid] : 0.5 * (times[mid - 1] + times[mid]));
+
+    for(std::vector<double>::const_iterator it = times.begin(); it != times.end(); ++it)
+      mean += *it;
+    mean /= double(times.size());
+
+    if(times.size() > 1ul) {
+      for(std::vector<double>::const_iterator it = times.begin(); it != times.end(); ++it)
+        stddev += (*it - mean) * (*it - mean);
+      stddev = std::sqrt(stddev / double(times.size() - 1ul));
+    }
+
+    if((flops > 0.0) && (median > 0.0))
+      gflops = flops / median / 1.0e9;
+  }
+}; // struct BenchmarkResult
+
+/// Run benchmarks and collect results
+class BenchmarkRunner {
+public:
+  BenchmarkRunner(madness::World& world, const std::size_t warmup, const std::size_t reps,
+      const std::string& filter) :
+      world_(world), warmup_(warmup), reps_(reps), filter_(filter), results_()
+  { }
+
+  /// Run benchmark \c b if its name matches the filter
+
+  /// \param b The benchmark to run
+  void run(Benchmark& b) {
+    const std::string name = b.name();
+    if((! filter_.empty()) && (name.find(filter_) == std::string::npos))
+      return;
+
+    for(std::size_t i = 0ul; i < warmup_; ++i) {
+      b.setup();
+      world_.gop.fence();
+      b.run();
+      world_.gop.fence();
+    }
+
+    std::vector<double> times;
+    times.reserve(reps_);
+    for(std::size_t i = 0ul; i < reps_; ++i) {
+      b.setup();
+      world_.gop.fence();
+      const double start = madness::wall_time();
+      b.run();
+      world_.gop.fence();
+      double time = madness::wall_time() - start;
+
+      // Use the slowest process time
+      world_.gop.max(time);
+      times.push_back(time);
+    }
+
+    results_.push_back(BenchmarkResult(name, times, b.flops()));
+
+    if(world_.rank() == 0) {
+      const BenchmarkResult& r = results_.back();
+      std::cout << name << ": median=" << r.median << " s, min=" << r.min
+          << " s, stddev=" << r.stddev << " s";
+      if(r.gflops > 0.0)
+        std::cout << ", " << r.gflops << " GFLOPS";
+      std::cout << "\n";
+    }
+  }
+
+  /// Benchmark results accessor
+  const std::vector<BenchmarkResult>& results() const { return results_; }
+
+  /// Write results as CSV
+  void write_csv(std::ostream& os) const {
+    os << "name,reps,min,max,mean,median,stddev,gflops\n";
+    for(std::vector<BenchmarkResult>::const_iterator it = results_.begin(); it != results_.end(); ++it)
+      os << it->name << "," << it->reps << "," << it->min << "," << it->max << ","
+          << it->mean << "," << it->median << "," << it->stddev << "," << it->gflops << "\n";
+  }
+
+  /// Write results as JSON
+  void write_json(std::ostream& os) const {
+    os << "{\n  \"nodes\": " << world_.size()
+        << ",\n  \"threads\": " << (madness::ThreadPool::size() + 1)
+        << ",\n  \"warmup\": " << warmup_
+        << ",\n  \"benchmarks\": [";
+    const char* separator = "\n";
+    for(std::vector<BenchmarkResult>::const_iterator it = results_.begin(); it != results_.end(); ++it) {
+      os << separator << "    { \"name\": \"" << it->name << "\", \"reps\": " << it->reps
+          << ", \"min\": " << it->min << ", \"max\": " << it->max
+          << ", \"mean\": " << it->mean << ", \"median\": " << it->median
+          << ", \"stddev\": " << it->stddev << ", \"gflops\": " << it->gflops << " }";
+      separator = ",\n";
+    }
+    os << "\n  ]\n}\n";
+  }
+
+  /// Compare the results with a baseline CSV file
+
+  /// A benchmark regresses when its median time is greater than the baseline
+  /// median by more than \c tolerance (relative).
+  /// \param is The baseline CSV input stream, as written by \c write_csv()
+  /// \param tolerance The relative tolerance
+  /// \param os The report output stream
+  /// \return The number of benchmarks that regressed
+  std::size_t compare(std::istream& is, const double tolerance, std::ostream& os) const {
+    // Read the baseline median times
+    std::map<std::string, double> baseline;
+    std::string line;
+    std::getline(is, line); // Skip the header
+    while(std::getline(is, line)) {
+      std::vector<std::string> fields;
+      std::stringstream ss(line);
+      std::string field;
+      while(std::getline(ss, field, ','))
+        fields.push_back(field);
+      if(fields.size() >= 6ul)
+        baseline[fields[0]] = atof(fields[5].c_str());
+    }
+
+    std::size_t regressions = 0ul;
+    for(std::vector<BenchmarkResult>::const_iterator it = results_.begin(); it != results_.end(); ++it) {
+      std::map<std::string, double>::const_iterator base = baseline.find(it->name);
+      if(base == baseline.end()) {
+        os << it->name << ": no baseline\n";
+        continue;
+      }
+
+      const double ratio = it->median / base->second;
+      const bool regressed = ratio > (1.0 + tolerance);
+      if(regressed)
+        ++regressions;
+      os << it->name << ": baseline=" << base->second << " s, current=" << it->median
+          << " s, ratio=" << ratio << (regressed ? "  REGRESSION" : "") << "\n";
+    }
+
+    return regressions;
+  }
+
+private:
+  madness::World& world_; ///< The world where benchmarks are run
+  const std::size_t warmup_; ///< Number of untimed repetitions
+  const std::size_t reps_; ///< Number of timed repetitions
+  const std::string filter_; ///< Only benchmarks that contain this string are run
+  std::vector<BenchmarkResult> results_; ///< Benchmark results
+}; // class BenchmarkRunner
+
+#endif // EXAMPLES_BENCHMARK_BENCHMARK_H__INCLUDED
@@ -0,0 +1,348 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "benchmark.h"
+
+typedef TiledArray::Array<double, 2> Matrix;
+typedef Matrix::value_type Tile;
+
+/// Construct a tile range object for a square matrix
+TiledArray::TiledRange make_trange(const std::size_t matrix_size, const std::size_t block_size) {
+  std::vector<std::size_t> blocking;
+  for(std::size_t i = 0; i < matrix_size; i += block_size)
+    blocking.push_back(i);
+  blocking.push_back(matrix_size);
+
+  const std::vector<TiledArray::TiledRange1> blocking2(2,
+      TiledArray::TiledRange1(blocking.begin(), blocking.end()));
+
+  return TiledArray::TiledRange(blocking2.begin(), blocking2.end());
+}
+
+/// Construct a band-diagonal sparse matrix
+Matrix make_band_matrix(madness::World& world, const TiledArray::TiledRange& trange,
+    const std::size_t band)
+{
+  const std::size_t n = trange.tiles().size()[0];
+  std::vector<std::size_t> tiles;
+  for(std::size_t i = 0ul; i < n; ++i)
+    for(std::size_t j = (i > band ? i - band : 0ul); j < std::min(n, i + band + 1ul); ++j)
+      tiles.push_back(i * n + j);
+
+  Matrix result(world, trange, tiles.begin(), tiles.end());
+  result.set_all_local(1.0);
+  return result;
+}
+
+/// Make a benchmark name with its parameters
+std::string make_name(const std::string& name, const std::size_t size, const std::size_t block) {
+  std::stringstream ss;
+  ss << name << "/" << size << "/" << block;
+  return ss.str();
+}
+
+/// Local tile benchmark base class
+class TileBenchmark : public Benchmark {
+protected:
+  const std::size_t block_;
+  Tile a_;
+  Tile b_;
+  Tile c_;
+
+public:
+  TileBenchmark(const std::size_t block) :
+      block_(block),
+      a_(TiledArray::Range(std::vector<std::size_t>(2, 0), std::vector<std::size_t>(2, block)), 1.0),
+      b_(a_.range(), 2.0), c_(a_.range(), 0.0)
+  { }
+}; // class TileBenchmark
+
+class TilePermute : public TileBenchmark {
+public:
+  TilePermute(const std::size_t block) : TileBenchmark(block) { }
+  std::string name() const { return make_name("tile_permute", block_, block_); }
+  void run() { TiledArray::math::permute(c_, TiledArray::Permutation(1,0), a_); }
+}; // class TilePermute
+
+class TileAdd : public TileBenchmark {
+public:
+  TileAdd(const std::size_t block) : TileBenchmark(block) { }
+  std::string name() const { return make_name("tile_add", block_, block_); }
+  void run() { c_ = a_ + b_; }
+  double flops() const { return double(block_ * block_); }
+}; // class TileAdd
+
+class TileScale : public TileBenchmark {
+public:
+  TileScale(const std::size_t block) : TileBenchmark(block) { }
+  std::string name() const { return make_name("tile_scale", block_, block_); }
+  void run() { a_ *= 1.0000001; }
+  double flops() const { return double(block_ * block_); }
+}; // class TileScale
+
+class TileGemm : public TileBenchmark {
+public:
+  TileGemm(const std::size_t block) : TileBenchmark(block) { }
+  std::string name() const { return make_name("tile_gemm", block_, block_); }
+  void run() {
+    TiledArray::math::gemm(block_, block_, block_, 1.0, a_.data(), b_.data(), c_.data());
+  }
+  double flops() const { return 2.0 * double(block_ * block_ * block_); }
+}; // class TileGemm
+
+/// Distributed array benchmark base class
+class ArrayBenchmark : public Benchmark {
+protected:
+  madness::World& world_;
+  const std::size_t size_;
+  const std::size_t block_;
+  Matrix a_;
+  Matrix b_;
+  Matrix c_;
+
+public:
+  ArrayBenchmark(madness::World& world, const std::size_t size, const std::size_t block) :
+      world_(world), size_(size), block_(block),
+      a_(world, make_trange(size, block)), b_(world, a_.trange()), c_(world, a_.trange())
+  {
+    a_.set_all_local(1.0);
+    b_.set_all_local(1.0);
+  }
+}; // class ArrayBenchmark
+
+class SummaContraction : public ArrayBenchmark {
+public:
+  SummaContraction(madness::World& world, const std::size_t size, const std::size_t block) :
+      ArrayBenchmark(world, size, block)
+  { }
+  std::string name() const { return make_name("summa", size_, block_); }
+  void run() { c_("m,n") = a_("m,k") * b_("k,n"); }
+  double flops() const { return 2.0 * double(size_ * size_ * size_); }
+}; // class SummaContraction
+
+class VSpGemmContraction : public ArrayBenchmark {
+  const std::size_t band_;
+  Matrix sa_;
+  Matrix sb_;
+
+public:
+  VSpGemmContraction(madness::World& world, const std::size_t size, const std::size_t block,
+      const std::size_t band) :
+      ArrayBenchmark(world, size, block), band_(band),
+      sa_(make_band_matrix(world, a_.trange(), band)),
+      sb_(make_band_matrix(world, a_.trange(), band))
+  { }
+  std::string name() const { return make_name("vspgemm_band", size_, block_); }
+  void run() { c_("m,n") = sa_("m,k") * sb_("k,n"); }
+  double flops() const {
+    // Count the non-zero tile products of the band matrices
+    const std::size_t n = size_ / block_;
+    double count = 0.0;
+    for(std::size_t i = 0ul; i < n; ++i)
+      for(std::size_t k = (i > band_ ? i - band_ : 0ul); k < std::min(n, i + band_ + 1ul); ++k)
+        count += double(std::min(n, k + band_ + 1ul) - (k > band_ ? k - band_ : 0ul));
+    return 2.0 * count * double(block_ * block_ * block_);
+  }
+}; // class VSpGemmContraction
+
+class ArrayAdd : public ArrayBenchmark {
+public:
+  ArrayAdd(madness::World& world, const std::size_t size, const std::size_t block) :
+      ArrayBenchmark(world, size, block)
+  { }
+  std::string name() const { return make_name("array_add", size_, block_); }
+  void run() { c_("m,n") = a_("m,n") + b_("n,m"); }
+  double flops() const { return double(size_ * size_); }
+}; // class ArrayAdd
+
+class ArrayDot : public ArrayBenchmark {
+public:
+  ArrayDot(madness::World& world, const std::size_t size, const std::size_t block) :
+      ArrayBenchmark(world, size, block)
+  { }
+  std::string name() const { return make_name("dot", size_, block_); }
+  void run() { TiledArray::expressions::dot(a_("m,n"), b_("m,n")); }
+  double flops() const { return 2.0 * double(size_ * size_); }
+}; // class ArrayDot
+
+class ArrayNorm2 : public ArrayBenchmark {
+public:
+  ArrayNorm2(madness::World& world, const std::size_t size, const std::size_t block) :
+      ArrayBenchmark(world, size, block)
+  { }
+  std::string name() const { return make_name("norm2", size_, block_); }
+  void run() { TiledArray::expressions::norm2(a_("m,n")); }
+  double flops() const { return 2.0 * double(size_ * size_); }
+}; // class ArrayNorm2
+
+class Replicate : public ArrayBenchmark {
+public:
+  Replicate(madness::World& world, const std::size_t size, const std::size_t block) :
+      ArrayBenchmark(world, size, block)
+  { }
+  std::string name() const { return make_name("replicate", size_, block_); }
+  void setup() {
+    c_ = Matrix(world_, a_.trange());
+    c_.set_all_local(1.0);
+  }
+  void run() { c_.make_replicated(); }
+}; // class Replicate
+
+class ShapeAlgebra : public Benchmark {
+  const std::size_t size_;
+  TiledArray::detail::Bitset<> a_;
+  TiledArray::detail::Bitset<> b_;
+
+public:
+  ShapeAlgebra(const std::size_t size) : size_(size), a_(size), b_(size) {
+    for(std::size_t i = 0ul; i < size; i += 3ul)
+      a_.set(i);
+    for(std::size_t i = 0ul; i < size; i += 5ul)
+      b_.set(i);
+  }
+  std::string name() const { return make_name("shape_algebra", size_, 1ul); }
+  void run() {
+    for(int i = 0; i < 100; ++i) {
+      TiledArray::detail::Bitset<> c = a_ | b_;
+      c &= a_;
+    }
+  }
+}; // class ShapeAlgebra
+
+/// Parse a list of comma separated sizes
+std::vector<std::size_t> parse_list(const std::string& str) {
+  std::vector<std::size_t> result;
+  std::stringstream ss(str);
+  std::string field;
+  while(std::getline(ss, field, ','))
+    result.push_back(atol(field.c_str()));
+  return result;
+}
+
+int main(int argc, char** argv) {
+  // Initialize runtime
+  madness::World& world = madness::initialize(argc, argv);
+  TiledArray::initialize(world);
+
+  // Default options
+  std::vector<std::size_t> sizes(1, 2048ul);
+  std::size_t block_size = 128ul;
+  std::size_t band = 2ul;
+  std::size_t warmup = 1ul;
+  std::size_t reps = 5ul;
+  double tolerance = 0.1;
+  std::string filter, json, csv, baseline;
+
+  // Parse command line options
+  for(int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    const std::size_t eq = arg.find('=');
+    const std::string key = arg.substr(0, eq);
+    const std::string value = (eq == std::string::npos ? std::string() : arg.substr(eq + 1));
+    if(key == "--sizes") sizes = parse_list(value);
+    else if(key == "--block") block_size = atol(value.c_str());
+    else if(key == "--band") band = atol(value.c_str());
+    else if(key == "--warmup") warmup = atol(value.c_str());
+    else if(key == "--reps") reps = atol(value.c_str());
+    else if(key == "--filter") filter = value;
+    else if(key == "--json") json = value;
+    else if(key == "--csv") csv = value;
+    else if(key == "--baseline") baseline = value;
+    else if(key == "--tolerance") tolerance = atof(value.c_str());
+    else {
+      if(world.rank() == 0)
+        std::cout << "Usage: ta_benchmark [--sizes=n1,n2,...] [--block=b] [--band=w]\n"
+                  << "           [--warmup=n] [--reps=n] [--filter=substring]\n"
+                  << "           [--json=file] [--csv=file] [--baseline=file.csv] [--tolerance=t]\n";
+      madness::finalize();
+      return (key == "--help" ? 0 : 1);
+    }
+  }
+
+  if((block_size == 0ul) || (reps == 0ul)) {
+    std::cerr << "Error: block size and repetitions must be greater than zero.\n";
+    madness::finalize();
+    return 1;
+  }
+
+  BenchmarkRunner runner(world, warmup, reps, filter);
+
+  // Tile kernels
+  {
+    TilePermute permute(block_size);
+    runner.run(permute);
+    TileAdd add(block_size);
+    runner.run(add);
+    TileScale scale(block_size);
+    runner.run(scale);
+    TileGemm gemm(block_size);
+    runner.run(gemm);
+  }
+
+  // Distributed operations, scaled over matrix sizes
+  for(std::vector<std::size_t>::const_iterator it = sizes.begin(); it != sizes.end(); ++it) {
+    if((*it % block_size) != 0ul) {
+      if(world.rank() == 0)
+        std::cerr << "Skipping size " << *it << ": not divisible by the block size.\n";
+      continue;
+    }
+
+    SummaContraction summa(world, *it, block_size);
+    runner.run(summa);
+    VSpGemmContraction vspgemm(world, *it, block_size, band);
+    runner.run(vspgemm);
+    ArrayAdd add(world, *it, block_size);
+    runner.run(add);
+    ArrayDot dot(world, *it, block_size);
+    runner.run(dot);
+    ArrayNorm2 norm(world, *it, block_size);
+    runner.run(norm);
+    Replicate replicate(world, *it, block_size);
+    runner.run(replicate);
+    ShapeAlgebra shape((*it / block_size) * (*it / block_size));
+    runner.run(shape);
+  }
+
+  int status = 0;
+  if(world.rank() == 0) {
+    if(! json.empty()) {
+      std::ofstream file(json.c_str());
+      runner.write_json(file);
+    }
+    if(! csv.empty()) {
+      std::ofstream file(csv.c_str());
+      runner.write_csv(file);
+    }
+    if(! baseline.empty()) {
+      std::ifstream file(baseline.c_str());
+      if(file.good()) {
+        const std::size_t regressions = runner.compare(file, tolerance, std::cout);
+        std::cout << regressions << " regression(s) with tolerance " << tolerance << "\n";
+        status = (regressions ? 2 : 0);
+      } else {
+        std::cerr << "Error: unable to open baseline file " << baseline << "\n";
+        status = 1;
+      }
+    }
+  }
+  world.gop.broadcast(status, 0);
+
+  madness::finalize();
+  return status;
+}
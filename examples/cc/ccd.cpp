@@ -27,6 +27,7 @@ using namespace TiledArray::expressions;
 int main(int argc, char** argv) {
   // Initialize runtime
   madness::World& world = madness::initialize(argc, argv);
+  TiledArray::initialize(world);
 
   std::string file_name = argv[1];
 
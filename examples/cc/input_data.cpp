@@ -23,20 +23,8 @@
 
 TiledArray::TiledRange1
 InputData::make_trange1(const obs_mosym::const_iterator& begin, obs_mosym::const_iterator first, obs_mosym::const_iterator last) {
-  std::vector<std::size_t> tiles;
-  obs_mosym::value_type current = *first;
-  tiles.push_back(std::distance(begin, first));
-
-  for(; first != last; ++first) {
-    if(*first != current) {
-      tiles.push_back(std::distance(begin, first));
-      current = *first;
-    }
-  }
-
-  tiles.push_back(std::distance(begin, first));
-
-  return TiledArray::TiledRange1(tiles.begin(), tiles.end());
+  return TiledArray::LabeledTiledRange1::make_blocked(first, last,
+      std::distance(begin, first)).trange1();
 }
 
 TiledArray::TiledRange
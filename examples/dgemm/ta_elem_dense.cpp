@@ -23,6 +23,7 @@
 int main(int argc, char** argv) {
   // Initialize runtime
   madness::World& world = madness::initialize(argc, argv);
+  TiledArray::initialize(world);
   elem::Grid grid(elem::DefaultGrid().Comm());
 
   // Get command line arguments
@@ -24,6 +24,7 @@
 int main(int argc, char** argv) {
   // Initialize runtime
   madness::World& world = madness::initialize(argc, argv);
+  TiledArray::initialize(world);
 
   // Get command line arguments
   if(argc < 2) {
@@ -53,6 +53,7 @@ void print_local(madness::World& world, const std::shared_ptr<TiledArray::Pmap>&
 
 int main(int argc, char** argv) {
   madness::World& world = madness::initialize(argc,argv);
+  TiledArray::initialize(world);
 
   std::size_t m = 20;
   std::size_t n = 10;
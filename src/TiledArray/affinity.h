@@ -0,0 +1,497 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEDARRAY_AFFINITY_H__INCLUDED
+#define TILEDARRAY_AFFINITY_H__INCLUDED
+
+#include <TiledArray/error.h>
+#include <TiledArray/madness.h>
+#include <TiledArray/eigen3.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <type_traits>
+
+#ifdef TILEDARRAY_ENABLE_NUMA_AFFINITY
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif // TILEDARRAY_ENABLE_NUMA_AFFINITY
+
+namespace TiledArray {
+  namespace detail {
+
+    /// NUMA topology of this host
+
+    /// The topology is read from \c /sys/devices/system/node when TiledArray
+    /// is configured with \c TILEDARRAY_ENABLE_NUMA_AFFINITY ; otherwise, the
+    /// host is treated as a single NUMA node.
+    class NumaTopology {
+    private:
+      std::vector<int> cpu_node_; ///< The NUMA node of each cpu
+      int nodes_; ///< The number of NUMA nodes
+
+      NumaTopology() : cpu_node_(), nodes_(1) {
+#ifdef TILEDARRAY_ENABLE_NUMA_AFFINITY
+        for(int node = 0; ; ++node) {
+          std::stringstream filename;
+          filename << "/sys/devices/system/node/node" << node << "/cpulist";
+          std::ifstream file(filename.str().c_str());
+          if(! file.good())
+            break;
+
+          // Parse a cpu list, e.g. "0-3,8-11"
+          std::string list;
+          std::getline(file, list);
+          std::stringstream ss(list);
+          std::string range;
+          while(std::getline(ss, range, ',')) {
+            int first = 0, last = 0;
+            const std::size_t dash = range.find('-');
+            std::stringstream(range.substr(0, dash)) >> first;
+            if(dash == std::string::npos)
+              last = first;
+            else
+              std::stringstream(range.substr(dash + 1)) >> last;
+            if(last >= int(cpu_node_.size()))
+              cpu_node_.resize(last + 1, 0);
+            for(int cpu = first; cpu <= last; ++cpu)
+              cpu_node_[cpu] = node;
+          }
+
+          nodes_ = node + 1;
+        }
+#endif // TILEDARRAY_ENABLE_NUMA_AFFINITY
+      }
+
+      // Not allowed
+      NumaTopology(const NumaTopology&);
+      NumaTopology& operator=(const NumaTopology&);
+
+    public:
+
+      /// Topology accessor
+
+      /// \return The NUMA topology of this host
+      static const NumaTopology& instance() {
+        static const NumaTopology topology;
+        return topology;
+      }
+
+      /// The number of NUMA nodes
+      int nodes() const { return nodes_; }
+
+      /// The NUMA node of the calling thread
+
+      /// \return The NUMA node of the cpu that is running the calling thread
+      int current_node() const {
+#ifdef TILEDARRAY_ENABLE_NUMA_AFFINITY
+        const int cpu = sched_getcpu();
+        if((cpu >= 0) && (cpu < int(cpu_node_.size())))
+          return cpu_node_[cpu];
+#endif // TILEDARRAY_ENABLE_NUMA_AFFINITY
+        return 0;
+      }
+
+      /// The NUMA node that holds a memory location
+
+      /// \param ptr A pointer to memory
+      /// \return The NUMA node that holds the page of \c ptr , or -1 if it
+      /// is not known
+      int node_of(const void* ptr) const {
+#if defined(TILEDARRAY_ENABLE_NUMA_AFFINITY) && defined(SYS_get_mempolicy)
+        if(ptr && (nodes_ > 1)) {
+          // get_mempolicy(&node, NULL, 0, ptr, MPOL_F_NODE | MPOL_F_ADDR)
+          int node = -1;
+          if(syscall(SYS_get_mempolicy, & node, NULL, 0ul, const_cast<void*>(ptr), 3ul) == 0)
+            return node;
+        }
+#endif // TILEDARRAY_ENABLE_NUMA_AFFINITY
+        return (ptr ? 0 : -1);
+      }
+
+    }; // class NumaTopology
+
+    /// NUMA node where the calling thread allocates tile data
+
+    /// \return A reference to the home node of the calling thread, or -1
+    /// when memory is placed by the operating system, i.e. on the node of the
+    /// thread that first touches it. The home node is always -1 when
+    /// TiledArray is not configured with \c TILEDARRAY_ENABLE_NUMA_AFFINITY .
+    inline int& numa_home() {
+#ifdef TILEDARRAY_ENABLE_NUMA_AFFINITY
+      static __thread int home = -1;
+#else
+      static int home = -1;
+#endif // TILEDARRAY_ENABLE_NUMA_AFFINITY
+      return home;
+    }
+
+    /// Set the NUMA home node of the calling thread for the lifetime of this object
+    class NumaHomeScope {
+    private:
+      const int previous_; ///< The home node before this object was constructed
+
+      // Not allowed
+      NumaHomeScope(const NumaHomeScope&);
+      NumaHomeScope& operator=(const NumaHomeScope&);
+
+    public:
+      /// Constructor
+
+      /// \param node The new home node, or -1 for operating system placement
+      explicit NumaHomeScope(const int node) : previous_(numa_home()) {
+#ifdef TILEDARRAY_ENABLE_NUMA_AFFINITY
+        numa_home() = node;
+#endif // TILEDARRAY_ENABLE_NUMA_AFFINITY
+      }
+
+      ~NumaHomeScope() {
+#ifdef TILEDARRAY_ENABLE_NUMA_AFFINITY
+        numa_home() = previous_;
+#endif // TILEDARRAY_ENABLE_NUMA_AFFINITY
+      }
+    }; // class NumaHomeScope
+
+    /// Place a block of memory that has not been touched on a NUMA node
+
+    /// The pages that lie entirely inside the block are given a preferred
+    /// policy for \c node , so they are allocated there when they are first
+    /// touched. Pages that are shared with other blocks are left unchanged.
+    /// \param ptr The first byte of the block
+    /// \param bytes The size of the block
+    /// \param node The NUMA node
+    inline void numa_place(void* ptr, const std::size_t bytes, const int node) {
+#if defined(TILEDARRAY_ENABLE_NUMA_AFFINITY) && defined(SYS_mbind)
+      const std::size_t page = sysconf(_SC_PAGESIZE);
+      const std::size_t first = (reinterpret_cast<std::size_t>(ptr) + page - 1ul) & ~(page - 1ul);
+      const std::size_t last = (reinterpret_cast<std::size_t>(ptr) + bytes) & ~(page - 1ul);
+      if((node >= 0) && (node < NumaTopology::instance().nodes()) && (first < last)) {
+        // mbind(first, last - first, MPOL_PREFERRED, &mask, maxnode, 0)
+        std::vector<unsigned long> mask((node / (8 * sizeof(unsigned long))) + 1ul, 0ul);
+        mask[node / (8 * sizeof(unsigned long))] = 1ul << (node % (8 * sizeof(unsigned long)));
+        syscall(SYS_mbind, first, last - first, 1, & mask.front(),
+            mask.size() * 8ul * sizeof(unsigned long) + 1ul, 0u);
+      }
+#endif // TILEDARRAY_ENABLE_NUMA_AFFINITY
+    }
+
+  } // namespace detail
+
+  /// NUMA-aware tile allocator
+
+  /// Memory is allocated like \c Eigen::aligned_allocator , and is placed on
+  /// the NUMA home node of the allocating thread when one is set. Work that
+  /// is queued for the NUMA node of its data runs with that node as its
+  /// home, so the tiles it allocates stay on the same node even when the work
+  /// is stolen by a thread of another node. Use it as the allocator of the
+  /// tile type, e.g. <tt>Array<double, 2, Tensor<double, NumaAllocator<double> > ></tt>.
+  /// Without \c TILEDARRAY_ENABLE_NUMA_AFFINITY it behaves like the default
+  /// allocator.
+  /// \tparam T The value type
+  template <typename T>
+  class NumaAllocator : public Eigen::aligned_allocator<T> {
+  public:
+    typedef Eigen::aligned_allocator<T> base_type; ///< The base allocator type
+    typedef typename base_type::size_type size_type; ///< Size type
+    typedef typename base_type::pointer pointer; ///< Pointer type
+
+    template <typename U>
+    struct rebind {
+      typedef NumaAllocator<U> other;
+    };
+
+    NumaAllocator() : base_type() { }
+
+    NumaAllocator(const NumaAllocator& other) : base_type(other) { }
+
+    template <typename U>
+    NumaAllocator(const NumaAllocator<U>& other) : base_type(other) { }
+
+    ~NumaAllocator() { }
+
+    /// Allocate memory for \c n elements
+
+    /// \param n The number of elements
+    /// \param hint Ignored
+    /// \return A pointer to the allocated memory
+    pointer allocate(size_type n, const void* hint = 0) {
+      pointer p = base_type::allocate(n, hint);
+      detail::numa_place(p, n * sizeof(T), detail::numa_home());
+      return p;
+    }
+  }; // class NumaAllocator
+
+  namespace detail {
+
+    /// Work item that is run by the affinity queue
+    class AffinityWork {
+    public:
+      virtual ~AffinityWork() { }
+
+      /// Do the work
+      virtual void run() = 0;
+    }; // class AffinityWork
+
+    /// Work item for a member function call with two arguments
+    template <typename Obj, typename A1, typename A2>
+    class AffinityMemFunWork2 : public AffinityWork {
+    private:
+      typedef void (Obj::*fn_type)(A1, A2);
+      Obj* obj_;
+      fn_type fn_;
+      typename std::decay<A1>::type a1_;
+      typename std::decay<A2>::type a2_;
+
+    public:
+      AffinityMemFunWork2(Obj* obj, fn_type fn, const A1& a1, const A2& a2) :
+        obj_(obj), fn_(fn), a1_(a1), a2_(a2)
+      { }
+
+      virtual ~AffinityMemFunWork2() { }
+
+      virtual void run() { (obj_->*fn_)(a1_, a2_); }
+    }; // class AffinityMemFunWork2
+
+    /// Work item for a member function call with three arguments
+    template <typename Obj, typename A1, typename A2, typename A3>
+    class AffinityMemFunWork3 : public AffinityWork {
+    private:
+      typedef void (Obj::*fn_type)(A1, A2, A3);
+      Obj* obj_;
+      fn_type fn_;
+      typename std::decay<A1>::type a1_;
+      typename std::decay<A2>::type a2_;
+      typename std::decay<A3>::type a3_;
+
+    public:
+      AffinityMemFunWork3(Obj* obj, fn_type fn, const A1& a1, const A2& a2, const A3& a3) :
+        obj_(obj), fn_(fn), a1_(a1), a2_(a2), a3_(a3)
+      { }
+
+      virtual ~AffinityMemFunWork3() { }
+
+      virtual void run() { (obj_->*fn_)(a1_, a2_, a3_); }
+    }; // class AffinityMemFunWork3
+
+    /// NUMA node aware work queue
+
+    /// Work is stored in one queue per NUMA node. For each work item, a
+    /// drain task is submitted to the MADNESS task queue. A thread that runs
+    /// a drain task takes work from the queue of its own NUMA node. When that
+    /// queue is empty, the drain task is submitted again, so a thread of the
+    /// node that holds the work has a chance to run it, and only after
+    /// \c max_requeue attempts does the thread steal from the other queues.
+    /// Since there is exactly one drain task per work item, all work is
+    /// eventually run. Work runs with the NUMA node of its queue as the home
+    /// of the thread, so tiles allocated with \c NumaAllocator are placed
+    /// there.
+    /// \note The node of a thread is only stable when the MADNESS threads are
+    /// bound to cpus, e.g. with the \c MAD_BIND environment variable;
+    /// otherwise, the placement of work is a best effort.
+    class AffinityQueue {
+    private:
+
+      /// Work queue of a single NUMA node
+      struct NodeQueue {
+        NodeQueue() : lock(), work() { }
+
+        madness::Spinlock lock; ///< Queue lock
+        std::deque<AffinityWork*> work; ///< Pending work
+      }; // struct NodeQueue
+
+      /// Task that runs one work item
+      class DrainTask : public madness::TaskInterface {
+      private:
+        AffinityQueue& queue_; ///< The queue that holds the work
+        madness::World& world_; ///< The world that runs the task
+        const unsigned int attempts_; ///< The number of times this task was submitted again
+
+      public:
+        DrainTask(AffinityQueue& queue, madness::World& world, const unsigned int attempts) :
+          madness::TaskInterface(0, madness::TaskAttributes()), queue_(queue),
+          world_(world), attempts_(attempts)
+        { }
+
+        virtual ~DrainTask() { }
+
+        virtual void run(const madness::TaskThreadEnv&) { queue_.run_one(world_, attempts_); }
+      }; // class DrainTask
+
+      std::vector<NodeQueue*> queues_; ///< Work queues for each NUMA node
+
+      AffinityQueue() : queues_() {
+        const int nodes = NumaTopology::instance().nodes();
+        for(int node = 0; node < nodes; ++node)
+          queues_.push_back(new NodeQueue());
+      }
+
+      ~AffinityQueue() {
+        for(std::vector<NodeQueue*>::iterator it = queues_.begin(); it != queues_.end(); ++it)
+          delete *it;
+      }
+
+      // Not allowed
+      AffinityQueue(const AffinityQueue&);
+      AffinityQueue& operator=(const AffinityQueue&);
+
+      /// Take work from the queue of \c node
+
+      /// \return A work item, or \c NULL if the queue is empty
+      AffinityWork* pop(const int node) {
+        NodeQueue& queue = *queues_[node];
+        madness::ScopedMutex<madness::Spinlock> locker(& queue.lock);
+        if(queue.work.empty())
+          return NULL;
+        AffinityWork* work = queue.work.front();
+        queue.work.pop_front();
+        return work;
+      }
+
+    public:
+
+      /// Queue accessor
+
+      /// \return The process local affinity queue
+      static AffinityQueue& instance() {
+        static AffinityQueue queue;
+        return queue;
+      }
+
+      /// Add work to the queue of a NUMA node
+
+      /// \param world The world that runs the drain task
+      /// \param node The NUMA node where \c work should run
+      /// \param work The work item; it is deleted after it is run
+      void add(madness::World& world, const int node, AffinityWork* work) {
+        TA_ASSERT((node >= 0) && (node < int(queues_.size())));
+        TA_ASSERT(work);
+        {
+          NodeQueue& queue = *queues_[node];
+          madness::ScopedMutex<madness::Spinlock> locker(& queue.lock);
+          queue.work.push_back(work);
+        }
+        world.taskq.add(new DrainTask(*this, world, 0u));
+      }
+
+      /// The number of times a drain task is submitted again before it steals
+      static const unsigned int max_requeue = 4u;
+
+      /// Run one work item of the calling thread's NUMA node
+
+      /// When the queue of the calling thread's node is empty, a new drain
+      /// task is submitted instead, unless it has been submitted
+      /// \c max_requeue times; then work is stolen from another node.
+      /// \param world The world that runs the drain tasks
+      /// \param attempts The number of times the drain task has been
+      /// submitted again
+      void run_one(madness::World& world, const unsigned int attempts = max_requeue) {
+        const int nodes = queues_.size();
+        const int here = NumaTopology::instance().current_node();
+        int node = here;
+        AffinityWork* work = pop(here);
+        if((work == NULL) && (attempts < max_requeue)) {
+          world.taskq.add(new DrainTask(*this, world, attempts + 1u));
+          return;
+        }
+        for(int i = 1; (i < nodes) && (work == NULL); ++i) {
+          node = (here + i) % nodes;
+          work = pop(node);
+        }
+
+        if(work) {
+          NumaHomeScope home(node);
+          work->run();
+          delete work;
+        }
+      }
+
+    }; // class AffinityQueue
+
+    /// Find the NUMA node where work on \c ptr should run
+
+    /// \param ptr A pointer to the data used by the work
+    /// \param[out] node The NUMA node that holds \c ptr
+    /// \return \c true if \c ptr is held by a different NUMA node than the
+    /// calling thread
+    inline bool is_remote_data(const void* ptr, int& node) {
+#ifdef TILEDARRAY_ENABLE_NUMA_AFFINITY
+      const NumaTopology& topology = NumaTopology::instance();
+      if(topology.nodes() > 1) {
+        node = topology.node_of(ptr);
+        return (node >= 0) && (node < topology.nodes()) && (node != topology.current_node());
+      }
+#endif // TILEDARRAY_ENABLE_NUMA_AFFINITY
+      return false;
+    }
+
+    /// Call a member function on the NUMA node that holds \c ptr
+
+    /// If the calling thread is on the NUMA node that holds \c ptr , or
+    /// TiledArray is not configured with \c TILEDARRAY_ENABLE_NUMA_AFFINITY ,
+    /// the function is called immediately; otherwise it is queued for a
+    /// thread on that node.
+    /// \param world The world that runs the work
+    /// \param ptr A pointer to the data used by the function
+    /// \param obj The object
+    /// \param fn The member function
+    /// \param a1 The first argument
+    /// \param a2 The second argument
+    template <typename Obj, typename A1, typename A2>
+    inline void run_near(madness::World& world, const void* ptr, Obj* obj,
+        void (Obj::*fn)(A1, A2), const typename std::decay<A1>::type& a1,
+        const typename std::decay<A2>::type& a2)
+    {
+      int node = 0;
+      if(is_remote_data(ptr, node))
+        AffinityQueue::instance().add(world, node,
+            new AffinityMemFunWork2<Obj, A1, A2>(obj, fn, a1, a2));
+      else
+        (obj->*fn)(a1, a2);
+    }
+
+    /// Call a member function on the NUMA node that holds \c ptr
+
+    /// \param world The world that runs the work
+    /// \param ptr A pointer to the data used by the function
+    /// \param obj The object
+    /// \param fn The member function
+    /// \param a1 The first argument
+    /// \param a2 The second argument
+    /// \param a3 The third argument
+    /// \sa run_near(madness::World&, const void*, Obj*, void (Obj::*)(A1, A2), const A1&, const A2&)
+    template <typename Obj, typename A1, typename A2, typename A3>
+    inline void run_near(madness::World& world, const void* ptr, Obj* obj,
+        void (Obj::*fn)(A1, A2, A3), const typename std::decay<A1>::type& a1,
+        const typename std::decay<A2>::type& a2, const typename std::decay<A3>::type& a3)
+    {
+      int node = 0;
+      if(is_remote_data(ptr, node))
+        AffinityQueue::instance().add(world, node,
+            new AffinityMemFunWork3<Obj, A1, A2, A3>(obj, fn, a1, a2, a3));
+      else
+        (obj->*fn)(a1, a2, a3);
+    }
+
+  } // namespace detail
+} // namespace TiledArray
+
+#endif // TILEDARRAY_AFFINITY_H__INCLUDED
@@ -160,16 +160,17 @@ namespace TiledArray {
         TA_USER_ASSERT(x_.size() == errors_.size(),
                        "DIIS: numbers of guess and error vectors do not match, likely due to a programming error");
 
-        // and compute the most recent elements of B, B(i,j) = <ei|ej>
-        for (unsigned int i=0; i < nvec-1; i++)
-          B_(i,nvec-1) = B_(nvec-1,i) = dot_product(errors_[i], errors_[nvec-1]);
-        B_(nvec-1,nvec-1) = dot_product(errors_[nvec-1], errors_[nvec-1]);
+        // and compute the most recent elements of B, B(i,j) = <ei|ej>, in one pass
+        const std::vector<value_type> b =
+            multi_dot_product(errors_[nvec-1], errors_.begin(), errors_.end());
+        for (unsigned int i=0; i < nvec; i++)
+          B_(i,nvec-1) = B_(nvec-1,i) = b[i];
 
         if (iter == 1) { // the first iteration
           if (not x_extrap_.empty() && do_mixing) {
-            zero(x);
-            axpy(x, (1.0-mixing_fraction), x_[0]);
-            axpy(x, mixing_fraction, x_extrap_[0]);
+            const value_type a[2] = { value_type(1.0-mixing_fraction), mixing_fraction };
+            const D xs[2] = { x_[0], x_extrap_[0] };
+            multi_axpy(x, value_type(0), a, a + 2, xs);
           }
         }
         else if (iter > start && (((iter - start) % ngroup) < ngroupdiis)) { // not the first iteration and need to extrapolate?
@@ -232,19 +233,28 @@ namespace TiledArray {
           --nskip; // undo the last ++ :-(
 
           {
-
-            zero(x);
+            // collect the coefficients and combine all vectors in one pass
+            std::vector<value_type> ax, ae;
+            std::vector<D> xs, es;
             for (unsigned int k=nskip, kk=1; k < nvec; ++k, ++kk) {
               if (not do_mixing || x_extrap_.empty()) {
-                //std::cout << "contrib " << k << " c=" << c[kk] << ":" << std::endl << x_[k] << std::endl;
-                axpy(x, c[kk], x_[k]);
-                if (extrapolate_error)
-                  axpy(error, c[kk], errors_[k]);
+                ax.push_back(c[kk]);
+                xs.push_back(x_[k]);
+                if (extrapolate_error) {
+                  ae.push_back(c[kk]);
+                  es.push_back(errors_[k]);
+                }
               } else {
-                axpy(x, c[kk] * (1.0 - mixing_fraction), x_[k]);
-                axpy(x, c[kk] * mixing_fraction, x_extrap_[k]);
+                ax.push_back(c[kk] * (1.0 - mixing_fraction));
+                xs.push_back(x_[k]);
+                ax.push_back(c[kk] * mixing_fraction);
+                xs.push_back(x_extrap_[k]);
               }
             }
+
+            multi_axpy(x, value_type(0), ax.begin(), ax.end(), xs.begin());
+            if (not es.empty())
+              multi_axpy(error, value_type(1), ae.begin(), ae.end(), es.begin());
           }
         } // do DIIS
 
@@ -27,7 +27,10 @@
 #define TILEDARRAY_ALGEBRA_UTILS_H__INCLUDED
 
 #include <sstream>
+#include <vector>
+#include <iterator>
 #include <TiledArray/array.h>
+#include <TiledArray/math/math.h>
 
 namespace TiledArray {
 
@@ -41,6 +44,207 @@ namespace TiledArray {
       return oss.str();
     }
 
+    /// Task that computes the dot products of a list of tile pairs
+
+    /// The tiles are visited in blocks, and each block of every pair is
+    /// combined while the blocks of tiles that appear in several pairs are in
+    /// cache.
+    /// \tparam Tile The tile type
+    template <typename Tile>
+    class MultiDotTask : public madness::TaskInterface {
+    public:
+      typedef typename Tile::value_type value_type; ///< The element type
+      typedef std::vector<value_type> result_type; ///< The dot products
+
+    private:
+      std::vector<madness::Future<Tile> > x_; ///< The first tile of each pair
+      std::vector<madness::Future<Tile> > y_; ///< The second tile of each pair
+      std::vector<std::size_t> index_; ///< The result position of each pair
+      const std::size_t n_; ///< The number of results
+      madness::Future<result_type> result_; ///< The dot products
+
+      void depend(madness::Future<Tile>& f) {
+        if(! f.probe()) {
+          madness::DependencyInterface::inc();
+          f.register_callback(this);
+        }
+      }
+
+    public:
+      /// Constructor
+
+      /// \param n The number of results
+      MultiDotTask(const std::size_t n) :
+        madness::TaskInterface(madness::TaskAttributes()),
+        x_(), y_(), index_(), n_(n), result_()
+      { }
+
+      virtual ~MultiDotTask() { }
+
+      /// Add a pair of tiles
+
+      /// \param k The result position of the dot product of \c x and \c y
+      /// \param x The first tile
+      /// \param y The second tile
+      void add(const std::size_t k, const madness::Future<Tile>& x, const madness::Future<Tile>& y) {
+        TA_ASSERT(k < n_);
+        index_.push_back(k);
+        x_.push_back(x);
+        y_.push_back(y);
+        depend(x_.back());
+        depend(y_.back());
+      }
+
+      /// The dot products, where pairs that were not added give zero
+      const madness::Future<result_type>& result() const { return result_; }
+
+      virtual void run(const madness::TaskThreadEnv&) {
+        const std::size_t block_size = 2048ul; // Elements per block
+        result_type result(n_, value_type(0));
+        if(! x_.empty()) {
+          const std::size_t size = x_.front().get().size();
+          for(std::size_t first = 0ul; first < size; first += block_size) {
+            const std::size_t n = ((size - first) < block_size ? (size - first) : block_size);
+            for(std::size_t k = 0ul; k < x_.size(); ++k) {
+              const Tile& x = x_[k].get();
+              const Tile& y = y_[k].get();
+              TA_ASSERT(x.size() == size);
+              TA_ASSERT(y.range() == x.range());
+              result[index_[k]] += math::dot(n, x.data() + first, y.data() + first);
+            }
+          }
+        }
+        result_.set(result);
+      }
+    }; // class MultiDotTask
+
+    /// Task that computes a linear combination of tiles
+
+    /// The result tile is \c beta*y+sum_k(a_k*x_k) . The tiles are visited in
+    /// blocks, and each block of the result is accumulated while it is in
+    /// cache. When \c beta is zero, \c y is not read.
+    /// \tparam Tile The tile type
+    template <typename Tile>
+    class MultiAxpyTask : public madness::TaskInterface {
+    public:
+      typedef typename Tile::value_type value_type; ///< The element type
+      typedef typename Tile::range_type range_type; ///< The tile range type
+
+    private:
+      const range_type range_; ///< The result tile range
+      const value_type beta_; ///< The scaling factor of \c y_
+      madness::Future<Tile> y_; ///< The tile that is scaled
+      std::vector<value_type> a_; ///< The scaling factors of \c x_
+      std::vector<madness::Future<Tile> > x_; ///< The tiles that are added
+      madness::Future<Tile> result_; ///< The result tile
+
+      void depend(madness::Future<Tile>& f) {
+        if(! f.probe()) {
+          madness::DependencyInterface::inc();
+          f.register_callback(this);
+        }
+      }
+
+    public:
+      /// Constructor
+
+      /// \param range The result tile range
+      /// \param beta The scaling factor of \c y
+      /// \param y The tile that is scaled, which is ignored when \c beta is zero
+      MultiAxpyTask(const range_type& range, const value_type beta, const madness::Future<Tile>& y) :
+        madness::TaskInterface(madness::TaskAttributes()),
+        range_(range), beta_(beta), y_(y), a_(), x_(), result_()
+      {
+        if(beta_ != value_type(0))
+          depend(y_);
+      }
+
+      virtual ~MultiAxpyTask() { }
+
+      /// Add a scaled tile to the result
+
+      /// \param a The scaling factor of \c x
+      /// \param x The tile
+      void add(const value_type a, const madness::Future<Tile>& x) {
+        a_.push_back(a);
+        x_.push_back(x);
+        depend(x_.back());
+      }
+
+      /// The result tile
+      const madness::Future<Tile>& result() const { return result_; }
+
+      virtual void run(const madness::TaskThreadEnv&) {
+        const std::size_t block_size = 2048ul; // Elements per block
+        Tile result(range_);
+        const std::size_t size = result.size();
+        for(std::size_t first = 0ul; first < size; first += block_size) {
+          const std::size_t n = ((size - first) < block_size ? (size - first) : block_size);
+          if(beta_ != value_type(0)) {
+            const Tile& y = y_.get();
+            TA_ASSERT(y.range() == range_);
+            math::eigen_map(result.data() + first, n) = beta_ * math::eigen_map(y.data() + first, n);
+          }
+          for(std::size_t k = 0ul; k < x_.size(); ++k) {
+            const Tile& x = x_[k].get();
+            TA_ASSERT(x.range() == range_);
+            math::eigen_map(result.data() + first, n) += a_[k] * math::eigen_map(x.data() + first, n);
+          }
+        }
+        result_.set(result);
+      }
+    }; // class MultiAxpyTask
+
+    /// Dot products of pairs of arrays
+
+    /// \tparam A The array type
+    /// \param left The first array of each pair
+    /// \param right The second array of each pair
+    /// \return The dot product of each pair
+    /// \sa MultiDotTask
+    template <typename A>
+    inline std::vector<typename A::element_type>
+    dot_products(const std::vector<const A*>& left, const std::vector<const A*>& right) {
+      typedef typename A::element_type element_type;
+      typedef MultiDotTask<typename A::value_type> task_type;
+
+      TA_ASSERT(left.size() == right.size());
+      const std::size_t n = left.size();
+      std::vector<element_type> result(n, element_type(0));
+      if(n == 0ul)
+        return result;
+
+      for(std::size_t k = 0ul; k < n; ++k)
+        TA_USER_ASSERT((left[k]->trange() == left.front()->trange()) &&
+            (right[k]->trange() == left.front()->trange()),
+            "dot_products: the tiled ranges of the arrays do not match.");
+      madness::World& world = left.front()->get_world();
+
+      // Compute the dot products of the local tiles
+      std::vector<madness::Future<typename task_type::result_type> > local;
+      typename A::pmap_interface::const_iterator it = left.front()->get_pmap()->begin();
+      const typename A::pmap_interface::const_iterator end = left.front()->get_pmap()->end();
+      for(; it != end; ++it) {
+        const typename A::size_type i = *it;
+        task_type* task = new task_type(n);
+        for(std::size_t k = 0ul; k < n; ++k)
+          if(! (left[k]->is_zero(i) || right[k]->is_zero(i)))
+            task->add(k, left[k]->find(i), right[k]->find(i));
+        local.push_back(task->result());
+        world.taskq.add(task);
+      }
+
+      // Sum the local and then the global results
+      for(std::size_t t = 0ul; t < local.size(); ++t) {
+        const typename task_type::result_type& r = local[t].get();
+        for(std::size_t k = 0ul; k < n; ++k)
+          result[k] += r[k];
+      }
+      world.gop.sum(& result.front(), n);
+
+      return result;
+    }
+
   } // namespace detail
 
   template <typename T, unsigned int DIM, typename Tile>
@@ -106,6 +310,109 @@ namespace TiledArray {
     y = y(vars) + a * x(vars);
   }
 
+  /// Dot products of an array with a sequence of arrays
+
+  /// All dot products are computed in one pass over the local tiles of \c a1
+  /// and are combined with one global sum, instead of one distributed
+  /// reduction for each array in the sequence.
+  /// \tparam InIter An input iterator type that dereferences to an array
+  /// \param a1 The array
+  /// \param first The first array of the sequence
+  /// \param last The end of the sequence
+  /// \return The dot product of \c a1 with each array of <tt>[first,last)</tt>
+  template <typename T, unsigned int DIM, typename Tile, typename InIter>
+  inline std::vector<typename TiledArray::Array<T,DIM,Tile>::element_type>
+  multi_dot_product(const TiledArray::Array<T,DIM,Tile>& a1, InIter first, InIter last) {
+    std::vector<const TiledArray::Array<T,DIM,Tile>*> left, right;
+    for(; first != last; ++first) {
+      left.push_back(& a1);
+      right.push_back(& (*first));
+    }
+
+    return detail::dot_products(left, right);
+  }
+
+  /// Dot products of pairs of arrays
+
+  /// All dot products are computed in one pass over the local tiles and are
+  /// combined with one global sum.
+  /// \tparam InIter1 An input iterator type that dereferences to an array
+  /// \tparam InIter2 An input iterator type that dereferences to an array
+  /// \param first1 The first array of the first pair
+  /// \param last1 The end of the first arrays of the pairs
+  /// \param first2 The second array of the first pair
+  /// \return The dot product of each pair <tt>(*(first1+k), *(first2+k))</tt>
+  template <typename InIter1, typename InIter2>
+  inline std::vector<typename std::iterator_traits<InIter1>::value_type::element_type>
+  dot_products(InIter1 first1, InIter1 last1, InIter2 first2) {
+    typedef typename std::iterator_traits<InIter1>::value_type array_type;
+    std::vector<const array_type*> left, right;
+    for(; first1 != last1; ++first1, ++first2) {
+      left.push_back(& (*first1));
+      right.push_back(& (*first2));
+    }
+
+    return detail::dot_products(left, right);
+  }
+
+  /// Linear combination of a sequence of arrays
+
+  /// Compute \c y=beta*y+sum_k(a_k*x_k) in one pass over the tiles, instead
+  /// of one distributed expression for each array in the sequence. When
+  /// \c beta is zero, the tiles of \c y are not read. Sparse arrays are
+  /// combined with one \c axpy for each array.
+  /// \tparam AIter An input iterator type for the scaling factors
+  /// \tparam XIter An input iterator type that dereferences to an array
+  /// \param[in,out] y The result array
+  /// \param beta The scaling factor of \c y
+  /// \param a_first The first scaling factor
+  /// \param a_last The end of the scaling factors
+  /// \param x_first The first array, which is scaled by \c *a_first
+  template <typename T, unsigned int DIM, typename Tile, typename AIter, typename XIter>
+  inline void multi_axpy(TiledArray::Array<T,DIM,Tile>& y,
+                         typename TiledArray::Array<T,DIM,Tile>::element_type beta,
+                         AIter a_first, AIter a_last, XIter x_first) {
+    typedef TiledArray::Array<T,DIM,Tile> array_type;
+    typedef typename array_type::element_type element_type;
+    typedef detail::MultiAxpyTask<typename array_type::value_type> task_type;
+
+    std::vector<element_type> a;
+    std::vector<const array_type*> x;
+    bool dense = y.is_dense() || (beta == element_type(0));
+    for(; a_first != a_last; ++a_first, ++x_first) {
+      TA_USER_ASSERT(x_first->trange() == y.trange(),
+          "multi_axpy: the tiled ranges of the arrays do not match.");
+      a.push_back(*a_first);
+      x.push_back(& (*x_first));
+      dense = dense && x.back()->is_dense();
+    }
+
+    if(! dense) {
+      // The result shape would be the union of the argument shapes
+      if(beta != element_type(1))
+        scale(y, beta);
+      for(std::size_t k = 0ul; k < x.size(); ++k)
+        axpy(y, a[k], *x[k]);
+      return;
+    }
+
+    // Compute the local tiles of the result
+    array_type result(y.get_world(), y.trange(), y.get_pmap());
+    typename array_type::pmap_interface::const_iterator it = y.get_pmap()->begin();
+    const typename array_type::pmap_interface::const_iterator end = y.get_pmap()->end();
+    for(; it != end; ++it) {
+      const typename array_type::size_type i = *it;
+      task_type* task = new task_type(y.trange().make_tile_range(i), beta,
+          (beta != element_type(0) ? y.find(i) : madness::Future<typename array_type::value_type>()));
+      for(std::size_t k = 0ul; k < x.size(); ++k)
+        task->add(a[k], x[k]->find(i));
+      result.set(i, task->result());
+      y.get_world().taskq.add(task);
+    }
+
+    y = result;
+  }
+
   template <typename T, unsigned int DIM, typename Tile>
   inline void assign(TiledArray::Array<T,DIM,Tile>& m1, const TiledArray::Array<T,DIM,Tile>& m2) {
     m1 = m2;
@@ -23,6 +23,7 @@
 #include <TiledArray/tensor_expression.h>
 #include <TiledArray/tensor.h>
 #include <TiledArray/math/functional.h>
+#include <TiledArray/tile_truncation.h>
 
 namespace TiledArray {
   namespace expressions {
@@ -33,6 +34,10 @@ namespace TiledArray {
         static void assign(std::shared_ptr<AT>&, TensorExpression<typename AT::value_type>& other) {
           TA_USER_ASSERT(false, "You cannot assign to an unassignable array.")
         }
+
+        static void accumulate(std::shared_ptr<AT>&, TensorExpression<typename AT::value_type>& other, const bool) {
+          TA_USER_ASSERT(false, "You cannot accumulate into an unassignable array.")
+        }
       }; // AssignArrayHelper
 
       template <typename AT>
@@ -40,11 +45,181 @@ namespace TiledArray {
           std::is_same<typename AT::array_type::value_type,
                        typename AT::value_type> >::type>
       {
+        /// Assign a tensor expression to the array
+
+        /// The array is replaced by a new array that holds the result tiles.
+        /// This does not wait for the tiles to be evaluated. The result keeps
+        /// the process map preferred by \c other , e.g. the process grid of a
+        /// contraction, and otherwise uses the process map of the array.
+        /// When automatic truncation is enabled, the array is truncated, which
+        /// waits for the result tiles. When the array has a permutational
+        /// symmetry, the result keeps it and only the canonical result tiles
+        /// are evaluated.
+        /// \param pimpl The annotated array that is the assignment target
+        /// \param other The expression to be assigned to the array
+        /// \sa TensorExpression::eval_to_array, TileTruncation
         static void assign(std::shared_ptr<AT>& pimpl, TensorExpression<typename AT::value_type>& other) {
+          typename AT::array_type& array = pimpl->xarray();
           std::shared_ptr<typename AT::pmap_interface>
-              pmap(new TiledArray::detail::BlockedPmap(pimpl->get_world(), other.size()));
-          other.eval(pimpl->vars(), pmap).get();
-          pimpl->xarray() = other.template convert_to_array<typename AT::array_type>();
+              pmap = other.select_pmap(pimpl->vars(), array.get_pmap());
+          if(array.get_symmetry() && (! array.get_symmetry()->is_trivial())) {
+            const Symmetry sym = *array.get_symmetry();
+            array = other.template eval_to_array<typename AT::array_type>(pimpl->vars(), pmap, sym);
+          } else {
+            array = other.template eval_to_array<typename AT::array_type>(pimpl->vars(), pmap);
+          }
+          truncate(array);
+        }
+
+        /// Truncate an array when automatic truncation is enabled
+
+        /// \param array The array to be truncated
+        static void truncate(typename AT::array_type& array) {
+          const double threshold = TiledArray::detail::TileTruncation::threshold();
+          if(threshold > 0.0)
+            array.truncate(threshold);
+        }
+
+        /// Add \c arg to \c tile
+        static typename AT::value_type
+        add(const typename AT::value_type& tile, const typename AT::value_type& arg) {
+          return tile + arg;
+        }
+
+        /// Subtract \c arg from \c tile
+        static typename AT::value_type
+        subt(const typename AT::value_type& tile, const typename AT::value_type& arg) {
+          return tile - arg;
+        }
+
+        /// Negate \c arg
+        static typename AT::value_type neg(const typename AT::value_type& arg) {
+          return -arg;
+        }
+
+        /// Add \c tile to \c arg in place
+
+        /// \param tile The array tile
+        /// \param arg The consumable expression tile
+        /// \return \c arg , which holds the sum
+        static typename AT::value_type
+        add_to(const typename AT::value_type& tile, typename AT::value_type arg) {
+          arg += tile;
+          return arg;
+        }
+
+        /// Subtract \c arg from \c tile in place of \c arg
+
+        /// \param tile The array tile
+        /// \param arg The consumable expression tile
+        /// \return \c arg , which holds the difference
+        static typename AT::value_type
+        subt_to(const typename AT::value_type& tile, typename AT::value_type arg) {
+          typedef typename AT::value_type::value_type numeric_type;
+          // arg = (arg - tile) * -1
+          math::team_vector_assign(arg.size(), tile.data(), arg.data(),
+              math::ScalMinusAssign<numeric_type, numeric_type>(-1));
+          return arg;
+        }
+
+        /// Negate \c arg in place
+
+        /// \param arg The consumable expression tile
+        /// \return \c arg , which holds the negated tile
+        static typename AT::value_type neg_to(typename AT::value_type arg) {
+          arg *= -1;
+          return arg;
+        }
+
+        /// Add the local tiles of an expression to an array
+
+        /// The sums are stored in \c result . When the expression tiles are
+        /// consumable, the sums are written in place into them. The tiles of
+        /// \c array are never modified, since other arrays may share them.
+        /// \param array The array that is the accumulation target
+        /// \param result The array that receives the sums
+        /// \param other The evaluated expression
+        /// \param subtract \c true when \c other is subtracted from the array
+        static void accumulate_tiles(const typename AT::array_type& array, typename AT::array_type result,
+            TensorExpression<typename AT::value_type> other, const bool subtract, bool)
+        {
+          typedef typename AT::pmap_interface pmap_interface;
+
+          madness::World& world = array.get_world();
+          const bool consumable = other.is_consumable();
+          const typename pmap_interface::const_iterator end = array.get_pmap()->end();
+          for(typename pmap_interface::const_iterator it = array.get_pmap()->begin(); it != end; ++it) {
+            const bool zero_tile = array.is_zero(*it);
+            if(other.is_zero(*it)) {
+              if(! zero_tile)
+                result.set(*it, array.find(*it));
+            } else if(zero_tile) {
+              if(! subtract)
+                result.set(*it, other.move(*it));
+              else if(consumable)
+                result.set(*it, world.taskq.add(& neg_to, other.move(*it)));
+              else
+                result.set(*it, world.taskq.add(& neg, other.move(*it)));
+            } else if(consumable) {
+              result.set(*it, world.taskq.add((subtract ? & subt_to : & add_to),
+                  array.find(*it), other.move(*it)));
+            } else {
+              result.set(*it, world.taskq.add((subtract ? & subt : & add),
+                  array.find(*it), other.move(*it)));
+            }
+          }
+        }
+
+        /// Add a tensor expression to the array
+
+        /// \c other is evaluated with the data layout and process map of the
+        /// array, so each result tile is produced on the process that owns the
+        /// matching array tile. Each sum is stored in a new array as soon as
+        /// the expression tile is ready, so no temporary array holds the
+        /// evaluated expression. When the expression tiles are temporaries,
+        /// e.g. the result tiles of a contraction, the array tile is added to
+        /// them in place, so only the array tile and the expression tile are
+        /// held for each sum. Otherwise, e.g. when \c other is an array, the
+        /// sum is a new tile. The existing array tiles are not modified, since
+        /// tiles are shallow copies that other arrays may share.
+        /// When the array or \c other is dense, this does not wait for the
+        /// evaluation. Otherwise it waits for the structure of \c other , which
+        /// is needed for the shape of the result, but not for the tiles.
+        /// \param pimpl The annotated array that is the accumulation target
+        /// \param other The expression to be added to the array
+        /// \param subtract \c true when \c other is subtracted from the array
+        /// \throw TiledArray::Exception When the tiled ranges of the array and
+        /// \c other do not match, or when the array has permutational symmetry.
+        static void accumulate(std::shared_ptr<AT>& pimpl, TensorExpression<typename AT::value_type>& other,
+            const bool subtract)
+        {
+          typedef typename AT::array_type array_type;
+
+          array_type& array = pimpl->xarray();
+          TA_USER_ASSERT((! array.get_symmetry()) || array.get_symmetry()->is_trivial(),
+              "Accumulation is not supported for arrays with permutational symmetry.");
+          TA_USER_ASSERT((pimpl->vars() != other.vars() ?
+              pimpl->vars().permutation(other.vars()) ^ other.trange() : other.trange()) == array.trange(),
+              "The tiled range of the accumulated expression does not match the array.");
+
+          madness::World& world = array.get_world();
+          madness::Future<bool> done = other.eval(pimpl->vars(), array.get_pmap());
+
+          if(array.is_dense() || other.is_dense()) {
+            array_type result(world, array.trange(), array.get_pmap());
+            world.taskq.add(& accumulate_tiles, array, result, other, subtract, done,
+                madness::TaskAttributes::hipri());
+            array = result;
+          } else {
+            // The result shape is the union of the array and argument shapes
+            done.get();
+            array_type result(world, array.trange(), array.get_shape() | other.get_shape(),
+                array.get_pmap());
+            accumulate_tiles(array, result, other, subtract, true);
+            array = result;
+          }
+
+          truncate(array);
         }
       }; // AssignArrayHelper
 
@@ -95,6 +270,68 @@ namespace TiledArray {
         /// \return A const reference to the array object
         const array_type& array() const { return array_copy_; }
 
+        /// Estimated tile density
+
+        /// The tiles of a symmetric array that are not stored are counted,
+        /// since the expression holds them.
+        /// \return The fraction of non-zero tiles in the array
+        virtual double density() const {
+          if(array_.is_dense())
+            return 1.0;
+          if(! is_symmetric(array_))
+            return double(array_.get_shape().count()) / double(array_.size());
+
+          size_type count = 0ul;
+          for(size_type i = 0ul; i < array_.size(); ++i)
+            if(! array_.is_zero(i))
+              ++count;
+          return double(count) / double(array_.size());
+        }
+
+        /// Preferred process map for the result tiles
+
+        /// \return The process map of the array, so array tiles are not moved
+        virtual std::shared_ptr<pmap_interface> result_pmap() const {
+          return array_.get_pmap();
+        }
+
+        /// Check for result tiles that may be modified
+
+        /// Unless they are converted, scaled, or permuted, the result tiles are
+        /// the tiles of the array, so they may not be modified.
+        /// \return \c true when the result tiles are copies of the array tiles
+        virtual bool is_consumable() const {
+          return (! std::is_same<typename array_type::value_type, value_type>::value)
+              || (! is_one(TensorExpressionImpl_::scale()))
+              || TensorExpressionImpl_::is_permuted();
+        }
+
+        /// Write the structural key of this expression
+
+        /// \param os The output stream for the key
+        virtual void make_key(std::ostream& os) const {
+          os << "A" << & array_;
+          TensorExpressionImpl_::make_key_suffix(os);
+        }
+
+        /// Collect the arrays read by this expression
+
+        /// \param[out] arrays The array referenced by this expression is
+        /// appended to this list
+        virtual void collect_arrays(std::vector<const void*>& arrays) const {
+          arrays.push_back(& array_);
+        }
+
+        /// Add a tensor expression to this object
+        virtual void accumulate(std::shared_ptr<TensorExpressionImpl_>& pimpl, TensorExpression<value_type>& other,
+            const bool subtract)
+        {
+          TA_ASSERT(pimpl.get() == this);
+          std::shared_ptr<AnnotatedTensorImpl_> this_ptr =
+              std::static_pointer_cast<AnnotatedTensorImpl_>(pimpl);
+          AssignArrayHelper<AnnotatedTensorImpl_>::accumulate(this_ptr, other, subtract);
+        }
+
         /// Assign a tensor expression to this object
         virtual void assign(std::shared_ptr<TensorExpressionImpl_>& pimpl, TensorExpression<value_type>& other) {
           TA_ASSERT(pimpl.get() == this);
@@ -105,6 +342,14 @@ namespace TiledArray {
 
       private:
 
+        /// Check for a non-trivial permutational symmetry
+
+        /// \param array The array
+        /// \return \c true when only the canonical tiles of \c array are stored
+        static bool is_symmetric(const array_type& array) {
+          return array.get_symmetry() && (! array.get_symmetry()->is_trivial());
+        }
+
         /// Task function that is used to convert an input tile to value_type and store it
 
         /// \param i The tile index
@@ -198,7 +443,7 @@ namespace TiledArray {
         /// \param t The value to be checked
         /// \return \c true if t is equal to 1, otherwise false
         template <typename T>
-        typename madness::enable_if<std::is_integral<T>, bool>::type
+        static typename madness::enable_if<std::is_integral<T>, bool>::type
         is_one(const T t) {
           return t == std::integral_constant<T, 1>::value;
         }
@@ -208,7 +453,7 @@ namespace TiledArray {
         /// Check that \c is approximately equal to 1 +/- 10^-13.
         /// \param t The value to be checked
         /// \return \c true if t is equal to 1, otherwise false
-        bool is_one(const double t) {
+        static bool is_one(const double t) {
           return (t <= 1.0000000000001) && (t >= 0.9999999999999);
         }
 
@@ -217,7 +462,7 @@ namespace TiledArray {
         /// Check that \c is approximately equal to 1 +/- 10^-5.
         /// \param t The value to be checked
         /// \return \c true if t is equal to 1, otherwise false
-        bool is_one(const float t) { return (t <= 1.00001) && (t >= 0.99999); }
+        static bool is_one(const float t) { return (t <= 1.00001) && (t >= 0.99999); }
 
         /// Function for evaluating this tensor's tiles
 
@@ -232,21 +477,21 @@ namespace TiledArray {
               TensorExpressionImpl_::pmap()->begin();
 
             if(is_one(TensorExpressionImpl_::scale())) {
-              if(array_copy_.is_dense()) {
+              if(array_copy_.is_dense() && (! TensorExpressionImpl_::has_mask())) {
                 for(; it != end; ++it)
                   set_tile(*it, array_copy_.find(*it));
               } else {
                 for(; it != end; ++it)
-                  if(! array_copy_.is_zero(*it))
+                  if(! (array_copy_.is_zero(*it) || TensorExpressionImpl_::is_masked(*it)))
                     set_tile(*it, array_copy_.find(*it));
               }
             } else {
-              if(array_copy_.is_dense()) {
+              if(array_copy_.is_dense() && (! TensorExpressionImpl_::has_mask())) {
                 for(; it != end; ++it)
                   scale_set_tile(*it, array_copy_.find(*it));
               } else {
                 for(; it != end; ++it)
-                  if(! array_copy_.is_zero(*it))
+                  if(! (array_copy_.is_zero(*it) || TensorExpressionImpl_::is_masked(*it)))
                     scale_set_tile(*it, array_copy_.find(*it));
               }
             }
@@ -266,10 +511,22 @@ namespace TiledArray {
 
         /// Construct the shape object
 
+        /// The expression holds every tile of a symmetric array, so its shape
+        /// is expanded from the canonical tiles. \c eval_tiles() fetches the
+        /// other tiles with \c Array::find() , which permutes the canonical
+        /// tile.
         /// \param shape The existing shape object
         virtual void make_shape(shape_type& shape) const {
           TA_ASSERT(shape.size() == array_copy_.size());
-          shape = array_copy_.get_shape();
+          if(is_symmetric(array_copy_)) {
+            shape_type full(array_copy_.size());
+            for(size_type i = 0ul; i < array_copy_.size(); ++i)
+              if(! array_copy_.is_zero(i))
+                full.set(i);
+            shape = full;
+          } else {
+            shape = array_copy_.get_shape();
+          }
         }
 
         array_type& array_; ///< The referenced array
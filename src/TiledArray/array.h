@@ -22,7 +22,11 @@
 
 #include <TiledArray/annotated_tensor.h>
 #include <TiledArray/replicator.h>
+#include <TiledArray/redistributor.h>
 #include <TiledArray/pmap/replicated_pmap.h>
+#include <TiledArray/symmetry.h>
+#include <TiledArray/tile_op/permute.h>
+#include <TiledArray/tile_truncation.h>
 
 namespace TiledArray {
 
@@ -105,14 +109,65 @@ namespace TiledArray {
       pimpl_->pmap(make_pmap(pmap, w, tr.tiles().volume()));
     }
 
+    /// Symmetric array constructor
+
+    /// Only the tiles with a canonical index, as defined by \c sym , are
+    /// stored in the array. All other tiles are zero in the array shape, but
+    /// \c find() will return the permuted canonical tile for these indices.
+    /// When a tensor expression is assigned to a symmetric array, only the
+    /// canonical result tiles are evaluated, and the result is assumed to have
+    /// the symmetry of the array. The arguments of an expression are not
+    /// reduced by symmetry: a symmetric argument array is read in full form,
+    /// i.e. every tile is fetched with \c find() , and every tile of an
+    /// intermediate result is evaluated.
+    /// \param w The world where the array will live.
+    /// \param tr The tiled range object that will be used to set the array tiling.
+    /// \param sym The permutational symmetry of the array
+    /// \param pmap The tile index -> process map
+    /// \throw TiledArray::Exception When the tiling of \c tr is not invariant
+    /// under the permutations of \c sym .
+    Array(madness::World& w, const trange_type& tr, const Symmetry& sym,
+        const std::shared_ptr<pmap_interface>& pmap = std::shared_ptr<pmap_interface>()) :
+        pimpl_(new impl_type(w, tr, make_shape(tr, sym)),
+            madness::make_deferred_deleter<impl_type>(w)),
+        symmetry_(new Symmetry(sym))
+    {
+      TA_USER_ASSERT(tr.tiles().dim() == DIM,
+          "The dimensions of the tiled range do not match that of the array object.");
+      pimpl_->pmap(make_pmap(pmap, w, tr.tiles().volume()));
+    }
+
+    /// Sparse symmetric array constructor
+
+    /// The array stores the tiles with a canonical index, as defined by
+    /// \c sym , that are also set in \c shape .
+    /// \param w The world where the array will live.
+    /// \param tr The tiled range object that will be used to set the array tiling.
+    /// \param sym The permutational symmetry of the array
+    /// \param shape Bitset of the same length as \c tr. The tiles that are not
+    /// set are zero.
+    /// \param pmap The tile index -> process map
+    /// \throw TiledArray::Exception When the tiling of \c tr is not invariant
+    /// under the permutations of \c sym .
+    Array(madness::World& w, const trange_type& tr, const Symmetry& sym, const shape_type& shape,
+        const std::shared_ptr<pmap_interface>& pmap = std::shared_ptr<pmap_interface>()) :
+        pimpl_(new impl_type(w, tr, make_shape(tr, sym) & shape),
+            madness::make_deferred_deleter<impl_type>(w)),
+        symmetry_(new Symmetry(sym))
+    {
+      TA_USER_ASSERT(tr.tiles().dim() == DIM,
+          "The dimensions of the tiled range do not match that of the array object.");
+      pimpl_->pmap(make_pmap(pmap, w, tr.tiles().volume()));
+    }
+
     /// Default constructor
-    Array() : pimpl_() { }
+    Array() : pimpl_(), symmetry_() { }
 
     /// Copy constructor
 
     /// This is a shallow copy, that is no data is copied.
     /// \param other The array to be copied
-    Array(const Array_& other) : pimpl_(other.pimpl_) { }
+    Array(const Array_& other) : pimpl_(other.pimpl_), symmetry_(other.symmetry_) { }
 
 //    /// Construct Array from a pimpl
 //
@@ -125,6 +180,7 @@ namespace TiledArray {
     /// \param other The array to be copied
     Array_& operator=(const Array_& other) {
       pimpl_ = other.pimpl_;
+      symmetry_ = other.symmetry_;
       return *this;
     }
 
@@ -167,10 +223,14 @@ namespace TiledArray {
 
     /// Find local or remote tile
 
+    /// If the array has a permutational symmetry and \c i is not a canonical
+    /// index, the canonical tile is fetched and permuted into \c i .
     /// \tparam Index The index type
     template <typename Index>
     madness::Future<value_type> find(const Index& i) const {
       check_index(i);
+      if(symmetry_ && (! symmetry_->is_trivial()))
+        return find_symmetric(pimpl_->range().idx(i));
       return pimpl_->operator[](i);
     }
 
@@ -184,6 +244,7 @@ namespace TiledArray {
     typename madness::enable_if<detail::is_input_iterator<InIter> >::type
     set(const Index& i, InIter first) {
       check_index(i);
+      check_unique(i);
       pimpl_->set(i, value_type(pimpl_->trange().make_tile_range(i), first));
     }
 
@@ -226,6 +287,7 @@ namespace TiledArray {
     template <typename Index>
     void set(const Index& i, const T& v = T()) {
       check_index(i);
+      check_unique(i);
       pimpl_->get_world().taskq.add(new MakeTile<Index, value_type>(pimpl_, i, v));
     }
 
@@ -236,6 +298,7 @@ namespace TiledArray {
     template <typename Index>
     void set(const Index& i, const madness::Future<value_type>& f) {
       check_index(i);
+      check_unique(i);
       pimpl_->set(i, f);
     }
 
@@ -247,6 +310,7 @@ namespace TiledArray {
     template <typename Index>
     void set(const Index& i, const value_type& v) {
       check_index(i);
+      check_unique(i);
       pimpl_->set(i, v);
     }
 
@@ -357,6 +421,24 @@ namespace TiledArray {
       return pimpl_->shape();
     }
 
+    /// Symmetry accessor
+
+    /// \return A pointer to the permutational symmetry of the array, which is
+    /// \c NULL when the array has no symmetry.
+    const std::shared_ptr<Symmetry>& get_symmetry() const { return symmetry_; }
+
+    /// Check for stored tiles
+
+    /// \tparam Index An index type
+    /// \param i The index of a tile
+    /// \return \c true if the tile at \c i is stored by the array, i.e. the
+    /// array has no symmetry or \c i is a canonical index.
+    template <typename Index>
+    bool is_unique(const Index& i) const {
+      check_index(i);
+      return (! symmetry_) || symmetry_->is_unique(pimpl_->range().idx(i));
+    }
+
     /// Tile ownership
 
     /// \tparam Index An index type
@@ -378,18 +460,27 @@ namespace TiledArray {
 
     /// Check for zero tiles
 
+    /// For symmetric arrays, a tile is zero when its canonical tile is zero.
     /// \return \c true if tile at index \c i is zero, false if the tile is
     /// non-zero or remote existence data is not available.
     template <typename Index>
     bool is_zero(const Index& i) const {
       check_index(i);
+      if(symmetry_ && (! symmetry_->is_trivial())) {
+        Permutation perm;
+        int sign = 1;
+        return pimpl_->is_zero(symmetry_->canonical(pimpl_->range().idx(i), perm, sign));
+      }
       return pimpl_->is_zero(i);
     }
 
     /// Swap this array with \c other
 
     /// \param other The array to be swapped with this array.
-    void swap(Array_& other) { std::swap(pimpl_, other.pimpl_); }
+    void swap(Array_& other) {
+      std::swap(pimpl_, other.pimpl_);
+      std::swap(symmetry_, other.symmetry_);
+    }
 
     /// Convert a distributed \c Array into a replicated array
     void make_replicated() {
@@ -398,6 +489,7 @@ namespace TiledArray {
         // Construct a replicated array
         std::shared_ptr<pmap_interface> pmap(new detail::ReplicatedPmap(get_world(), size()));
         Array_ result = (is_dense() ? Array_(get_world(), trange(), pmap) : Array_(get_world(), trange(), get_shape(), pmap));
+        result.symmetry_ = symmetry_;
 
         // Create the replicator object that will do an all-to-all broadcast of
         // the local tile data.
@@ -413,6 +505,114 @@ namespace TiledArray {
       }
     }
 
+    /// Move the tiles of the array to a different process map
+
+    /// Each process sends the local tiles that it does not own in the new
+    /// process map to their new owners in one message per process. This is a
+    /// collective operation that does not wait for the tiles to be moved; the
+    /// tiles of the array are set when they arrive.
+    /// \param pmap The new process map
+    /// \throw TiledArray::Exception When \c pmap is not valid, is replicated,
+    /// or does not have the same number of tiles as the array
+    /// \note Use \c make_replicated() to replicate an array.
+    void redistribute(const std::shared_ptr<pmap_interface>& pmap) {
+      check_pimpl();
+      TA_USER_ASSERT(pmap, "The process map is not valid.");
+      TA_USER_ASSERT(! pmap->is_replicated(),
+          "An array cannot be redistributed to a replicated process map. Use Array::make_replicated().");
+      TA_USER_ASSERT(pmap->size() == size(),
+          "The number of tiles in the process map does not match the array.");
+      if(pmap == get_pmap())
+        return;
+
+      Array_ result = (is_dense() ? Array_(get_world(), trange(), pmap) : Array_(get_world(), trange(), get_shape(), pmap));
+      result.symmetry_ = symmetry_;
+      move_tiles(result);
+      result.swap(*this);
+    }
+
+    /// Change the tiling of the array
+
+    /// The elements of each new tile are copied from the blocks of the old
+    /// tiles that overlap it. Blocks are packed into one message per
+    /// destination process, and old tiles with the same range as a new tile
+    /// are moved without copying. A new tile is zero when it does not overlap
+    /// a non-zero old tile. This is a collective operation that does not wait
+    /// for the tiles to be moved; the tiles of the array are set when they
+    /// arrive.
+    /// \param tr The new tiled range
+    /// \param pmap The new process map
+    /// \throw TiledArray::Exception When the elements of \c tr are not equal
+    /// to the elements of the array, when \c pmap is replicated, or when the
+    /// array has a permutational symmetry
+    /// \note Use \c make_replicated() to replicate the retiled array.
+    void retile(const trange_type& tr, const std::shared_ptr<pmap_interface>& pmap = std::shared_ptr<pmap_interface>()) {
+      check_pimpl();
+      TA_USER_ASSERT(tr.tiles().dim() == DIM,
+          "The dimensions of the tiled range do not match that of the array object.");
+      TA_USER_ASSERT(tr.elements() == elements(),
+          "The elements of the tiled range do not match the elements of the array.");
+      TA_USER_ASSERT((! pmap) || (! pmap->is_replicated()),
+          "An array cannot be retiled to a replicated process map. Use Array::make_replicated().");
+      TA_USER_ASSERT((! symmetry_) || symmetry_->is_trivial(),
+          "An array with a permutational symmetry cannot be retiled.");
+      if(tr == trange()) {
+        if(pmap)
+          redistribute(pmap);
+        return;
+      }
+
+      Array_ result = (is_dense() ? Array_(get_world(), tr, pmap) :
+          Array_(get_world(), tr, detail::retile_shape(trange(), get_shape(), tr), pmap));
+      move_tiles(result);
+      result.swap(*this);
+    }
+
+    /// Remove tiles with a small norm
+
+    /// The Frobenius norm of each local tile is computed by a task, tiles with
+    /// a norm less than \c threshold are removed, and the shape of the array
+    /// is rebuilt with a global reduction. The array is not changed when no
+    /// tile is removed, so a dense array stays dense in that case. This is a
+    /// collective operation that waits for the local tiles to be evaluated.
+    /// \param threshold The tile norm threshold
+    /// \throw TiledArray::Exception When \c threshold is negative
+    void truncate(const double threshold) {
+      check_pimpl();
+      TA_USER_ASSERT(threshold >= 0.0, "The truncation threshold must not be negative.");
+      madness::World& world = get_world();
+
+      // Compute the norms of the local tiles
+      std::vector<size_type> index;
+      std::vector<madness::Future<value_type> > tiles;
+      std::vector<madness::Future<double> > norms;
+      for(const_iterator it = begin(); it != end(); ++it) {
+        index.push_back(it.ordinal());
+        tiles.push_back((*it).future());
+        norms.push_back(world.taskq.add(
+            & detail::TileTruncation::norm<value_type>, tiles.back()));
+      }
+
+      // Construct the shape of the tiles that are kept
+      shape_type shape(size());
+      for(std::size_t k = 0ul; k < index.size(); ++k)
+        if(norms[k].get() >= threshold)
+          shape.set(index[k]);
+      world.gop.bit_or(shape.get(), shape.num_blocks());
+
+      if(shape.count() == (is_dense() ? size() : get_shape().count()))
+        return;
+
+      // Construct the truncated array
+      Array_ result(world, trange(), shape, get_pmap());
+      result.symmetry_ = symmetry_;
+      for(std::size_t k = 0ul; k < index.size(); ++k)
+        if(shape[index[k]])
+          result.set(index[k], tiles[k]);
+
+      result.swap(*this);
+    }
+
     bool is_initialized() const { return static_cast<bool>(pimpl_); }
 
   private:
@@ -435,6 +635,58 @@ namespace TiledArray {
           "The number of elements in the coordinate index does not match the dimension of the array.");
     }
 
+    /// Makes sure \c i is a canonical index of a symmetric array
+    template <typename Index>
+    void check_unique(const Index& i) const {
+      TA_USER_ASSERT((! symmetry_) || symmetry_->is_unique(pimpl_->range().idx(i)),
+          "Only tiles with a canonical index may be set in a symmetric array.");
+    }
+
+    /// Find a tile of a symmetric array
+
+    /// \param i The coordinate index of the tile
+    /// \return A future to the tile at \c i
+    madness::Future<value_type> find_symmetric(const index& i) const {
+      Permutation perm;
+      int sign = 1;
+      const index c = symmetry_->canonical(i, perm, sign);
+      if(std::equal(c.begin(), c.end(), i.begin()))
+        return pimpl_->operator[](i);
+
+      return pimpl_->get_world().taskq.add(& Array_::permute_tile,
+          pimpl_->operator[](c), perm, sign);
+    }
+
+    /// Permute a canonical tile into its symmetry-equivalent tile
+
+    /// \param tile The canonical tile
+    /// \param perm The permutation that maps the canonical index to the result
+    /// \param sign The sign of the result tile relative to \c tile
+    /// \return The permuted tile
+    static value_type permute_tile(const value_type& tile, const Permutation& perm, const int sign) {
+      value_type result;
+      if(sign < 0)
+        math::permute(result, perm, tile, std::negate<T>());
+      else
+        math::permute(result, perm, tile);
+      return result;
+    }
+
+    /// Move the data of this array into \c result
+
+    /// \param result An array with the same elements as this array and no
+    /// tiles that have been set
+    void move_tiles(const Array_& result) const {
+      detail::Redistributor<Array_>* redistributor =
+          new detail::Redistributor<Array_>(*this, result);
+
+      // Put the redistributor pointer in the deferred cleanup object so it
+      // will be deleted at the end of the next fence.
+      madness::DeferredDeleter<detail::Redistributor<Array_> > deleter =
+          madness::make_deferred_deleter<detail::Redistributor<Array_> >(get_world());
+      deleter(redistributor);
+    }
+
     /// Makes sure pimpl has been initialized
     void check_pimpl() const {
       TA_USER_ASSERT(pimpl_,
@@ -480,7 +732,30 @@ namespace TiledArray {
       return shape;
     }
 
+    /// Construct the shape of a symmetric array
+
+    /// The shape contains only the tiles with a canonical index.
+    /// \param tr Tile range object for this array
+    /// \param sym The permutational symmetry of the array
+    /// \return A bitset that represents the array shape
+    static detail::Bitset<> make_shape(const trange_type& tr, const Symmetry& sym) {
+      TA_USER_ASSERT(sym.dim() == DIM,
+          "The dimension of the symmetry does not match that of the array object.");
+      for(Symmetry::size_type g = 1ul; g < sym.order(); ++g)
+        TA_USER_ASSERT((sym.perm(g) ^ tr.data()) == tr.data(),
+            "The tiling of the array is not invariant under the array symmetry.");
+
+      detail::Bitset<> shape(tr.tiles().volume());
+      typename range_type::const_iterator it = tr.tiles().begin();
+      for(size_type i = 0ul; i < shape.size(); ++i, ++it)
+        if(sym.is_unique(*it))
+          shape.set(i);
+
+      return shape;
+    }
+
     std::shared_ptr<impl_type> pimpl_; ///< Array implementation pointer
+    std::shared_ptr<Symmetry> symmetry_; ///< Array permutational symmetry
   }; // class Array
 
   /// Add the tensor to an output stream
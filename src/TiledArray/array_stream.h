@@ -0,0 +1,316 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEDARRAY_ARRAY_STREAM_H__INCLUDED
+#define TILEDARRAY_ARRAY_STREAM_H__INCLUDED
+
+#include <TiledArray/error.h>
+#include <TiledArray/madness.h>
+#include <TiledArray/tiled_range.h>
+#include <vector>
+#include <deque>
+#include <map>
+#include <algorithm>
+
+namespace TiledArray {
+  namespace detail {
+
+    /// Element-major position in an array
+
+    /// The elements of an array are visited in row-major order of the global
+    /// element index. A run is the set of elements that are contiguous in
+    /// both the element-major order and the tile that holds them, i.e. the
+    /// part of an element row that lies in one tile. Each element row
+    /// visits the tiles of one tile row in turn, so a tile is visited once
+    /// for every element row that crosses it.
+    /// \tparam A The array type
+    template <typename A>
+    class ArrayStreamPosition {
+    public:
+      typedef typename A::size_type size_type; ///< Size type
+      typedef typename A::index index; ///< Coordinate index type
+      typedef typename A::trange_type trange_type; ///< Tiled range type
+
+    protected:
+      trange_type trange_; ///< The array tiled range
+      index element_; ///< The next element
+      index tile_; ///< The tile of the next element
+      size_type remaining_; ///< The number of elements that have not been visited
+
+      ArrayStreamPosition(const trange_type& trange) :
+        trange_(trange),
+        element_(trange.elements().start().begin(), trange.elements().start().end()),
+        tile_(trange.tiles().start().begin(), trange.tiles().start().end()),
+        remaining_(trange.elements().volume())
+      { }
+
+      /// The ordinal index of the tile of the next element
+      size_type tile() const { return trange_.tiles().ord(tile_); }
+
+      /// The number of elements in the run of the next element, starting at
+      /// the next element
+      size_type run() const {
+        const std::size_t last = tile_.size() - 1ul;
+        return trange_.data()[last].tile(tile_[last]).second - element_[last];
+      }
+
+      /// Check that the run of the next element is the last run of its tile
+      bool last_run() const {
+        for(std::size_t d = 0ul; d < (tile_.size() - 1ul); ++d)
+          if((element_[d] + 1ul) != trange_.data()[d].tile(tile_[d]).second)
+            return false;
+        return true;
+      }
+
+      /// Advance the position by \c n elements in the last dimension
+
+      /// \param n The number of elements, which may not exceed \c run()
+      void advance(const size_type n) {
+        TA_ASSERT(n <= run());
+        remaining_ -= n;
+        if(remaining_ == 0ul)
+          return;
+
+        std::size_t d = element_.size() - 1ul;
+        element_[d] += n;
+        while(element_[d] == trange_.elements().finish()[d]) {
+          element_[d] = trange_.elements().start()[d];
+          --d;
+          ++element_[d];
+        }
+
+        for(d = 0ul; d < element_.size(); ++d)
+          tile_[d] = trange_.data()[d].element2tile(element_[d]);
+      }
+
+    public:
+
+      /// The number of elements that have not been visited
+      size_type remaining() const { return remaining_; }
+
+      /// Check for the end of the array
+      bool done() const { return remaining_ == 0ul; }
+
+    }; // class ArrayStreamPosition
+
+  } // namespace detail
+
+  /// Read the elements of an array in element-major order
+
+  /// The array is read in chunks of any size. The tiles of the runs that are
+  /// read next, up to \c prefetch runs after the current one, are requested
+  /// from their owners while the current run is read, and a tile is released
+  /// as soon as no run in this window needs it. The memory used is bounded by
+  /// <tt>prefetch + 1</tt> tiles, independent of the shape of the array. A
+  /// tile that is needed again after it has left the window, i.e. when an
+  /// element row crosses more than \c prefetch tiles, is fetched again, so a
+  /// larger window trades memory for communication. Zero tiles are read as
+  /// zeros.
+  /// Usage:
+  /// \code
+  /// ArrayReader<Array<double, 3> > reader(array);
+  /// std::vector<double> buffer(4096);
+  /// while(! reader.done()) {
+  ///   const std::size_t n = reader.read(& buffer.front(), buffer.size());
+  ///   file.write(reinterpret_cast<const char*>(& buffer.front()), n * sizeof(double));
+  /// }
+  /// \endcode
+  /// \tparam A The array type
+  template <typename A>
+  class ArrayReader : public detail::ArrayStreamPosition<A> {
+  public:
+    typedef ArrayReader<A> ArrayReader_; ///< This object type
+    typedef detail::ArrayStreamPosition<A> ArrayStreamPosition_; ///< Base class type
+    typedef typename ArrayStreamPosition_::size_type size_type; ///< Size type
+    typedef typename A::element_type element_type; ///< Element type
+    typedef typename A::value_type value_type; ///< Tile type
+
+  private:
+
+    /// The position of the last run that has been requested
+    class Lookahead : public ArrayStreamPosition_ {
+    public:
+      Lookahead(const typename ArrayStreamPosition_::trange_type& trange) :
+        ArrayStreamPosition_(trange)
+      { }
+
+      using ArrayStreamPosition_::tile;
+
+      /// Move to the next run
+      void next() { ArrayStreamPosition_::advance(ArrayStreamPosition_::run()); }
+    }; // class Lookahead
+
+    typedef std::pair<size_type, madness::Future<value_type> > run_tile; ///< Tile ordinal and tile of a run
+
+    A array_; ///< The array that is read
+    const size_type prefetch_; ///< The number of runs that are fetched after the current run
+    Lookahead ahead_; ///< The position of the first run that has not been requested
+    std::deque<run_tile> runs_; ///< The tiles of the requested runs, starting with the current run
+
+    // Not allowed
+    ArrayReader(const ArrayReader_&);
+    ArrayReader_& operator=(const ArrayReader_&);
+
+    /// Request the tile of the next run
+
+    /// A tile that is already held by the window is shared with the new run.
+    void fetch() {
+      const size_type t = ahead_.tile();
+      typename std::deque<run_tile>::const_reverse_iterator it = runs_.rbegin();
+      for(; it != runs_.rend(); ++it)
+        if(it->first == t)
+          break;
+
+      if(it != runs_.rend())
+        runs_.push_back(run_tile(t, it->second));
+      else
+        runs_.push_back(run_tile(t, (array_.is_zero(t) ?
+            madness::Future<value_type>(value_type()) : array_.find(t))));
+
+      ahead_.next();
+    }
+
+  public:
+
+    /// Constructor
+
+    /// \param array The array to be read
+    /// \param prefetch The number of runs, and therefore the number of
+    /// tiles, that are fetched ahead of the run that is being read
+    /// [ default = 16 ]
+    ArrayReader(const A& array, const size_type prefetch = 16ul) :
+      ArrayStreamPosition_(array.trange()), array_(array), prefetch_(prefetch),
+      ahead_(array.trange()), runs_()
+    { }
+
+    /// Read the next elements
+
+    /// \param[out] buffer The buffer that will hold the elements
+    /// \param n The size of \c buffer
+    /// \return The number of elements that were read, which is less than
+    /// \c n only at the end of the array
+    size_type read(element_type* buffer, const size_type n) {
+      size_type count = 0ul;
+      while((count < n) && (! ArrayStreamPosition_::done())) {
+        // Keep the prefetch window full
+        while((runs_.size() <= prefetch_) && (! ahead_.done()))
+          fetch();
+
+        // Copy the elements of the current run
+        const value_type& tile = runs_.front().second.get();
+        const size_type run = ArrayStreamPosition_::run();
+        const size_type len = std::min(run, n - count);
+        if(tile.empty())
+          std::fill_n(buffer + count, len, element_type(0));
+        else
+          std::copy(tile.data() + tile.range().ord(ArrayStreamPosition_::element_),
+              tile.data() + tile.range().ord(ArrayStreamPosition_::element_) + len,
+              buffer + count);
+
+        count += len;
+        ArrayStreamPosition_::advance(len);
+
+        // Release the tile of a run that has been read
+        if(len == run)
+          runs_.pop_front();
+      }
+
+      return count;
+    }
+
+  }; // class ArrayReader
+
+  /// Write the elements of an array in element-major order
+
+  /// The array is written in chunks of any size. Each tile is assembled
+  /// locally and sent to its owner as soon as its last element has been
+  /// written, so only the tiles crossed by the current element row are held
+  /// in memory. Only one process may write an array. Elements of zero tiles
+  /// in a sparse array are discarded without allocating the tile.
+  /// \tparam A The array type
+  template <typename A>
+  class ArrayWriter : public detail::ArrayStreamPosition<A> {
+  public:
+    typedef ArrayWriter<A> ArrayWriter_; ///< This object type
+    typedef detail::ArrayStreamPosition<A> ArrayStreamPosition_; ///< Base class type
+    typedef typename ArrayStreamPosition_::size_type size_type; ///< Size type
+    typedef typename A::element_type element_type; ///< Element type
+    typedef typename A::value_type value_type; ///< Tile type
+
+  private:
+    A array_; ///< The array that is written
+    std::map<size_type, value_type> tiles_; ///< The tiles that are partially written
+
+    // Not allowed
+    ArrayWriter(const ArrayWriter_&);
+    ArrayWriter_& operator=(const ArrayWriter_&);
+
+  public:
+
+    /// Constructor
+
+    /// \param array The array to be written
+    ArrayWriter(A& array) :
+      ArrayStreamPosition_(array.trange()), array_(array), tiles_()
+    { }
+
+    /// Write the next elements
+
+    /// \param buffer The elements to be written
+    /// \param n The number of elements in \c buffer
+    /// \throw TiledArray::Exception When \c n is greater than the number of
+    /// elements that remain to be written
+    void write(const element_type* buffer, const size_type n) {
+      TA_USER_ASSERT(n <= ArrayStreamPosition_::remaining(),
+          "The number of elements written is greater than the array size.");
+
+      size_type count = 0ul;
+      while(count < n) {
+        const size_type t = ArrayStreamPosition_::tile();
+        const size_type run = ArrayStreamPosition_::run();
+        const size_type len = std::min(run, n - count);
+
+        if(! array_.is_zero(t)) {
+          // Allocate the current tile
+          typename std::map<size_type, value_type>::iterator it = tiles_.find(t);
+          if(it == tiles_.end())
+            it = tiles_.insert(std::make_pair(t,
+                value_type(ArrayStreamPosition_::trange_.make_tile_range(t)))).first;
+
+          // Copy the elements of the current run
+          std::copy(buffer + count, buffer + count + len,
+              it->second.data() + it->second.range().ord(ArrayStreamPosition_::element_));
+
+          // Send a complete tile
+          if((len == run) && ArrayStreamPosition_::last_run()) {
+            array_.set(t, it->second);
+            tiles_.erase(it);
+          }
+        }
+
+        count += len;
+        ArrayStreamPosition_::advance(len);
+      }
+    }
+
+  }; // class ArrayWriter
+
+} // namespace TiledArray
+
+#endif // TILEDARRAY_ARRAY_STREAM_H__INCLUDED
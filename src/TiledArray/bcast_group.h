@@ -0,0 +1,252 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEDARRAY_BCAST_GROUP_H__INCLUDED
+#define TILEDARRAY_BCAST_GROUP_H__INCLUDED
+
+#include <TiledArray/error.h>
+#include <TiledArray/madness.h>
+#include <vector>
+#include <map>
+#include <unistd.h>
+
+namespace TiledArray {
+  namespace detail {
+
+    /// The node ids of the worlds for which they have been exchanged
+    inline std::map<unsigned long, std::vector<int> >& node_id_registry() {
+      static std::map<unsigned long, std::vector<int> > registry;
+      return registry;
+    }
+
+    /// The mutex that guards \c node_id_registry()
+    inline madness::Mutex& node_id_mutex() {
+      static madness::Mutex mutex;
+      return mutex;
+    }
+
+    /// Exchange the host node of each process in a world
+
+    /// Processes that run on the same host, as reported by \c gethostname(),
+    /// share a node id. Node ids are numbered in order of the lowest rank on
+    /// each node. This is a collective operation, which must be called by
+    /// all processes of \c world in the same order with respect to other
+    /// collective operations. Calls after the first one for a world do
+    /// nothing.
+    /// \sa TiledArray::initialize
+    /// \param world The world
+    inline void init_node_ids(madness::World& world) {
+      {
+        madness::ScopedMutex<madness::Mutex> locker(node_id_mutex());
+        if(node_id_registry().count(world.id()))
+          return;
+      }
+
+      // Hash the host name (FNV-1a)
+      char name[256] = { 0 };
+      gethostname(name, sizeof(name) - 1ul);
+      unsigned long hash = 2166136261ul;
+      for(const char* c = name; *c; ++c)
+        hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619ul;
+
+      // Gather the host name hashes of all processes
+      std::vector<unsigned long> hashes(world.size(), 0ul);
+      hashes[world.rank()] = hash;
+      world.gop.sum(& hashes.front(), hashes.size());
+
+      // Number the nodes
+      std::vector<int> nodes;
+      std::map<unsigned long, int> node_map;
+      nodes.reserve(hashes.size());
+      for(std::size_t p = 0ul; p < hashes.size(); ++p)
+        nodes.push_back(node_map.insert(std::make_pair(hashes[p], int(node_map.size()))).first->second);
+
+      madness::ScopedMutex<madness::Mutex> locker(node_id_mutex());
+      node_id_registry()[world.id()] = nodes;
+    }
+
+    /// Host node of each process in a world
+
+    /// This function does not communicate. Until \c init_node_ids() has
+    /// been called for \c world , usually by \c TiledArray::initialize() ,
+    /// each process is reported on its own node, so node-aware algorithms
+    /// fall back to their flat form.
+    /// \param world The world
+    /// \return The node id of each process in \c world
+    /// \sa init_node_ids
+    inline std::vector<int> node_ids(madness::World& world) {
+      {
+        madness::ScopedMutex<madness::Mutex> locker(node_id_mutex());
+        std::map<unsigned long, std::vector<int> >::const_iterator it =
+            node_id_registry().find(world.id());
+        if(it != node_id_registry().end())
+          return it->second;
+      }
+
+      std::vector<int> nodes(world.size(), 0);
+      for(ProcessID p = 0; p < world.size(); ++p)
+        nodes[p] = p;
+      return nodes;
+    }
+
+    /// Node-aware broadcast group
+
+    /// A broadcast from any member of the group is done in two levels. The
+    /// root first sends the data to one leader on every other node with a
+    /// binary tree over the nodes, so the data is sent over the network once
+    /// per node. Each leader, including the root for its own node, then sends
+    /// the data to the other members of its node with a binary tree over the
+    /// members of the node. The leader of a node is the root if it is on that
+    /// node, otherwise the member with the lowest rank on the node.
+    /// Members are identified by their rank in the group.
+    class BcastGroup {
+    private:
+      std::vector<ProcessID> ranks_; ///< The world rank of each member
+      std::vector<int> node_; ///< The group node of each member
+      std::vector<int> position_; ///< The position of each member in its node
+      std::vector<std::vector<ProcessID> > members_; ///< The members of each node
+
+      /// Child in a binary tree
+
+      /// \param me The rank in the tree, renumbered so the tree root is 0
+      /// \param child The child, 1 or 2
+      /// \param root The tree root
+      /// \param size The number of tree members
+      /// \return The child rank, or -1 when there is no such child
+      static int child(const int me, const int child, const int root, const int size) {
+        const int c = (me << 1) + child;
+        return (c < size ? (c + root) % size : -1);
+      }
+
+    public:
+
+      /// Default constructor
+
+      /// Constructs an empty group
+      BcastGroup() : ranks_(), node_(), position_(), members_() { }
+
+      /// Constructor
+
+      /// \param ranks The world rank of each member of the group
+      /// \param nodes The node id of each process in the world
+      /// \sa node_ids
+      BcastGroup(const std::vector<ProcessID>& ranks, const std::vector<int>& nodes) :
+        ranks_(ranks), node_(), position_(), members_()
+      {
+        std::map<int, int> node_map;
+        node_.reserve(ranks_.size());
+        position_.reserve(ranks_.size());
+        for(std::size_t m = 0ul; m < ranks_.size(); ++m) {
+          TA_ASSERT(std::size_t(ranks_[m]) < nodes.size());
+          const int node = node_map.insert(std::make_pair(nodes[ranks_[m]], int(node_map.size()))).first->second;
+          if(std::size_t(node) == members_.size())
+            members_.push_back(std::vector<ProcessID>());
+          node_.push_back(node);
+          position_.push_back(members_[node].size());
+          members_[node].push_back(m);
+        }
+      }
+
+      /// The number of members in the group
+      std::size_t size() const { return ranks_.size(); }
+
+      /// The number of nodes in the group
+      std::size_t nodes() const { return members_.size(); }
+
+      /// World rank of a member
+
+      /// \param m The group rank of the member
+      /// \return The world rank of \c m
+      ProcessID operator[](const std::size_t m) const {
+        TA_ASSERT(m < ranks_.size());
+        return ranks_[m];
+      }
+
+      /// The node of a member
+
+      /// \param m The group rank of the member
+      /// \return The group node index of \c m
+      int node(const ProcessID m) const { return node_[m]; }
+
+      /// The number of members on a node
+
+      /// \param node The group node index
+      /// \return The number of members of the group on \c node
+      std::size_t node_size(const int node) const { return members_[node].size(); }
+
+      /// Leader of a node for a broadcast
+
+      /// \param node The group node index
+      /// \param root The group rank of the broadcast root
+      /// \return The group rank of the member that receives the broadcast
+      /// from another node
+      ProcessID leader(const int node, const ProcessID root) const {
+        return (node_[root] == node ? root : members_[node].front());
+      }
+
+      /// Children of a member in a broadcast tree
+
+      /// \param rank The group rank of this member
+      /// \param root The group rank of the broadcast root
+      /// \param[out] children The group ranks of the children; must hold at
+      /// least four elements
+      /// \return The number of children
+      unsigned int children(const ProcessID rank, const ProcessID root, ProcessID* children) const {
+        TA_ASSERT(std::size_t(rank) < ranks_.size());
+        TA_ASSERT(std::size_t(root) < ranks_.size());
+        unsigned int n = 0u;
+        const int node = node_[rank];
+
+        // Send to the leaders of other nodes
+        if(leader(node, root) == rank) {
+          const int num_nodes = members_.size();
+          const int root_node = node_[root];
+          const int me = (node + num_nodes - root_node) % num_nodes;
+          for(int c = 1; c <= 2; ++c) {
+            const int child_node = child(me, c, root_node, num_nodes);
+            if(child_node != -1)
+              children[n++] = leader(child_node, root);
+          }
+        }
+
+        // Send to members of this node
+        const std::vector<ProcessID>& members = members_[node];
+        const int num_members = members.size();
+        const int root_position = position_[leader(node, root)];
+        const int me = (position_[rank] + num_members - root_position) % num_members;
+        for(int c = 1; c <= 2; ++c) {
+          const int child_position = child(me, c, root_position, num_members);
+          if(child_position != -1)
+            children[n++] = members[child_position];
+        }
+
+        return n;
+      }
+
+      template <typename Archive>
+      void serialize(Archive& ar) {
+        ar & ranks_ & node_ & position_ & members_;
+      }
+
+    }; // class BcastGroup
+
+  } // namespace detail
+} // namespace TiledArray
+
+#endif // TILEDARRAY_BCAST_GROUP_H__INCLUDED
@@ -23,6 +23,8 @@
 #include <TiledArray/tensor_expression.h>
 #include <TiledArray/tensor.h>
 #include <TiledArray/bitset.h>
+#include <TiledArray/affinity.h>
+#include <TiledArray/task_granularity.h>
 
 namespace TiledArray {
   namespace expressions {
@@ -100,6 +102,16 @@ namespace TiledArray {
           return left_zero && right_zero;
         }
 
+        /// Estimate the result density
+
+        /// The zero tiles of the arguments are assumed to be independent.
+        /// \param left The fraction of non-zero tiles in the left argument
+        /// \param right The fraction of non-zero tiles in the right argument
+        /// \return The estimated fraction of non-zero result tiles
+        static double density(const double left, const double right) {
+          return left + right - left * right;
+        }
+
         /// Construct a new bitset for shape.
 
         /// \param[in] result The shape that will store the results
@@ -124,6 +136,21 @@ namespace TiledArray {
         /// \param value The scaling factor for this operation
         void scale(const value_type value) { op_.scale(value); }
 
+        /// Evaluate a range of result elements
+
+        /// \param[out] result The result element array
+        /// \param left The left-hand argument tile
+        /// \param right The right-hand argument tile
+        /// \param first The first element to evaluate
+        /// \param last The end of the element range
+        template <typename Left, typename Right>
+        void eval_range(value_type* result, const Left& left, const Right& right,
+            const std::size_t first, const std::size_t last) const
+        {
+          for(std::size_t i = first; i < last; ++i)
+            result[i] = op_(left[i], right[i]);
+        }
+
         template <typename Left, typename Right>
         result_type operator()(const Left& left, const Right& right) {
           return result_type(left.range(), left.begin(), right.begin(), op_);
@@ -176,6 +203,16 @@ namespace TiledArray {
           return left_zero || right_zero;
         }
 
+        /// Estimate the result density
+
+        /// The zero tiles of the arguments are assumed to be independent.
+        /// \param left The fraction of non-zero tiles in the left argument
+        /// \param right The fraction of non-zero tiles in the right argument
+        /// \return The estimated fraction of non-zero result tiles
+        static double density(const double left, const double right) {
+          return left * right;
+        }
+
         /// Construct a new bitset for shape.
 
         /// \param[in] result The shape that will store the results
@@ -197,6 +234,21 @@ namespace TiledArray {
         /// \param value The scaling factor for this operation
         void scale(const value_type value) { op_.scale(value); }
 
+        /// Evaluate a range of result elements
+
+        /// \param[out] result The result element array
+        /// \param left The left-hand argument tile
+        /// \param right The right-hand argument tile
+        /// \param first The first element to evaluate
+        /// \param last The end of the element range
+        template <typename Left, typename Right>
+        void eval_range(value_type* result, const Left& left, const Right& right,
+            const std::size_t first, const std::size_t last) const
+        {
+          for(std::size_t i = first; i < last; ++i)
+            result[i] = op_(left[i], right[i]);
+        }
+
         template <typename Left, typename Right>
         result_type operator()(const Left& left, const Right& right) {
           return result_type(left.range(), left.begin(), right.begin(), op_);
@@ -285,15 +337,201 @@ namespace TiledArray {
 
         virtual ~BinaryTensorImpl() { }
 
+        /// Write the structural key of this expression
+
+        /// \param os The output stream for the key
+        virtual void make_key(std::ostream& os) const {
+          os << typeid(op_type).name() << "(";
+          left_.make_key(os);
+          os << ",";
+          right_.make_key(os);
+          os << ")";
+          TensorExpressionImpl_::make_key_suffix(os);
+        }
+
+        /// Collect the arrays read by this expression
+
+        /// \param[out] arrays The addresses of the arrays read by this
+        /// expression are appended to this list
+        virtual void collect_arrays(std::vector<const void*>& arrays) const {
+          left_.collect_arrays(arrays);
+          right_.collect_arrays(arrays);
+        }
+
+        /// Estimated tile density
+
+        /// \return The fraction of non-zero tiles once this tensor has been
+        /// evaluated, or an estimate from the argument densities before
+        virtual double density() const {
+          if(TensorImpl_::is_dense() || TensorExpressionImpl_::is_evaluated())
+            return TensorExpressionImpl_::density();
+          return op_type::density(left_.density(), right_.density());
+        }
+
+        /// Preferred process map for the result tiles
+
+        /// \return The preferred process map of the first argument that has
+        /// the variable order of this expression, or an empty pointer
+        virtual std::shared_ptr<pmap_interface> result_pmap() const {
+          std::shared_ptr<pmap_interface> result;
+          if(left_.vars() == TensorExpressionImpl_::vars())
+            result = left_.result_pmap();
+          if((! result) && (right_.vars() == TensorExpressionImpl_::vars()))
+            result = right_.result_pmap();
+          return result;
+        }
+
       private:
 
         static bool done(const bool left, const bool right) { return left && right; }
 
+        template <typename T>
+        static const void* tile_data(const T& tile) { return tile.data(); }
+
+        template <typename T>
+        static const void* tile_data(const ZeroTensor<T>&) { return NULL; }
+
         template <typename L, typename R>
-        void eval_tile(const size_type i, const L& left, const R& right) {
+        void eval_local_tile(const size_type i, const L& left, const R& right) {
+          TA_PROFILE_SCOPE("binary");
           TensorExpressionImpl_::set(i, value_type(op_(left, right)));
         }
 
+        /// Evaluate tile \c i on the NUMA node that holds its arguments
+        template <typename L, typename R>
+        void eval_tile(const size_type i, const L& left, const R& right) {
+          const void* data = tile_data(left);
+          if(! data)
+            data = tile_data(right);
+          TiledArray::detail::run_near(TensorImpl_::get_world(), data, this,
+              & BinaryTensorImpl_::template eval_local_tile<L, R>, i, left, right);
+        }
+
+        typedef typename left_tensor_type::value_type left_value_type;
+        typedef typename right_tensor_type::value_type right_value_type;
+
+        /// Task that evaluates a batch of small tiles
+        class EvalBatchTask : public madness::TaskInterface {
+        private:
+          BinaryTensorImpl_& owner_; ///< The tensor that owns the tiles
+          std::vector<size_type> index_; ///< The tile indices
+          std::vector<madness::Future<left_value_type> > left_; ///< Left-hand tiles
+          std::vector<madness::Future<right_value_type> > right_; ///< Right-hand tiles
+          size_type volume_; ///< The total number of elements in the batch
+
+          template <typename T>
+          void depend(madness::Future<T>& f) {
+            if(! f.probe()) {
+              madness::DependencyInterface::inc();
+              f.register_callback(this);
+            }
+          }
+
+        public:
+          EvalBatchTask(BinaryTensorImpl_& owner) :
+            madness::TaskInterface(madness::TaskAttributes()),
+            owner_(owner), index_(), left_(), right_(), volume_(0ul)
+          { }
+
+          virtual ~EvalBatchTask() { }
+
+          /// Add a tile to the batch
+
+          /// \param i The tile index
+          /// \param left The left-hand argument tile
+          /// \param right The right-hand argument tile
+          /// \param volume The number of elements in the tile
+          void add(const size_type i, const madness::Future<left_value_type>& left,
+              const madness::Future<right_value_type>& right, const size_type volume)
+          {
+            index_.push_back(i);
+            left_.push_back(left);
+            right_.push_back(right);
+            depend(left_.back());
+            depend(right_.back());
+            volume_ += volume;
+          }
+
+          /// The total number of elements in the batch
+          size_type volume() const { return volume_; }
+
+          virtual void run(const madness::TaskThreadEnv&) {
+            for(std::size_t k = 0ul; k < index_.size(); ++k)
+              owner_.eval_tile(index_[k], left_[k].get(), right_[k].get());
+          }
+        }; // class EvalBatchTask
+
+        /// Evaluate a range of elements in a split tile
+
+        /// The tile is stored when the last range has been evaluated.
+        /// \param i The tile index
+        /// \param result The result tile
+        /// \param left The left-hand argument tile
+        /// \param right The right-hand argument tile
+        /// \param first The first element to evaluate
+        /// \param last The end of the element range
+        /// \param remaining The number of ranges that have not been evaluated
+        void eval_tile_range(const size_type i, value_type result,
+            const left_value_type& left, const right_value_type& right,
+            const size_type first, const size_type last, madness::AtomicInt* remaining)
+        {
+          {
+            TA_PROFILE_SCOPE("binary");
+            op_.eval_range(result.data(), left, right, first, last);
+          }
+          if(remaining->dec_and_test()) {
+            delete remaining;
+            TensorExpressionImpl_::set(i, result);
+          }
+        }
+
+        /// Evaluate a large tile with several tasks
+
+        /// \param i The tile index
+        /// \param left The left-hand argument tile
+        /// \param right The right-hand argument tile
+        void eval_split_tile(const size_type i, const left_value_type& left, const right_value_type& right) {
+          const size_type volume = left.range().volume();
+          const size_type parts = TiledArray::detail::TaskGranularity::splits(volume);
+          value_type result(left.range());
+          madness::AtomicInt* remaining = new madness::AtomicInt();
+          *remaining = parts;
+          for(size_type part = 1ul; part < parts; ++part)
+            TensorImpl_::get_world().taskq.add(this, & BinaryTensorImpl_::eval_tile_range,
+                i, result, left, right,
+                TiledArray::detail::TaskGranularity::first(volume, parts, part),
+                TiledArray::detail::TaskGranularity::first(volume, parts, part + 1ul),
+                remaining);
+          eval_tile_range(i, result, left, right, 0ul,
+              TiledArray::detail::TaskGranularity::first(volume, parts, 1ul), remaining);
+        }
+
+        /// Spawn the evaluation of a tile where both arguments are non-zero
+
+        /// Small tiles are added to \c batch , which is submitted when it
+        /// reaches the target task size; large tiles are split.
+        /// \param i The tile index
+        /// \param[in,out] batch The current batch of small tiles
+        void spawn_tile(const size_type i, EvalBatchTask*& batch) {
+          const size_type volume = TensorExpressionImpl_::make_tile_range(i).volume();
+          if(TiledArray::detail::TaskGranularity::is_small(volume)) {
+            if(! batch)
+              batch = new EvalBatchTask(*this);
+            batch->add(i, left_.move(i), right_.move(i), volume);
+            if(batch->volume() >= TiledArray::detail::TaskGranularity::target()) {
+              TensorImpl_::get_world().taskq.add(batch);
+              batch = NULL;
+            }
+          } else if(TiledArray::detail::TaskGranularity::splits(volume) > 1ul) {
+            TensorImpl_::get_world().taskq.add(this, & BinaryTensorImpl_::eval_split_tile,
+                i, left_.move(i), right_.move(i));
+          } else {
+            TensorImpl_::get_world().taskq.add(this,
+                & BinaryTensorImpl_::template eval_tile<left_value_type, right_value_type>,
+                i, left_.move(i), right_.move(i));
+          }
+        }
+
         /// Function for evaluating this tensor's tiles
 
         /// This function is run inside a task, and will run after \c eval_children
@@ -310,19 +548,17 @@ namespace TiledArray {
           typename pmap_interface::const_iterator it = TensorImpl_::pmap()->begin();
           const typename pmap_interface::const_iterator end = TensorImpl_::pmap()->end();
 
-          if(left_.is_dense() && right_.is_dense() && TensorImpl_::is_dense()) {
+          EvalBatchTask* batch = NULL;
+          if(left_.is_dense() && right_.is_dense() && TensorImpl_::is_dense()
+              && (! TensorExpressionImpl_::has_mask())) {
             // Evaluate tiles where both arguments and the result are dense
-            for(; it != end; ++it) {
-              const size_type i = *it;
-              TensorImpl_::get_world().taskq.add(this,
-                  & BinaryTensorImpl_::template eval_tile<typename left_tensor_type::value_type, typename right_tensor_type::value_type>,
-                  i, left_.move(i), right_.move(i));
-            }
+            for(; it != end; ++it)
+              spawn_tile(*it, batch);
           } else {
             // Evaluate tiles where the result or one of the arguments is sparse
             for(; it != end; ++it) {
               const size_type i = *it;
-              if(! TensorImpl_::is_zero(i)) {
+              if(! (TensorImpl_::is_zero(i) || TensorExpressionImpl_::is_masked(i))) {
                 if(left_.is_zero(i)) {
                   TensorImpl_::get_world().taskq.add(this,
                     & BinaryTensorImpl_::template eval_tile<zero_left_type, typename right_tensor_type::value_type>,
@@ -332,9 +568,7 @@ namespace TiledArray {
                     & BinaryTensorImpl_::template eval_tile<typename left_tensor_type::value_type, zero_right_type>,
                     i, left_.move(i), zero_right_type());
                 } else {
-                  TensorImpl_::get_world().taskq.add(this,
-                    & BinaryTensorImpl_::template eval_tile<typename left_tensor_type::value_type, typename right_tensor_type::value_type>,
-                    i, left_.move(i), right_.move(i));
+                  spawn_tile(i, batch);
                 }
               } else {
                 // Cleanup unused tiles
@@ -345,6 +579,8 @@ namespace TiledArray {
               }
             }
           }
+          if(batch)
+            TensorImpl_::get_world().taskq.add(batch);
 
           left_.release();
           right_.release();
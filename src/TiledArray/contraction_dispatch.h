@@ -0,0 +1,399 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEDARRAY_CONTRACTION_DISPATCH_H__INCLUDED
+#define TILEDARRAY_CONTRACTION_DISPATCH_H__INCLUDED
+
+#include <TiledArray/tensor_expression.h>
+#include <TiledArray/pmap/cyclic_pmap.h>
+#include <TiledArray/bcast_group.h>
+#include <TiledArray/madness.h>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+namespace TiledArray {
+  namespace expressions {
+    namespace detail {
+
+      /// Contraction algorithm selection
+
+      /// This object estimates the run time of each contraction algorithm for
+      /// a pair of tensors and selects the fastest one. The estimate is the sum
+      /// of the compute time, the time to transfer the argument tiles, and the
+      /// message latency, for a process that holds an average share of the
+      /// result. Both algorithms distribute the result tiles on the same
+      /// process grid and only contract pairs of non-zero tiles, so the flop
+      /// count is \f$ 2 M N K \rho_L \rho_R / P \f$ for both.
+      ///
+      /// SUMMA broadcasts every non-zero tile of the arguments along the rows
+      /// and columns of the process grid, so each process receives the part
+      /// of its block rows and block columns that it does not own. It runs
+      /// one step per tile column of the left argument, and each step waits
+      /// for a broadcast along a process row and a process column. The
+      /// broadcasts use the node-aware trees of \c BcastGroup , so a tile is
+      /// sent over the network once per node and the other members of the
+      /// node receive it from their node leader.
+      ///
+      /// VSpGemm fetches each argument tile with a remote request, so each
+      /// fetch costs two messages and the arguments are distributed without
+      /// regard to the process grid. Only the tiles that are needed for a
+      /// non-zero result tile on this process are fetched, which saves
+      /// communication when the arguments are very sparse.
+      ///
+      /// The selection only depends on data that is the same on all processes,
+      /// so every process selects the same algorithm. The most recent selection
+      /// is recorded, and it may be written to a log stream, so the choice can
+      /// be audited.
+      class ContractionDispatch {
+      public:
+        typedef ContractionDispatch ContractionDispatch_; ///< This object type
+        typedef std::size_t size_type; ///< Size type
+
+        /// Contraction algorithms
+        enum engine_type {
+          summa_engine, ///< SUMMA, which skips zero tiles of sparse arguments
+          vspgemm_engine ///< Sparse dot product contraction
+        }; // enum engine_type
+
+      private:
+        size_type procs_; ///< The number of processes
+        size_type procs_per_node_; ///< The number of processes on each node
+        size_type m_; ///< The number of tile rows in the left argument
+        size_type k_; ///< The number of tiles in the contracted dimensions
+        size_type n_; ///< The number of tile columns in the right argument
+        size_type proc_rows_; ///< The number of rows in the process grid
+        size_type proc_cols_; ///< The number of columns in the process grid
+        double flops_; ///< The flop count of a dense contraction
+        double left_bytes_; ///< The size of the dense left argument in bytes
+        double right_bytes_; ///< The size of the dense right argument in bytes
+        double left_density_; ///< The fraction of non-zero left tiles
+        double right_density_; ///< The fraction of non-zero right tiles
+        double summa_cost_; ///< The estimated SUMMA run time in seconds
+        double vspgemm_cost_; ///< The estimated VSpGemm run time in seconds
+        engine_type engine_; ///< The selected algorithm
+
+        static double& latency_value() {
+          static double value = 5.0e-6;
+          return value;
+        }
+
+        static double& bandwidth_value() {
+          static double value = 1.0e9;
+          return value;
+        }
+
+        static double& flop_rate_value() {
+          static double value = 1.0e9;
+          return value;
+        }
+
+        static madness::Mutex& mutex() {
+          static madness::Mutex value;
+          return value;
+        }
+
+        static ContractionDispatch_& last_value() {
+          static ContractionDispatch_ value;
+          return value;
+        }
+
+        static std::ostream*& log_value() {
+          static std::ostream* value = NULL;
+          return value;
+        }
+
+        /// Depth of a node-aware broadcast tree
+
+        /// \param nodes The number of nodes in the broadcast group
+        /// \param members The number of group members on each node
+        /// \return The number of messages on the longest path of the tree
+        static double bcast_depth(const double nodes, const double members) {
+          return std::ceil(std::log(nodes) / std::log(2.0))
+              + std::ceil(std::log(members) / std::log(2.0));
+        }
+
+        /// Estimate the SUMMA run time
+        double summa_cost() const {
+          const double rows = proc_rows_;
+          const double cols = proc_cols_;
+          const double ppn = procs_per_node_;
+
+          // Consecutive ranks share a node, so the members of a process row
+          // are on nodes in blocks, and the members of a process column share
+          // a node only when a node holds several process rows.
+          const double row_members = std::min(ppn, cols);
+          const double row_nodes = std::ceil(cols / row_members);
+          const double col_members = std::max(std::min(std::floor(ppn / cols), rows), 1.0);
+          const double col_nodes = std::ceil(rows / col_members);
+
+          // Each process receives the tiles of its block row of the left
+          // argument and block column of the right argument that are owned by
+          // the other processes in its process row and column. A tile crosses
+          // the network once for each node, and that transfer is shared by
+          // the members of the group on the node.
+          const double left_tiles = left_density_ * double(m_ * k_) / rows * (cols - 1.0) / cols;
+          const double right_tiles = right_density_ * double(k_ * n_) / cols * (rows - 1.0) / rows;
+          const double bytes = left_density_ * left_bytes_ / rows * (row_nodes - 1.0) / row_nodes / row_members
+              + right_density_ * right_bytes_ / cols * (col_nodes - 1.0) / col_nodes / col_members;
+
+          // Each step waits for a row and a column broadcast
+          const double depth = bcast_depth(row_nodes, row_members) + bcast_depth(col_nodes, col_members);
+
+          return flops_ * left_density_ * right_density_ / (rows * cols) / flop_rate_value()
+              + bytes / bandwidth_value()
+              + (left_tiles + right_tiles + double(k_) * depth) * latency_value();
+        }
+
+        /// Estimate the VSpGemm run time
+        double vspgemm_cost() const {
+          const double rows = proc_rows_;
+          const double cols = proc_cols_;
+          const double remote = double(procs_ - 1ul) / double(procs_);
+
+          // A left tile is needed when at least one of the right tiles it is
+          // contracted with on this process is non-zero, and vice versa.
+          const double left_used = 1.0 - std::pow(1.0 - right_density_, double(n_) / cols);
+          const double right_used = 1.0 - std::pow(1.0 - left_density_, double(m_) / rows);
+
+          const double left_tiles = left_density_ * left_used * double(m_ * k_) / rows * remote;
+          const double right_tiles = right_density_ * right_used * double(k_ * n_) / cols * remote;
+          const double bytes = (left_density_ * left_used * left_bytes_ / rows
+              + right_density_ * right_used * right_bytes_ / cols) * remote;
+
+          return flops_ * left_density_ * right_density_ / (rows * cols) / flop_rate_value()
+              + bytes / bandwidth_value()
+              + 2.0 * (left_tiles + right_tiles) * latency_value();
+        }
+
+      public:
+
+        /// Default constructor
+
+        /// Constructs an empty selection, which selects SUMMA
+        ContractionDispatch() :
+          procs_(0ul), procs_per_node_(1ul), m_(0ul), k_(0ul), n_(0ul),
+          proc_rows_(0ul), proc_cols_(0ul),
+          flops_(0.0), left_bytes_(0.0), right_bytes_(0.0),
+          left_density_(1.0), right_density_(1.0),
+          summa_cost_(0.0), vspgemm_cost_(0.0), engine_(summa_engine)
+        { }
+
+        /// Constructor
+
+        /// \param procs The number of processes
+        /// \param m The number of tile rows in the left argument
+        /// \param k The number of tiles in the contracted dimensions
+        /// \param n The number of tile columns in the right argument
+        /// \param flops The flop count of the contraction if both arguments
+        /// are dense
+        /// \param left_bytes The size of the left argument in bytes if it is dense
+        /// \param right_bytes The size of the right argument in bytes if it is dense
+        /// \param left_density The fraction of non-zero tiles in the left argument
+        /// \param right_density The fraction of non-zero tiles in the right argument
+        /// \param nodes The number of nodes that hold the processes, where
+        /// consecutive ranks share a node, or zero when each process is on its
+        /// own node [ default = 0 ]
+        ContractionDispatch(const size_type procs, const size_type m, const size_type k,
+            const size_type n, const double flops, const double left_bytes,
+            const double right_bytes, const double left_density, const double right_density,
+            const size_type nodes = 0ul) :
+          procs_(procs), procs_per_node_(nodes ? (procs + nodes - 1ul) / nodes : 1ul),
+          m_(m), k_(k), n_(n), proc_rows_(0ul), proc_cols_(0ul),
+          flops_(flops), left_bytes_(left_bytes), right_bytes_(right_bytes),
+          left_density_(std::min(std::max(left_density, 0.0), 1.0)),
+          right_density_(std::min(std::max(right_density, 0.0), 1.0)),
+          summa_cost_(0.0), vspgemm_cost_(0.0), engine_(summa_engine)
+        {
+          TA_ASSERT(procs_ > 0ul);
+          TA_ASSERT(m_ > 0ul);
+          TA_ASSERT(k_ > 0ul);
+          TA_ASSERT(n_ > 0ul);
+
+          TA_ASSERT(nodes <= procs_);
+
+          // The process grid used by ContractionTensorImpl
+          TiledArray::detail::contraction_proc_grid(procs_, m_, n_, proc_rows_, proc_cols_);
+
+          summa_cost_ = summa_cost();
+          vspgemm_cost_ = vspgemm_cost();
+          engine_ = (summa_cost_ <= vspgemm_cost_ ? summa_engine : vspgemm_engine);
+        }
+
+        /// The selected algorithm
+        engine_type engine() const { return engine_; }
+
+        /// Estimated run time of an algorithm
+
+        /// \param engine The algorithm
+        /// \return The estimated run time in seconds
+        double cost(const engine_type engine) const {
+          return (engine == summa_engine ? summa_cost_ : vspgemm_cost_);
+        }
+
+        /// The number of processes
+        size_type procs() const { return procs_; }
+
+        /// The number of processes on each node
+        size_type procs_per_node() const { return procs_per_node_; }
+
+        /// The number of rows in the process grid
+        size_type proc_rows() const { return proc_rows_; }
+
+        /// The number of columns in the process grid
+        size_type proc_cols() const { return proc_cols_; }
+
+        /// The fraction of non-zero tiles in the left argument
+        double left_density() const { return left_density_; }
+
+        /// The fraction of non-zero tiles in the right argument
+        double right_density() const { return right_density_; }
+
+        /// Name of an algorithm
+
+        /// \param engine The algorithm
+        /// \return The name of \c engine
+        static const char* name(const engine_type engine) {
+          return (engine == summa_engine ? "summa" : "vspgemm");
+        }
+
+        /// Record this selection
+
+        /// This selection is stored as the most recent selection, and it is
+        /// written to the log stream when one has been set.
+        void record() const {
+          madness::ScopedMutex<madness::Mutex> locker(mutex());
+          last_value() = *this;
+          if(log_value())
+            *log_value() << *this << "\n";
+        }
+
+        /// The most recent recorded selection of this process
+        static ContractionDispatch_ last() {
+          madness::ScopedMutex<madness::Mutex> locker(mutex());
+          return last_value();
+        }
+
+        /// Set the log stream
+
+        /// \param os The stream that recorded selections are written to, or
+        /// \c NULL to disable logging
+        static void log(std::ostream* os) {
+          madness::ScopedMutex<madness::Mutex> locker(mutex());
+          log_value() = os;
+        }
+
+        /// Message latency accessor
+
+        /// \return The time to send a message, in seconds
+        static double latency() { return latency_value(); }
+
+        /// Set the message latency
+
+        /// \param value The time to send a message, in seconds
+        /// \throw TiledArray::Exception When \c value is negative
+        static void latency(const double value) {
+          TA_USER_ASSERT(value >= 0.0, "The message latency must not be negative.");
+          latency_value() = value;
+        }
+
+        /// Network bandwidth accessor
+
+        /// \return The bandwidth of a process, in bytes per second
+        static double bandwidth() { return bandwidth_value(); }
+
+        /// Set the network bandwidth
+
+        /// \param value The bandwidth of a process, in bytes per second
+        /// \throw TiledArray::Exception When \c value is not positive
+        static void bandwidth(const double value) {
+          TA_USER_ASSERT(value > 0.0, "The network bandwidth must be greater than zero.");
+          bandwidth_value() = value;
+        }
+
+        /// Flop rate accessor
+
+        /// \return The flop rate of a process, in flops per second
+        static double flop_rate() { return flop_rate_value(); }
+
+        /// Set the flop rate
+
+        /// \param value The flop rate of a process, in flops per second
+        /// \throw TiledArray::Exception When \c value is not positive
+        static void flop_rate(const double value) {
+          TA_USER_ASSERT(value > 0.0, "The flop rate must be greater than zero.");
+          flop_rate_value() = value;
+        }
+
+        friend std::ostream& operator<<(std::ostream& os, const ContractionDispatch_& d) {
+          os << "contraction m=" << d.m_ << " k=" << d.k_ << " n=" << d.n_
+              << " density=(" << d.left_density_ << "," << d.right_density_ << ")"
+              << " procs=" << d.procs_ << " (" << d.proc_rows_ << "x" << d.proc_cols_ << ")"
+              << " ppn=" << d.procs_per_node_
+              << " summa=" << d.summa_cost_ << "s vspgemm=" << d.vspgemm_cost_ << "s -> "
+              << name(d.engine_);
+          return os;
+        }
+
+      }; // class ContractionDispatch
+
+      /// Construct the contraction algorithm selection for a pair of tensor expressions
+
+      /// \tparam LExp The left tensor expression type
+      /// \tparam RExp The right tensor expression type
+      /// \param left The left tensor expression
+      /// \param right The right tensor expression
+      /// \return The algorithm selection for <tt>left * right</tt>
+      template <typename LExp, typename RExp>
+      ContractionDispatch make_contraction_dispatch(const LExp& left, const RExp& right) {
+        // Split the left dimensions into outer (m) and contracted (k) dimensions
+        std::size_t m = 1ul, k = 1ul;
+        double elements_m = 1.0, elements_k = 1.0;
+        const std::vector<std::string>& left_vars = left.vars().data();
+        const std::vector<std::string>& right_vars = right.vars().data();
+        for(std::size_t i = 0ul; i < left_vars.size(); ++i) {
+          const std::size_t tiles = left.trange().tiles().size()[i];
+          const double elements = left.trange().elements().size()[i];
+          if(std::find(right_vars.begin(), right_vars.end(), left_vars[i]) != right_vars.end()) {
+            k *= tiles;
+            elements_k *= elements;
+          } else {
+            m *= tiles;
+            elements_m *= elements;
+          }
+        }
+        const std::size_t n = right.trange().tiles().volume() / k;
+        const double elements_n = double(right.trange().elements().volume()) / elements_k;
+
+        // Node ids are numbered from zero
+        const std::vector<int> node_ids = TiledArray::detail::node_ids(left.get_world());
+        const std::size_t nodes = *std::max_element(node_ids.begin(), node_ids.end()) + 1;
+
+        return ContractionDispatch(left.get_world().size(), m, k, n,
+            2.0 * elements_m * elements_k * elements_n,
+            elements_m * elements_k * sizeof(typename LExp::value_type::value_type),
+            elements_k * elements_n * sizeof(typename RExp::value_type::value_type),
+            left.density(), right.density(), nodes);
+      }
+
+    } // namespace detail
+  } // namespace expressions
+} // namespace TiledArray
+
+#endif // TILEDARRAY_CONTRACTION_DISPATCH_H__INCLUDED
@@ -0,0 +1,428 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEDARRAY_CONTRACTION_ORDER_H__INCLUDED
+#define TILEDARRAY_CONTRACTION_ORDER_H__INCLUDED
+
+#include <TiledArray/tensor_expression.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <sstream>
+
+namespace TiledArray {
+  namespace expressions {
+    namespace detail {
+
+      /// Contraction order optimizer
+
+      /// This object finds the pairwise contraction order for a product of
+      /// three or more tensors that minimizes the estimated number of floating
+      /// point operations. Each variable may appear in at most two operands;
+      /// variables that appear in two operands are summed, and variables that
+      /// appear in one operand are indices of the result. The cost of
+      /// contracting a pair of tensors is
+      /// \f$ 2 \times \prod_{v} n_v \times \rho_L \times \rho_R \f$, where the
+      /// product is over all the variables of the pair and \f$ \rho \f$ is the
+      /// fraction of non-zero tiles. The density of an intermediate is
+      /// estimated as \f$ 1 - (1 - \rho_L \rho_R)^{k} \f$, where \f$ k \f$ is
+      /// the number of tiles in the contracted dimensions. The optimal order is
+      /// found by dynamic programming over all subsets of the operands, so the
+      /// number of operands is limited to \c max_operands .
+      class ContractionOrder {
+      public:
+        typedef std::size_t size_type; ///< Size type
+        typedef unsigned long mask_type; ///< Operand subset bit mask type
+
+        static const size_type max_operands = 12ul; ///< The maximum number of operands
+
+      private:
+
+        /// Cost and layout data for a subset of operands
+        struct Node {
+          Node() :
+            flops(std::numeric_limits<double>::infinity()), density(1.0),
+            left(0ul), right(0ul), vars()
+          { }
+
+          double flops; ///< Estimated flop count to evaluate the subset
+          double density; ///< Estimated fraction of non-zero tiles
+          mask_type left; ///< The left-hand operand subset
+          mask_type right; ///< The right-hand operand subset
+          std::vector<std::string> vars; ///< The result variables of the subset
+        }; // struct Node
+
+        std::vector<std::vector<std::string> > operands_; ///< The operand variable lists
+        std::vector<double> densities_; ///< The operand densities
+        std::map<std::string, double> elements_; ///< The number of elements for each variable
+        std::map<std::string, double> tiles_; ///< The number of tiles for each variable
+        std::map<std::string, unsigned int> count_; ///< The number of operands that contain each variable
+        std::vector<Node> nodes_; ///< Optimal contraction for each subset of operands
+
+        /// Construct the result variable list of a pairwise contraction
+
+        /// The result variables are the variables that are not summed by the
+        /// contraction, in the order of the contraction result.
+        /// \param left The left-hand subset
+        /// \param right The right-hand subset
+        /// \param[out] vars The result variables
+        void make_vars(const Node& left, const Node& right, std::vector<std::string>& vars) const {
+          vars.clear();
+          for(std::vector<std::string>::const_iterator it = left.vars.begin(); it != left.vars.end(); ++it)
+            if(std::find(right.vars.begin(), right.vars.end(), *it) == right.vars.end())
+              vars.push_back(*it);
+          for(std::vector<std::string>::const_iterator it = right.vars.begin(); it != right.vars.end(); ++it)
+            if(std::find(left.vars.begin(), left.vars.end(), *it) == left.vars.end())
+              vars.push_back(*it);
+        }
+
+        /// Number of tiles in the dimensions summed by a pair of subsets
+        double inner_tiles(const Node& left, const Node& right) const {
+          double k = 1.0;
+          bool connected = false;
+          for(std::vector<std::string>::const_iterator it = left.vars.begin(); it != left.vars.end(); ++it)
+            if(std::find(right.vars.begin(), right.vars.end(), *it) != right.vars.end()) {
+              k *= tiles_.find(*it)->second;
+              connected = true;
+            }
+          return (connected ? k : 0.0);
+        }
+
+        /// Estimated flop count for contracting a pair of subsets
+        double pair_flops(const Node& left, const Node& right) const {
+          double n = 2.0 * left.density * right.density;
+          for(std::vector<std::string>::const_iterator it = left.vars.begin(); it != left.vars.end(); ++it)
+            n *= elements_.find(*it)->second;
+          for(std::vector<std::string>::const_iterator it = right.vars.begin(); it != right.vars.end(); ++it)
+            if(std::find(left.vars.begin(), left.vars.end(), *it) == left.vars.end())
+              n *= elements_.find(*it)->second;
+          return n;
+        }
+
+        void print(std::ostream& os, const mask_type s) const {
+          const Node& node = nodes_[s];
+          if(node.left == 0ul) {
+            size_type i = 0ul;
+            while(! ((s >> i) & 1ul))
+              ++i;
+            os << i;
+          } else {
+            os << "(";
+            print(os, node.left);
+            os << "*";
+            print(os, node.right);
+            os << ")";
+          }
+        }
+
+      public:
+
+        ContractionOrder() :
+          operands_(), densities_(), elements_(), tiles_(), count_(), nodes_()
+        { }
+
+        /// Add an operand
+
+        /// \param vars The variable list of the operand
+        /// \param elements The number of elements in each dimension of the operand
+        /// \param tiles The number of tiles in each dimension of the operand
+        /// \param density The fraction of non-zero tiles in the operand
+        /// \return The index of the operand
+        /// \throw TiledArray::Exception When a variable has different extents
+        /// in two operands or appears in more than two operands.
+        size_type add(const VariableList& vars, const std::vector<std::size_t>& elements,
+            const std::vector<std::size_t>& tiles, const double density)
+        {
+          TA_ASSERT(vars.dim() == elements.size());
+          TA_ASSERT(vars.dim() == tiles.size());
+          TA_USER_ASSERT(operands_.size() < max_operands,
+              "Too many operands for the contraction order optimizer.");
+
+          for(unsigned int i = 0u; i < vars.dim(); ++i) {
+            const std::string& var = vars.data()[i];
+            if(count_[var]++) {
+              TA_USER_ASSERT(elements_[var] == double(elements[i]),
+                  "Contracted dimensions have different sizes.");
+              TA_USER_ASSERT(count_[var] <= 2u,
+                  "A variable may not appear in more than two contraction operands.");
+            } else {
+              elements_[var] = double(elements[i]);
+              tiles_[var] = double(tiles[i]);
+            }
+          }
+
+          operands_.push_back(vars.data());
+          densities_.push_back(std::min(std::max(density, 0.0), 1.0));
+          nodes_.clear();
+
+          return operands_.size() - 1ul;
+        }
+
+        /// Number of operands
+        size_type size() const { return operands_.size(); }
+
+        /// Find the optimal contraction order
+
+        /// \throw TiledArray::Exception When the operands can not be evaluated
+        /// without an outer product.
+        void optimize() {
+          TA_USER_ASSERT(operands_.size() > 0ul, "No operands for the contraction.");
+
+          const mask_type full = (1ul << operands_.size()) - 1ul;
+          nodes_.assign(full + 1ul, Node());
+
+          // Initialize the leaf nodes
+          for(size_type i = 0ul; i < operands_.size(); ++i) {
+            Node& node = nodes_[1ul << i];
+            node.flops = 0.0;
+            node.density = densities_[i];
+            node.vars = operands_[i];
+          }
+
+          // Subsets are visited in increasing order, so all proper subsets of
+          // s have been optimized before s.
+          for(mask_type s = 1ul; s <= full; ++s) {
+            if((s & (s - 1ul)) == 0ul)
+              continue;
+            Node& node = nodes_[s];
+
+            // Visit each unordered partition of s once
+            for(mask_type l = (s - 1ul) & s; l != 0ul; l = (l - 1ul) & s) {
+              const mask_type r = s ^ l;
+              if(l > r)
+                continue;
+
+              const Node& left = nodes_[l];
+              const Node& right = nodes_[r];
+              if(left.flops == std::numeric_limits<double>::infinity() ||
+                  right.flops == std::numeric_limits<double>::infinity())
+                continue;
+
+              // Outer products are not supported by the contraction engine
+              const double k = inner_tiles(left, right);
+              if(k == 0.0)
+                continue;
+
+              const double flops = left.flops + right.flops + pair_flops(left, right);
+              if(flops < node.flops) {
+                node.flops = flops;
+                node.left = l;
+                node.right = r;
+                node.density = 1.0 - std::pow(1.0 - left.density * right.density, k);
+              }
+            }
+
+            if(node.left != 0ul)
+              make_vars(nodes_[node.left], nodes_[node.right], node.vars);
+          }
+
+          TA_USER_ASSERT(nodes_[full].flops != std::numeric_limits<double>::infinity(),
+              "The contraction operands are not connected by common variables.");
+        }
+
+        /// The complete operand set
+        mask_type root() const { return (1ul << operands_.size()) - 1ul; }
+
+        /// Left-hand subset of the optimal contraction of subset \c s
+
+        /// \return The left-hand subset, or zero if \c s is a single operand
+        mask_type left(const mask_type s) const {
+          TA_ASSERT(s < nodes_.size());
+          return nodes_[s].left;
+        }
+
+        /// Right-hand subset of the optimal contraction of subset \c s
+
+        /// \return The right-hand subset, or zero if \c s is a single operand
+        mask_type right(const mask_type s) const {
+          TA_ASSERT(s < nodes_.size());
+          return nodes_[s].right;
+        }
+
+        /// Estimated flop count of the optimal contraction
+        double flops() const {
+          TA_ASSERT(! nodes_.empty());
+          return nodes_.back().flops;
+        }
+
+        /// Estimated density of the contraction result
+        double density() const {
+          TA_ASSERT(! nodes_.empty());
+          return nodes_.back().density;
+        }
+
+        /// Convert the optimal contraction order to a string
+
+        /// \return A string like <tt>((0*1)*2)</tt>, where the numbers are
+        /// operand indices
+        std::string str() const {
+          TA_ASSERT(! nodes_.empty());
+          std::stringstream ss;
+          print(ss, root());
+          return ss.str();
+        }
+
+      }; // class ContractionOrder
+
+      /// Count the operands that must be permuted to contract \c left and \c right
+
+      /// The contraction engine expects the left-hand variables to be ordered
+      /// as [outer, inner] and the right-hand variables as [inner, outer],
+      /// with the inner variables in the left-hand order.
+      /// \param left The left-hand variable list
+      /// \param right The right-hand variable list
+      /// \return The number of operands (0, 1, or 2) that must be permuted
+      inline unsigned int contraction_permutations(const VariableList& left, const VariableList& right) {
+        std::vector<std::string> outer, inner, right_outer;
+        for(VariableList::const_iterator it = left.begin(); it != left.end(); ++it) {
+          if(std::find(right.begin(), right.end(), *it) == right.end())
+            outer.push_back(*it);
+          else
+            inner.push_back(*it);
+        }
+        for(VariableList::const_iterator it = right.begin(); it != right.end(); ++it)
+          if(std::find(left.begin(), left.end(), *it) == left.end())
+            right_outer.push_back(*it);
+
+        // Expected left layout: [outer, inner]
+        std::vector<std::string> expected(outer);
+        expected.insert(expected.end(), inner.begin(), inner.end());
+        unsigned int n = (std::equal(expected.begin(), expected.end(), left.begin()) ? 0u : 1u);
+
+        // Expected right layout: [inner, outer]
+        expected = inner;
+        expected.insert(expected.end(), right_outer.begin(), right_outer.end());
+        n += (std::equal(expected.begin(), expected.end(), right.begin()) ? 0u : 1u);
+
+        return n;
+      }
+
+      /// Build the contraction expression for a subset of operands
+
+      /// At each pairwise contraction, the operand order that requires the
+      /// fewest permutations is used.
+      /// \tparam Exp The tensor expression type
+      /// \param order The optimized contraction order
+      /// \param operands The operand expressions
+      /// \param s The subset to build
+      /// \return The contraction expression for \c s
+      template <typename Exp>
+      Exp build_contraction(const ContractionOrder& order, const std::vector<Exp>& operands,
+          const ContractionOrder::mask_type s)
+      {
+        if(order.left(s) == 0ul) {
+          std::size_t i = 0ul;
+          while(! ((s >> i) & 1ul))
+            ++i;
+          return operands[i];
+        }
+
+        Exp left = build_contraction(order, operands, order.left(s));
+        Exp right = build_contraction(order, operands, order.right(s));
+
+        if(contraction_permutations(right.vars(), left.vars()) < contraction_permutations(left.vars(), right.vars()))
+          return right * left;
+        return left * right;
+      }
+
+      /// Construct the contraction order optimizer for a list of tensor expressions
+
+      /// \tparam Exp The tensor expression type
+      /// \param operands The operand expressions
+      /// \return An optimized contraction order for \c operands
+      template <typename Exp>
+      ContractionOrder make_contraction_order(const std::vector<Exp>& operands) {
+        ContractionOrder order;
+        for(typename std::vector<Exp>::const_iterator it = operands.begin(); it != operands.end(); ++it) {
+          const unsigned int dim = it->vars().dim();
+          std::vector<std::size_t> elements(it->trange().elements().size().begin(),
+              it->trange().elements().size().end());
+          std::vector<std::size_t> tiles(it->trange().tiles().size().begin(),
+              it->trange().tiles().size().end());
+          TA_ASSERT(elements.size() == dim);
+          TA_ASSERT(tiles.size() == dim);
+          order.add(it->vars(), elements, tiles, it->density());
+        }
+        order.optimize();
+        return order;
+      }
+
+    } // namespace detail
+
+    /// Contract a chain of tensor expressions in the optimal order
+
+    /// Contract all \c operands , where variables that appear in two operands
+    /// are summed. The pairwise contraction order is chosen to minimize the
+    /// estimated number of floating point operations, using the dimensions and
+    /// the tile densities of the operands. For example, a product of three
+    /// matrices <tt>a("i,j") * b("j,k") * c("k,l")</tt> is evaluated as
+    /// <tt>a * (b * c)</tt> when that is cheaper, while the expression
+    /// operator* always evaluates from left to right.
+    /// \tparam Tile The tile type of the operands, which must be the
+    /// contraction result tile type (e.g. \c Tensor<T> )
+    /// \param operands The operand expressions
+    /// \return A tensor expression for the complete contraction
+    /// \throw TiledArray::Exception When the operands are not connected by
+    /// common variables, or when there are more than
+    /// \c detail::ContractionOrder::max_operands operands.
+    template <typename Tile>
+    inline TensorExpression<Tile> contract(const std::vector<TensorExpression<Tile> >& operands) {
+      const detail::ContractionOrder order = detail::make_contraction_order(operands);
+      return detail::build_contraction(order, operands, order.root());
+    }
+
+    /// Contract three tensor expressions in the optimal order
+
+    /// \sa contract(const std::vector<TensorExpression<Tile> >&)
+    template <typename Tile>
+    inline TensorExpression<Tile> contract(const TensorExpression<Tile>& a,
+        const TensorExpression<Tile>& b, const TensorExpression<Tile>& c)
+    {
+      std::vector<TensorExpression<Tile> > operands;
+      operands.reserve(3ul);
+      operands.push_back(a);
+      operands.push_back(b);
+      operands.push_back(c);
+      return contract(operands);
+    }
+
+    /// Contract four tensor expressions in the optimal order
+
+    /// \sa contract(const std::vector<TensorExpression<Tile> >&)
+    template <typename Tile>
+    inline TensorExpression<Tile> contract(const TensorExpression<Tile>& a,
+        const TensorExpression<Tile>& b, const TensorExpression<Tile>& c,
+        const TensorExpression<Tile>& d)
+    {
+      std::vector<TensorExpression<Tile> > operands;
+      operands.reserve(4ul);
+      operands.push_back(a);
+      operands.push_back(b);
+      operands.push_back(c);
+      operands.push_back(d);
+      return contract(operands);
+    }
+
+  } // namespace expressions
+} // namespace TiledArray
+
+#endif // TILEDARRAY_CONTRACTION_ORDER_H__INCLUDED
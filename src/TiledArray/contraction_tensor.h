@@ -22,19 +22,35 @@
 
 #include <TiledArray/summa.h>
 #include <TiledArray/vspgemm.h>
+#include <TiledArray/contraction_dispatch.h>
 
 namespace TiledArray {
   namespace expressions {
 
+    /// Construct a contraction expression
+
+    /// The contraction algorithm is selected by \c detail::ContractionDispatch ,
+    /// from the argument densities, sizes, and the number of processes. The
+    /// selection is recorded, so it can be queried with
+    /// \c detail::ContractionDispatch::last() .
+    /// \tparam LExp The left tensor expression type
+    /// \tparam RExp The right tensor expression type
+    /// \param left The left tensor expression
+    /// \param right The right tensor expression
+    /// \return The contraction expression <tt>left * right</tt>
     template <typename LExp, typename RExp>
     typename detail::ContractionExp<LExp, RExp>::type
     make_contraction_tensor(const LExp& left, const RExp& right) {
       // Define the base impl type
       typedef detail::TensorExpressionImpl<typename detail::ContractionResult<LExp, RExp>::type> impl_type;
 
+      // Select the contraction algorithm
+      const detail::ContractionDispatch dispatch = detail::make_contraction_dispatch(left, right);
+      dispatch.record();
+
       // Create the implementation pointer
       impl_type* pimpl = NULL;
-      if(left.is_dense() && right.is_dense())
+      if(dispatch.engine() == detail::ContractionDispatch::summa_engine)
         pimpl = new Summa<LExp, RExp>(left, right);
       else
         pimpl = new VSpGemm<LExp, RExp>(left, right);
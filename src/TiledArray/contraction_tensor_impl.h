@@ -24,6 +24,8 @@
 #include <TiledArray/tensor.h>
 #include <TiledArray/pmap/cyclic_pmap.h>
 #include <TiledArray/math/math.h>
+#include <TiledArray/math/team.h>
+#include <TiledArray/shape_contract.h>
 #include <TiledArray/annotated_tensor.h>
 
 namespace TiledArray {
@@ -296,8 +298,7 @@ namespace TiledArray {
         right_outer_ = right_.range().dim() - right_inner_;
 
         // Calculate the process map dimensions and size
-        proc_cols_ = std::min(size_ / std::max(std::min<std::size_t>(std::sqrt(size_ * m_ / n_), size_), 1ul), n_);
-        proc_rows_ = std::min(size_ / proc_cols_, m_);
+        TiledArray::detail::contraction_proc_grid(size_, m_, n_, proc_rows_, proc_cols_);
         proc_size_ = proc_cols_ * proc_rows_;
 
         // Set an empty shape if sparse
@@ -326,6 +327,47 @@ namespace TiledArray {
 
       right_tensor_type& right() { return right_; }
 
+      /// Write the structural key of this expression
+
+      /// \param os The output stream for the key
+      virtual void make_key(std::ostream& os) const {
+        os << "C(";
+        left_.make_key(os);
+        os << ",";
+        right_.make_key(os);
+        os << ")";
+        TensorExpressionImpl_::make_key_suffix(os);
+      }
+
+      /// Collect the arrays read by this expression
+
+      /// \param[out] arrays The addresses of the arrays read by this
+      /// expression are appended to this list
+      virtual void collect_arrays(std::vector<const void*>& arrays) const {
+        left_.collect_arrays(arrays);
+        right_.collect_arrays(arrays);
+      }
+
+      /// Preferred process map for the result tiles
+
+      /// \return The cyclic process map of the process grid that computes the
+      /// result tiles
+      virtual std::shared_ptr<pmap_interface> result_pmap() const {
+        return std::shared_ptr<pmap_interface>(new TiledArray::detail::CyclicPmap(
+            TensorImpl_::get_world(), m_, n_, proc_rows_, proc_cols_));
+      }
+
+      /// Estimated tile density
+
+      /// \return The fraction of non-zero tiles once this tensor has been
+      /// evaluated, or before then the probability that at least one of the
+      /// tile products that are summed into a result tile is non-zero
+      virtual double density() const {
+        if(TensorImpl_::is_dense() || TensorExpressionImpl_::is_evaluated())
+          return TensorExpressionImpl_::density();
+        return 1.0 - std::pow(1.0 - left_.density() * right_.density(), double(k_));
+      }
+
     private:
 
       template <typename InIter>
@@ -395,7 +437,9 @@ namespace TiledArray {
         const size_type n = product(right.range().size().begin() + right_inner_, right.range().size().end());
 
         // Do the contraction
-        math::gemm(m, n, k, TensorExpressionImpl_::scale(), left.data(),
+        TA_PROFILE_SCOPE("contract");
+        TA_PROFILE_FLOPS("contract", 2.0 * double(m) * double(n) * double(k));
+        math::team_gemm(m, n, k, TensorExpressionImpl_::scale(), left.data(),
             right.data(), result.data());
       }
 
@@ -404,45 +448,13 @@ namespace TiledArray {
       virtual void make_shape(shape_type& shape) const {
         TA_ASSERT(shape.size() == (m_ * n_));
 
-        typedef Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> matrix_type;
-
-        // Construct map objects for the shapes
+        // Empty shapes are used for dense arguments
+        const shape_type left_shape(left_.is_dense() ? shape_type(0ul) : left_.get_shape());
+        const shape_type right_shape(right_.is_dense() ? shape_type(0ul) : right_.get_shape());
 
-        // Construct the left shape to its map
-        matrix_type left_map(m_, k_);
-        if(left_.is_dense())
-          left_map.fill(1);
-        else {
-          const shape_type left_shape(left_.get_shape());
-          for(std::size_t i = 0; i < m_; ++i)
-            for(std::size_t j = 0; j < k_; ++j)
-              left_map(i, j) = (left_shape[i * k_ + j] ? 1 : 0);
-        }
-
-        // Construct the right shape to its map
-        matrix_type right_map(k_, n_);
-        if(right_.is_dense())
-          right_map.fill(1);
-        else {
-          const shape_type right_shape(right_.get_shape());
-          for(std::size_t i = 0; i < k_; ++i)
-            for(std::size_t j = 0; j < n_; ++j)
-              right_map(i, j) = (right_shape[i * n_ + j] ? 1 : 0);
-        }
-
-        // Construct the new shape
-
-        matrix_type res_map = left_map * right_map;
-
-        // Update the shape
-        for(std::size_t i = 0; i < m_; ++i)
-          for(std::size_t j = 0; j < n_; ++j)
-            if(res_map(i,j))
-              shape.set(i * n_ + j);
+        contract_shape(shape, left_shape, right_shape, m_, k_, n_);
       }
 
-
-
       /// Construct the left argument process map
       virtual std::shared_ptr<pmap_interface> make_left_pmap() const {
         return std::shared_ptr<pmap_interface>(new TiledArray::detail::CyclicPmap(
@@ -0,0 +1,239 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEDARRAY_COO_H__INCLUDED
+#define TILEDARRAY_COO_H__INCLUDED
+
+#include <TiledArray/madness.h>
+#include <TiledArray/bitset.h>
+#include <TiledArray/pmap/blocked_pmap.h>
+#include <vector>
+#include <map>
+
+namespace TiledArray {
+  namespace detail {
+
+    /// Exchange coordinate list elements between the owners of array tiles
+
+    /// Elements are sent with one message per destination process. Each
+    /// process collects the elements of its local tiles, and then assembles the
+    /// tiles with one task per tile.
+    /// \tparam A The array type
+    template <typename A>
+    class CooExchange : public madness::WorldObject<CooExchange<A> >, private madness::Spinlock {
+    public:
+      typedef CooExchange<A> CooExchange_; ///< This object type
+      typedef madness::WorldObject<CooExchange_> wobj_type; ///< The base object type
+      typedef typename A::size_type size_type; ///< Size type
+      typedef typename A::element_type element_type; ///< Element type
+      typedef typename A::value_type value_type; ///< Tile type
+      typedef std::vector<std::pair<size_type, element_type> > element_list; ///< List of (tile offset, value) pairs
+
+    private:
+      std::map<size_type, element_list> tiles_; ///< The elements of the local tiles
+
+      // Not allowed
+      CooExchange(const CooExchange_&);
+      CooExchange_& operator=(const CooExchange_&);
+
+      /// Store the elements sent to this process
+
+      /// \param tiles The tile ordinal index of each element
+      /// \param offsets The offset of each element in its tile
+      /// \param values The element values
+      void receive(const std::vector<size_type>& tiles, const std::vector<size_type>& offsets,
+          const std::vector<element_type>& values)
+      {
+        TA_ASSERT(tiles.size() == offsets.size());
+        TA_ASSERT(tiles.size() == values.size());
+        madness::ScopedMutex<madness::Spinlock> locker(this);
+        for(std::size_t i = 0ul; i < tiles.size(); ++i)
+          tiles_[tiles[i]].push_back(std::make_pair(offsets[i], values[i]));
+      }
+
+      /// Task function that assembles a tile
+
+      /// Elements that appear more than once are summed.
+      /// \param range The tile range
+      /// \param elements The (tile offset, value) pairs of the tile
+      /// \return The tile
+      static value_type make_tile(const typename value_type::range_type& range,
+          const element_list& elements)
+      {
+        value_type tile(range, element_type(0));
+        for(typename element_list::const_iterator it = elements.begin(); it != elements.end(); ++it)
+          tile[it->first] += it->second;
+        return tile;
+      }
+
+      /// Task that assembles a tile
+
+      /// The element list is moved into the task instead of being copied.
+      class MakeTileTask : public madness::TaskInterface {
+      private:
+        const typename value_type::range_type range_; ///< The tile range
+        element_list elements_; ///< The (tile offset, value) pairs of the tile
+        madness::Future<value_type> result_; ///< The tile
+
+      public:
+        /// Constructor
+
+        /// \param range The tile range
+        /// \param[in,out] elements The elements of the tile, which are swapped
+        /// into the task and left empty
+        MakeTileTask(const typename value_type::range_type& range, element_list& elements) :
+          madness::TaskInterface(madness::TaskAttributes()), range_(range), elements_(), result_()
+        {
+          elements_.swap(elements);
+        }
+
+        virtual ~MakeTileTask() { }
+
+        /// The assembled tile
+        const madness::Future<value_type>& result() const { return result_; }
+
+        virtual void run(const madness::TaskThreadEnv&) {
+          result_.set(make_tile(range_, elements_));
+        }
+      }; // class MakeTileTask
+
+    public:
+
+      /// Constructor
+
+      /// \param world The world where the array lives
+      CooExchange(madness::World& world) :
+        wobj_type(world), madness::Spinlock(), tiles_()
+      {
+        wobj_type::process_pending();
+      }
+
+      virtual ~CooExchange() { }
+
+      /// Send elements to the owner of their tiles
+
+      /// \param owner The destination process
+      /// \param tiles The tile ordinal index of each element
+      /// \param offsets The offset of each element in its tile
+      /// \param values The element values
+      void send(const ProcessID owner, const std::vector<size_type>& tiles,
+          const std::vector<size_type>& offsets, const std::vector<element_type>& values)
+      {
+        if(owner == wobj_type::get_world().rank())
+          receive(tiles, offsets, values);
+        else
+          wobj_type::task(owner, & CooExchange_::receive, tiles, offsets, values);
+      }
+
+      /// Assemble the local tiles
+
+      /// This must be called after all elements have been received, i.e.
+      /// after a global fence.
+      /// \param array The array that will hold the tiles
+      void assemble(A& array) {
+        madness::ScopedMutex<madness::Spinlock> locker(this);
+        for(typename std::map<size_type, element_list>::iterator it = tiles_.begin();
+            it != tiles_.end(); ++it)
+        {
+          MakeTileTask* task = new MakeTileTask(array.trange().make_tile_range(it->first), it->second);
+          array.set(it->first, task->result());
+          wobj_type::get_world().taskq.add(task);
+        }
+        tiles_.clear();
+      }
+
+    }; // class CooExchange
+
+  } // namespace detail
+
+  /// Construct a sparse array from a coordinate list of elements
+
+  /// This is a collective operation. Each process may supply any elements
+  /// of the array, in any order. The elements are grouped by tile and owner,
+  /// sent to the tile owners with one message per destination process, and
+  /// the tiles and the array shape are then assembled in parallel. Tiles that
+  /// do not contain an element are zero; elements that are given more than
+  /// once are summed.
+  /// \tparam A The array type
+  /// \param world The world where the array will live
+  /// \param tr The tiled range of the array
+  /// \param elements The local list of (element index, value) pairs
+  /// \param pmap The tile index -> process map [ Default = blocked process map ]
+  /// \return A sparse array that contains \c elements
+  /// \throw TiledArray::Exception When an element index is outside \c tr
+  template <typename A>
+  inline A coo_to_array(madness::World& world, const typename A::trange_type& tr,
+      const std::vector<std::pair<typename A::index, typename A::element_type> >& elements,
+      std::shared_ptr<typename A::pmap_interface> pmap = std::shared_ptr<typename A::pmap_interface>())
+  {
+    typedef typename A::size_type size_type;
+    typedef typename A::element_type element_type;
+    typedef std::vector<std::pair<typename A::index, element_type> > element_list;
+
+    if(! pmap)
+      pmap.reset(new detail::BlockedPmap(world, tr.tiles().volume()));
+
+    // Group the elements by owner and mark the non-zero tiles
+    const std::size_t procs = world.size();
+    std::vector<std::vector<size_type> > tiles(procs), offsets(procs);
+    std::vector<std::vector<element_type> > values(procs);
+    detail::Bitset<> shape(tr.tiles().volume());
+    const std::size_t dim = tr.data().size();
+    for(typename element_list::const_iterator it = elements.begin(); it != elements.end(); ++it) {
+      TA_USER_ASSERT(tr.elements().includes(it->first),
+          "An element index is not included in the tiled range of the array.");
+
+      // The tile ordinal and the row-major offset of the element in its tile
+      size_type t = 0ul;
+      size_type offset = 0ul;
+      for(std::size_t d = 0ul; d < dim; ++d) {
+        const TiledRange1& r = tr.data()[d];
+        const size_type i = r.element2tile(it->first[d]);
+        const TiledRange1::range_type& bounds = r.tile(i);
+        t = t * (r.tiles().second - r.tiles().first) + (i - r.tiles().first);
+        offset = offset * (bounds.second - bounds.first) + (it->first[d] - bounds.first);
+      }
+
+      const ProcessID owner = pmap->owner(t);
+      tiles[owner].push_back(t);
+      offsets[owner].push_back(offset);
+      values[owner].push_back(it->second);
+      shape.set(t);
+    }
+
+    // Combine the shape of all processes
+    world.gop.bit_or(shape.get(), shape.num_blocks());
+    A array(world, tr, shape, pmap);
+
+    // Exchange the elements
+    std::shared_ptr<detail::CooExchange<A> > exchange(new detail::CooExchange<A>(world));
+    for(std::size_t p = 0ul; p < procs; ++p)
+      if(! tiles[p].empty())
+        exchange->send(p, tiles[p], offsets[p], values[p]);
+    world.gop.fence();
+
+    // Construct the local tiles
+    exchange->assemble(array);
+
+    return array;
+  }
+
+} // namespace TiledArray
+
+#endif // TILEDARRAY_COO_H__INCLUDED
@@ -23,6 +23,7 @@
 #include <TiledArray/error.h>
 #include <TiledArray/pmap/pmap.h>
 #include <TiledArray/madness.h>
+#include <TiledArray/shared_tile_cache.h>
 
 namespace TiledArray {
   namespace detail {
@@ -77,7 +78,8 @@ namespace TiledArray {
           const std::shared_ptr<pmap_interface>& pmap = std::shared_ptr<pmap_interface>()) :
         WorldObject_(world), max_size_(max_size),
         pmap_(pmap),
-        data_((max_size / world.size()) + 11)
+        data_((max_size / world.size()) + 11),
+        cache_(SharedTileCache::instance(world))
       {
         if(pmap_) {
           // Check that the process map is appropriate for this storage object
@@ -261,7 +263,11 @@ namespace TiledArray {
 
       /// This operator returns a future to the local or remote element \c i .
       /// If the element is not present, either local or remote, it is inserted
-      /// into the container on the owner's node.
+      /// into the container on the owner's node. Remote elements are first
+      /// looked up in the node shared tile cache, and elements fetched from
+      /// another node are stored there for the other processes on this node.
+      /// Since an element is set only once, and the cache key includes the
+      /// unique id of this container, cached copies never become stale.
       /// \return A future to the element.
       /// \throw TiledArray::Exception If \c i is greater than or equal to \c max_size() .
       future operator[](size_type i) const {
@@ -273,11 +279,21 @@ namespace TiledArray {
           return acc->second;
         }
 
+        // Copy the element from the shared cache if another process on this
+        // node has fetched it.
+        value_type value;
+        if(cache_.find(SharedTileCache::make_key(WorldObject_::id(), 0ul, i), value, false))
+          return future(value);
+
         // Send a request to the owner of i for the element.
         future result;
         WorldObject_::task(owner(i), & DistributedStorage_::find_handler, i,
             result.remote_ref(get_world()), false, madness::TaskAttributes::hipri());
 
+        // Store the element in the shared cache when it arrives
+        if(cache_.enabled())
+          WorldObject_::task(get_world().rank(), & DistributedStorage_::cache_insert, i, result);
+
         return result;
       }
 
@@ -425,6 +441,14 @@ namespace TiledArray {
         f.set(value);
       }
 
+      /// Store a remote element in the node shared tile cache
+
+      /// \param i The index of the element
+      /// \param value The value of element \c i
+      void cache_insert(size_type i, const value_type& value) const {
+        cache_.insert(SharedTileCache::make_key(WorldObject_::id(), 0ul, i), value, 0l);
+      }
+
       /// Remote insert without a return message
 
       /// This is a task function that is used to spawn remote insert tasks
@@ -489,6 +513,7 @@ namespace TiledArray {
       /// \param mover This is \c true if find handler was called by \c move()
       void find_handler(size_type i, const typename future::remote_refT& ref, bool mover) const {
         TA_ASSERT(is_local(i));
+
         // Find the local element
         const_accessor acc;
         data_.insert(acc, i);
@@ -510,6 +535,7 @@ namespace TiledArray {
       const size_type max_size_; ///< The maximum number of elements that can be stored by this container
       std::shared_ptr<pmap_interface> pmap_; ///< The process map that defines the element distribution
       mutable container_type data_; ///< The local data container
+      SharedTileCache& cache_; ///< Tile cache shared by the processes of this node
     };
 
   }  // namespace detail
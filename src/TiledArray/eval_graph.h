@@ -0,0 +1,390 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEDARRAY_EVAL_GRAPH_H__INCLUDED
+#define TILEDARRAY_EVAL_GRAPH_H__INCLUDED
+
+#include <TiledArray/tensor_expression.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+namespace TiledArray {
+  namespace expressions {
+    namespace detail {
+
+      /// Deferred assignment statement interface
+
+      /// The expression of a statement is constructed by \c build() , which
+      /// reads the arrays in their state at that time, and it is evaluated
+      /// and stored in the target array by \c assign() .
+      class EvalStatement {
+      public:
+        virtual ~EvalStatement() { }
+
+        /// Construct the statement expression from the current arrays
+        virtual void build() = 0;
+
+        /// Evaluate the expression and store it in the target array
+
+        /// This function only waits for the structure of a sparse result,
+        /// not for the tiles.
+        virtual void assign() = 0;
+
+        /// The address of the target array
+        virtual const void* target() const = 0;
+
+        /// The structural key of the statement expression
+
+        /// \note The statement must have been built.
+        virtual std::string key() const = 0;
+
+        /// Collect the arrays read by the statement expression
+
+        /// \param[out] arrays The addresses of the arrays read by this
+        /// statement are appended to this list
+        /// \note The statement must have been built.
+        virtual void collect_arrays(std::vector<const void*>& arrays) const = 0;
+
+        /// Construct a statement that copies the result of another statement
+
+        /// \param source A statement with the same key and target array type
+        /// \return A statement that assigns the target of \c source to the
+        /// target of this statement
+        virtual std::shared_ptr<EvalStatement> make_copy(const EvalStatement& source) const = 0;
+      }; // class EvalStatement
+
+      /// Deferred assignment of a tensor expression to an array
+
+      /// \tparam A The target array type
+      template <typename A>
+      class ArrayEvalStatement : public EvalStatement {
+      public:
+        typedef ArrayEvalStatement<A> ArrayEvalStatement_; ///< This object type
+        typedef A array_type; ///< The target array type
+        typedef TensorExpression<typename A::value_type> expression_type; ///< The expression type
+        typedef typename expression_type::pmap_interface pmap_interface; ///< The process map interface type
+
+      private:
+        array_type& array_; ///< The target array
+        VariableList vars_; ///< The target variable list
+        std::shared_ptr<expression_type> expr_; ///< The expression to be assigned
+
+        // Not allowed
+        ArrayEvalStatement(const ArrayEvalStatement_&);
+        ArrayEvalStatement_& operator=(const ArrayEvalStatement_&);
+
+        /// Array copy expression builder
+        class ArrayCopy {
+        private:
+          const array_type& array_; ///< The array to be copied
+          VariableList vars_; ///< The variable list of the array
+
+        public:
+          ArrayCopy(const array_type& array, const VariableList& vars) :
+            array_(array), vars_(vars)
+          { }
+
+          expression_type operator()() const { return array_(vars_); }
+        }; // class ArrayCopy
+
+      protected:
+
+        /// Construct the expression to be assigned
+
+        /// \return The statement expression
+        virtual expression_type make_expression() const = 0;
+
+      public:
+
+        /// Constructor
+
+        /// \param array The target array
+        /// \param vars The target variable list
+        ArrayEvalStatement(array_type& array, const VariableList& vars) :
+          array_(array), vars_(vars), expr_()
+        { }
+
+        virtual ~ArrayEvalStatement() { }
+
+        virtual void build() {
+          expr_.reset(new expression_type(make_expression()));
+          TA_USER_ASSERT(vars_.dim() == expr_->range().dim(),
+              "The number of variables in the tensor annotation is not equal to the tensor order (number of dimensions).");
+        }
+
+        virtual void assign() {
+          TA_ASSERT(expr_);
+          array_ = expr_->template eval_to_array<array_type>(vars_,
+              expr_->select_pmap(vars_, std::shared_ptr<pmap_interface>()));
+          expr_.reset();
+        }
+
+        virtual const void* target() const { return & array_; }
+
+        virtual std::string key() const {
+          TA_ASSERT(expr_);
+          return typeid(array_type).name() + std::string("=") + expr_->key();
+        }
+
+        virtual void collect_arrays(std::vector<const void*>& arrays) const {
+          TA_ASSERT(expr_);
+          expr_->collect_arrays(arrays);
+        }
+
+        virtual std::shared_ptr<EvalStatement> make_copy(const EvalStatement& source) const;
+
+      }; // class ArrayEvalStatement
+
+      /// Deferred assignment of a tensor expression builder to an array
+
+      /// \tparam A The target array type
+      /// \tparam B The expression builder type, a function object with no
+      /// arguments that returns the expression
+      template <typename A, typename B>
+      class ArrayBuilderEvalStatement : public ArrayEvalStatement<A> {
+      public:
+        typedef ArrayEvalStatement<A> ArrayEvalStatement_; ///< The base class type
+        typedef typename ArrayEvalStatement_::array_type array_type; ///< The target array type
+        typedef typename ArrayEvalStatement_::expression_type expression_type; ///< The expression type
+
+      private:
+        B builder_; ///< The expression builder
+
+      protected:
+        virtual expression_type make_expression() const { return builder_(); }
+
+      public:
+
+        /// Constructor
+
+        /// \param array The target array
+        /// \param vars The target variable list
+        /// \param builder The expression builder
+        ArrayBuilderEvalStatement(array_type& array, const VariableList& vars, const B& builder) :
+          ArrayEvalStatement_(array, vars), builder_(builder)
+        { }
+
+        virtual ~ArrayBuilderEvalStatement() { }
+      }; // class ArrayBuilderEvalStatement
+
+      template <typename A>
+      std::shared_ptr<EvalStatement> ArrayEvalStatement<A>::make_copy(const EvalStatement& source) const {
+        const ArrayEvalStatement_& other = static_cast<const ArrayEvalStatement_&>(source);
+        std::shared_ptr<EvalStatement> result(new ArrayBuilderEvalStatement<A, ArrayCopy>(array_,
+            vars_, ArrayCopy(other.array_, other.vars_)));
+        result->build();
+        return result;
+      }
+
+      /// Temporary array release interface
+      class EvalTemporary {
+      public:
+        virtual ~EvalTemporary() { }
+
+        /// The address of the temporary array
+        virtual const void* array() const = 0;
+
+        /// Release the temporary array data
+        virtual void release() = 0;
+      }; // class EvalTemporary
+
+      /// Temporary array holder
+
+      /// \tparam A The temporary array type
+      template <typename A>
+      class ArrayEvalTemporary : public EvalTemporary {
+      private:
+        A& array_; ///< The temporary array
+
+      public:
+        explicit ArrayEvalTemporary(A& array) : array_(array) { }
+
+        virtual ~ArrayEvalTemporary() { }
+
+        virtual const void* array() const { return & array_; }
+
+        virtual void release() { array_ = A(); }
+      }; // class ArrayEvalTemporary
+
+    } // namespace detail
+
+    /// Deferred evaluation of a group of array assignments
+
+    /// Assignments are recorded with \c add() and evaluated together by
+    /// \c run() . The expression of each statement is given by a builder,
+    /// a function object that is called by \c run() after the earlier
+    /// statements have been assigned, so a statement may read arrays that
+    /// are written by earlier statements, including default constructed
+    /// arrays. When run, statements with identical right-hand sides are
+    /// evaluated once and the result is copied to the other targets. Each
+    /// statement only waits for the structure of a sparse result, so tile
+    /// data flows between statements through futures and independent
+    /// statements run concurrently. Arrays that were marked with
+    /// \c temporary() are released after all statements have started.
+    /// \code
+    /// struct TBuilder {
+    ///   TensorExpression<Tensor<double> > operator()() const { return a("i,k") * b("k,j"); }
+    /// };
+    ///
+    /// EvalGraph graph;
+    /// graph.add(t, "i,j", TBuilder());
+    /// graph.add(r1, "i,j", R1Builder()); // t("i,j") + c("i,j")
+    /// graph.add(r2, "i,j", TBuilder()); // Copied from t
+    /// graph.temporary(t);
+    /// graph.run();
+    /// \endcode
+    /// \note Common subexpressions are only detected for complete right-hand
+    /// sides that are built from arrays, sums, differences, element-wise
+    /// products, and contractions. Shared parts of larger expressions should
+    /// be assigned to a temporary.
+    class EvalGraph {
+    private:
+      typedef std::shared_ptr<detail::EvalStatement> statement_ptr;
+      typedef std::shared_ptr<detail::EvalTemporary> temporary_ptr;
+
+      std::vector<statement_ptr> statements_; ///< Pending statements
+      std::vector<temporary_ptr> temporaries_; ///< Temporary arrays
+      std::size_t eliminated_; ///< The number of statements replaced by copies in the last run
+
+      // Not allowed
+      EvalGraph(const EvalGraph&);
+      EvalGraph& operator=(const EvalGraph&);
+
+      static bool contains(const std::vector<const void*>& arrays, const void* array) {
+        return std::find(arrays.begin(), arrays.end(), array) != arrays.end();
+      }
+
+      /// Replace statement \c j when it has the same key as an earlier statement
+
+      /// A statement is only replaced when the arrays read by its expression
+      /// and the target of the earlier statement are not modified in between.
+      /// The earlier statement may not read its own target.
+      /// \param j The statement index
+      /// \param keys The keys of the statements before \c j
+      /// \param[in,out] reads The arrays read by the statements up to \c j
+      void eliminate_common(const std::size_t j, const std::vector<std::string>& keys,
+          std::vector<std::vector<const void*> >& reads)
+      {
+        // Search backward for a statement with the same key. The search
+        // stops at a statement that writes an array read by j, and the
+        // result of i may not be overwritten before j.
+        std::vector<const void*> written;
+        for(std::size_t i = j; i-- > 0ul;) {
+          const void* target = statements_[i]->target();
+          if(contains(reads[j], target))
+            return;
+          if((keys[i] == keys[j]) && ! contains(written, target)) {
+            statements_[j] = statements_[j]->make_copy(*statements_[i]);
+            reads[j].clear();
+            statements_[j]->collect_arrays(reads[j]);
+            ++eliminated_;
+            return;
+          }
+          written.push_back(target);
+        }
+      }
+
+    public:
+
+      EvalGraph() : statements_(), temporaries_(), eliminated_(0ul) { }
+
+      /// Record an array assignment
+
+      /// The assignment <tt>array(vars) = builder()</tt> is evaluated when
+      /// \c run() is called. \c array and the arrays used by \c builder must
+      /// remain valid until then.
+      /// \tparam A The target array type
+      /// \tparam B The expression builder type, a function object with no
+      /// arguments that returns a <tt>TensorExpression<A::value_type></tt>
+      /// \param array The target array
+      /// \param vars The target variable list
+      /// \param builder The builder of the expression to be assigned to
+      /// \c array
+      template <typename A, typename B>
+      typename madness::enable_if<std::is_same<typename A::eval_type, typename A::value_type> >::type
+      add(A& array, const VariableList& vars, const B& builder) {
+        statements_.push_back(statement_ptr(
+            new detail::ArrayBuilderEvalStatement<A, B>(array, vars, builder)));
+      }
+
+      /// Record an array assignment
+
+      /// \tparam A The target array type
+      /// \tparam B The expression builder type
+      /// \param array The target array
+      /// \param vars The target variable list string
+      /// \param builder The builder of the expression to be assigned to
+      /// \c array
+      template <typename A, typename B>
+      typename madness::enable_if<std::is_same<typename A::eval_type, typename A::value_type> >::type
+      add(A& array, const std::string& vars, const B& builder) {
+        add(array, VariableList(vars), builder);
+      }
+
+      /// Mark an array as a temporary
+
+      /// The data of a temporary array is released (the array is reset to a
+      /// default constructed array) after all statements have started.
+      /// \tparam A The temporary array type
+      /// \param array The temporary array
+      template <typename A>
+      void temporary(A& array) {
+        temporaries_.push_back(temporary_ptr(new detail::ArrayEvalTemporary<A>(array)));
+      }
+
+      /// Number of pending statements
+      std::size_t size() const { return statements_.size(); }
+
+      /// Number of statements replaced by copies in the last run
+      std::size_t eliminated() const { return eliminated_; }
+
+      /// Evaluate all pending statements
+
+      /// Statements are built and assigned in the order they were added.
+      /// This function returns once all target arrays have been assigned; the
+      /// tiles of the target arrays may still be under evaluation.
+      void run() {
+        eliminated_ = 0ul;
+
+        const std::size_t n = statements_.size();
+        std::vector<std::string> keys;
+        keys.reserve(n);
+        std::vector<std::vector<const void*> > reads(n);
+        for(std::size_t j = 0ul; j < n; ++j) {
+          statements_[j]->build();
+          statements_[j]->collect_arrays(reads[j]);
+          keys.push_back(statements_[j]->key());
+          eliminate_common(j, keys, reads);
+          statements_[j]->assign();
+        }
+
+        for(std::size_t t = 0ul; t < temporaries_.size(); ++t)
+          temporaries_[t]->release();
+
+        statements_.clear();
+        temporaries_.clear();
+      }
+
+    }; // class EvalGraph
+
+  } // namespace expressions
+} // namespace TiledArray
+
+#endif // TILEDARRAY_EVAL_GRAPH_H__INCLUDED
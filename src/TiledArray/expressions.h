@@ -634,26 +634,25 @@ namespace TiledArray {
       return reduce(arg, detail::minabs_op<TensorExpression<Tile> >());
     }
 
+    /// Copy an array to a different process map
+
+    /// \tparam T The element type of the array
+    /// \tparam DIM The number of dimensions of the array
+    /// \tparam Tile The tile type of the array
+    /// \param array The array to be copied
+    /// \param pmap The process map of the result
+    /// \return An array with the data of \c array that is distributed with
+    /// \c pmap , or a replicated array when \c pmap is replicated
     template <typename T, unsigned int DIM, typename Tile>
     Array<T, DIM, Tile> remap(const Array<T, DIM, Tile>& array,
         const std::shared_ptr<typename TensorExpression<Tile>::pmap_interface>& pmap)
     {
-      Array<T, DIM, Tile> result(array.get_world(), array.trange(), array.get_shape(), pmap);
-
-      typename Array<T, DIM, Tile>::pmap_interface::const_iterator it = result.get_pmap()->begin();
-      const typename Array<T, DIM, Tile>::pmap_interface::const_iterator end = result.get_pmap()->end();
-      if(result.get_pmap()->is_replicated()) {
-        if(array.get_pmap()->is_replicated()) {
-          for(; it != end; ++it)
-            result.set(*it, array.find(*it));
-        } else {
-
-        }
-
-      } else {
-
-      }
-
+      Array<T, DIM, Tile> result = array;
+      if(pmap->is_replicated())
+        result.make_replicated();
+      else
+        result.redistribute(pmap);
+      return result;
     }
 
   } // namespace expressions
@@ -0,0 +1,200 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEDARRAY_FIXED_RANGE_H__INCLUDED
+#define TILEDARRAY_FIXED_RANGE_H__INCLUDED
+
+#include <TiledArray/range.h>
+#include <array>
+#include <vector>
+
+namespace TiledArray {
+  namespace detail {
+
+    /// Range with a rank that is fixed at compile time
+
+    /// The sizes and weights of the range are stored in \c std::array
+    /// objects, and all loops over the dimensions have a trip count that is
+    /// known at compile time, so the compiler can unroll them. No memory is
+    /// allocated by any member function. This object is a lightweight copy
+    /// of a \c Range that only holds what the permutation kernel needs.
+    /// \tparam N The rank of the range
+    template <unsigned int N>
+    class FixedRange {
+    public:
+      typedef FixedRange<N> FixedRange_; ///< This object type
+      typedef std::size_t size_type; ///< Size type
+      typedef std::array<std::size_t, N> index; ///< Coordinate index type
+
+    private:
+      index size_; ///< Dimension sizes
+      index weight_; ///< Dimension weights (strides)
+      size_type volume_; ///< Total number of elements
+
+    public:
+
+      /// Construct a copy of a dynamic range
+
+      /// \param range The range to be copied
+      /// \throw TiledArray::Exception When the dimension of \c range is not \c N
+      explicit FixedRange(const Range& range) :
+        size_(), weight_(), volume_(range.volume())
+      {
+        TA_ASSERT(range.dim() == N);
+        for(unsigned int d = 0u; d < N; ++d) {
+          size_[d] = range.size()[d];
+          weight_[d] = range.weight()[d];
+        }
+      }
+
+      /// Dimension accessor
+      static unsigned int dim() { return N; }
+
+      /// Range size accessor
+      const index& size() const { return size_; }
+
+      /// Range weight accessor
+      const index& weight() const { return weight_; }
+
+      /// Range volume accessor
+      size_type volume() const { return volume_; }
+
+      /// Visit the permuted ordinal indices of a sequence of elements
+
+      /// For each element \c n in <tt>[first,last)</tt> of this range,
+      /// <tt>op(n, o)</tt> is called, where \c o is the ordinal index of the
+      /// element in the permuted range. The permuted ordinal is updated as the
+      /// coordinate index is incremented, so the cost per element does not
+      /// depend on the rank.
+      /// \tparam Op The visitor type
+      /// \param ip_weight The inverse permuted weight of the permuted range
+      /// \param first The first element
+      /// \param last The end of the elements
+      /// \param op The visitor
+      template <typename Op>
+      void permute_each(const std::vector<std::size_t>& ip_weight,
+          const size_type first, const size_type last, const Op& op) const
+      {
+        TA_ASSERT(ip_weight.size() == N);
+        TA_ASSERT(first <= last);
+        TA_ASSERT(last <= volume_);
+        if(first == last)
+          return;
+
+        // Compute the offset and permuted ordinal of the first element
+        index offset;
+        index weight;
+        size_type o = 0ul;
+        size_type rest = first;
+        for(unsigned int d = 0u; d < N; ++d) {
+          offset[d] = rest / weight_[d];
+          rest %= weight_[d];
+          weight[d] = ip_weight[d];
+          o += offset[d] * weight[d];
+        }
+
+        for(size_type n = first; n < last; ++n) {
+          op(n, o);
+
+          // Increment the offset and the permuted ordinal
+          for(unsigned int d = N; d > 0u; --d) {
+            o += weight[d - 1u];
+            if(++offset[d - 1u] < size_[d - 1u])
+              break;
+            o -= size_[d - 1u] * weight[d - 1u];
+            offset[d - 1u] = 0ul;
+          }
+        }
+      }
+
+    }; // class FixedRange
+
+    /// Visit the permuted ordinal indices of a sequence of elements of a dynamic range
+
+    /// \tparam Op The visitor type
+    /// \param range The range
+    /// \param ip_weight The inverse permuted weight of the permuted range
+    /// \param first The first element
+    /// \param last The end of the elements
+    /// \param op The visitor
+    /// \sa FixedRange::permute_each
+    template <typename Op>
+    inline void permute_each_dynamic(const Range& range, const std::vector<std::size_t>& ip_weight,
+        const std::size_t first, const std::size_t last, const Op& op)
+    {
+      const unsigned int n = range.dim();
+      TA_ASSERT(ip_weight.size() == n);
+      TA_ASSERT(first <= last);
+      TA_ASSERT(last <= range.volume());
+      if(first == last)
+        return;
+
+      std::vector<std::size_t> offset(n, 0ul);
+      std::size_t o = 0ul;
+      std::size_t rest = first;
+      for(unsigned int d = 0u; d < n; ++d) {
+        offset[d] = rest / range.weight()[d];
+        rest %= range.weight()[d];
+        o += offset[d] * ip_weight[d];
+      }
+
+      for(std::size_t i = first; i < last; ++i) {
+        op(i, o);
+
+        for(unsigned int d = n; d > 0u; --d) {
+          o += ip_weight[d - 1u];
+          if(++offset[d - 1u] < range.size()[d - 1u])
+            break;
+          o -= range.size()[d - 1u] * ip_weight[d - 1u];
+          offset[d - 1u] = 0ul;
+        }
+      }
+    }
+
+    /// Visit the permuted ordinal indices of a sequence of elements of a range
+
+    /// Ranges with a rank up to six are visited with a \c FixedRange of that
+    /// rank, and ranges of higher rank are visited with dynamic arrays.
+    /// \tparam Op The visitor type, which must define
+    /// <tt>void operator()(std::size_t n, std::size_t o) const</tt>
+    /// \param range The range
+    /// \param ip_weight The inverse permuted weight of the permuted range
+    /// \param first The first element
+    /// \param last The end of the elements
+    /// \param op The visitor
+    /// \sa FixedRange::permute_each
+    template <typename Op>
+    inline void permute_each(const Range& range, const std::vector<std::size_t>& ip_weight,
+        const std::size_t first, const std::size_t last, const Op& op)
+    {
+      switch(range.dim()) {
+        case 1u: FixedRange<1u>(range).permute_each(ip_weight, first, last, op); break;
+        case 2u: FixedRange<2u>(range).permute_each(ip_weight, first, last, op); break;
+        case 3u: FixedRange<3u>(range).permute_each(ip_weight, first, last, op); break;
+        case 4u: FixedRange<4u>(range).permute_each(ip_weight, first, last, op); break;
+        case 5u: FixedRange<5u>(range).permute_each(ip_weight, first, last, op); break;
+        case 6u: FixedRange<6u>(range).permute_each(ip_weight, first, last, op); break;
+        default: permute_each_dynamic(range, ip_weight, first, last, op); break;
+      }
+    }
+
+  } // namespace detail
+} // namespace TiledArray
+
+#endif // TILEDARRAY_FIXED_RANGE_H__INCLUDED
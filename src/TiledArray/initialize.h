@@ -0,0 +1,53 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEDARRAY_INITIALIZE_H__INCLUDED
+#define TILEDARRAY_INITIALIZE_H__INCLUDED
+
+#include <TiledArray/madness.h>
+#include <TiledArray/bcast_group.h>
+#include <TiledArray/shared_tile_cache.h>
+
+namespace TiledArray {
+
+  /// Set up TiledArray for a world
+
+  /// The host node of each process is exchanged, and the node shared tile
+  /// cache is opened when TiledArray is configured with
+  /// \c TILEDARRAY_ENABLE_SHARED_TILE_CACHE . The node ids are used by the
+  /// node-aware broadcasts, the SUMMA process grid, the contraction cost
+  /// model, and the array replicator, whether or not the cache is enabled.
+  /// Without this call every process is reported on its own node, and these
+  /// algorithms silently fall back to their flat form. This is a collective
+  /// operation, which must be called by all processes of \c world right
+  /// after \c madness::initialize() and before any array is constructed.
+  /// Calls after the first one for a world do nothing.
+  /// \code
+  /// madness::World& world = madness::initialize(argc, argv);
+  /// TiledArray::initialize(world);
+  /// \endcode
+  /// \param world The world
+  inline void initialize(madness::World& world) {
+    detail::init_node_ids(world);
+    detail::SharedTileCache::initialize(world);
+  }
+
+} // namespace TiledArray
+
+#endif // TILEDARRAY_INITIALIZE_H__INCLUDED
@@ -0,0 +1,246 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEDARRAY_LABELED_TILED_RANGE1_H__INCLUDED
+#define TILEDARRAY_LABELED_TILED_RANGE1_H__INCLUDED
+
+#include <TiledArray/tiled_range.h>
+#include <TiledArray/bitset.h>
+#include <vector>
+
+namespace TiledArray {
+
+  /// Abelian point group irrep product
+
+  /// Irreducible representations of the Abelian point groups (D2h and its
+  /// subgroups) are labeled by bit masks (e.g. Cotton order), so the direct
+  /// product of two irreps is the bitwise exclusive or of their labels and
+  /// every irrep is its own inverse.
+  struct AbelianIrrep {
+    typedef long label_type;
+
+    static label_type identity() { return 0l; }
+    static label_type combine(const label_type a, const label_type b) { return a ^ b; }
+    static label_type inverse(const label_type a) { return a; }
+  }; // struct AbelianIrrep
+
+  /// Spin projection quantum number
+
+  /// Labels are the spin projection in units of one half (i.e. \c 2*Sz , so
+  /// \c 1 for alpha and \c -1 for beta). Spin projections are additive.
+  struct SpinProjection {
+    typedef long label_type;
+
+    static label_type identity() { return 0l; }
+    static label_type combine(const label_type a, const label_type b) { return a + b; }
+    static label_type inverse(const label_type a) { return -a; }
+  }; // struct SpinProjection
+
+  /// Quantum-number-labeled, one-dimensional tiled range
+
+  /// Each tile of the range carries a quantum number label (an irrep or spin
+  /// projection) shared by all elements of the tile. Tensors built from
+  /// labeled ranges are block sparse, and the blocks that are forbidden by
+  /// symmetry can be determined from the labels alone; see
+  /// \c make_block_shape() .
+  class LabeledTiledRange1 {
+  public:
+    typedef LabeledTiledRange1 LabeledTiledRange1_; ///< This object type
+    typedef TiledRange1::size_type size_type; ///< Size type
+    typedef long label_type; ///< Quantum number label type
+
+    /// Default constructor
+    LabeledTiledRange1() : trange1_(), labels_() { }
+
+    /// Construct a labeled range from tile boundaries and labels
+
+    /// \tparam RandIter Random access iterator type for tile boundaries
+    /// \tparam InIter Input iterator type for tile labels
+    /// \param first An iterator to the first tile boundary
+    /// \param last An iterator to one past the last tile boundary
+    /// \param label An iterator to the label of the first tile
+    /// \param start_tile_index The index of the first tile
+    template <typename RandIter, typename InIter>
+    LabeledTiledRange1(RandIter first, RandIter last, InIter label,
+        const size_type start_tile_index = 0ul) :
+        trange1_(first, last, start_tile_index), labels_()
+    {
+      labels_.reserve(std::distance(first, last) - 1);
+      for(RandIter it = first + 1; it != last; ++it, ++label)
+        labels_.push_back(*label);
+    }
+
+    /// Copy constructor
+
+    /// \param other The range to be copied
+    LabeledTiledRange1(const LabeledTiledRange1_& other) :
+        trange1_(other.trange1_), labels_(other.labels_)
+    { }
+
+    /// Assignment operator
+
+    /// \param other The range to be copied
+    /// \return A reference to this object
+    LabeledTiledRange1_& operator=(const LabeledTiledRange1_& other) {
+      trange1_ = other.trange1_;
+      labels_ = other.labels_;
+      return *this;
+    }
+
+    /// Construct a labeled range from per-element labels
+
+    /// Consecutive elements with the same label are placed in the same tile,
+    /// so each tile is a symmetry block.
+    /// \tparam InIter Input iterator type for element labels
+    /// \param first An iterator to the label of the first element
+    /// \param last An iterator to one past the label of the last element
+    /// \param element_offset The index of the first element
+    /// \param start_tile_index The index of the first tile
+    /// \return A labeled range with one tile per block of equal labels
+    /// \throw TiledArray::Exception When \c [first,last) is empty
+    template <typename InIter>
+    static LabeledTiledRange1_ make_blocked(InIter first, InIter last,
+        const size_type element_offset = 0ul, const size_type start_tile_index = 0ul)
+    {
+      TA_USER_ASSERT(first != last,
+          "Cannot construct a labeled range from an empty list of element labels.");
+      std::vector<size_type> boundaries(1, element_offset);
+      std::vector<label_type> labels(1, label_type(*first));
+
+      size_type e = element_offset;
+      for(; first != last; ++first, ++e) {
+        if(*first != labels.back()) {
+          boundaries.push_back(e);
+          labels.push_back(*first);
+        }
+      }
+      boundaries.push_back(e);
+
+      return LabeledTiledRange1_(boundaries.begin(), boundaries.end(),
+          labels.begin(), start_tile_index);
+    }
+
+    /// Tiled range accessor
+
+    /// \return A const reference to the unlabeled tiled range
+    const TiledRange1& trange1() const { return trange1_; }
+
+    /// Tile label accessor
+
+    /// \param i The tile index
+    /// \return The quantum number label of tile \c i
+    label_type label(const size_type i) const {
+      TA_ASSERT((i >= trange1_.tiles().first) && (i < trange1_.tiles().second));
+      return labels_[i - trange1_.tiles().first];
+    }
+
+    /// Tile label list accessor
+
+    /// \return A const reference to the tile labels
+    const std::vector<label_type>& labels() const { return labels_; }
+
+    /// Swap the content of this range with \c other
+
+    /// \param other The range to swap with this range
+    void swap(LabeledTiledRange1_& other) {
+      trange1_.swap(other.trange1_);
+      labels_.swap(other.labels_);
+    }
+
+  private:
+    TiledRange1 trange1_; ///< The tile boundaries
+    std::vector<label_type> labels_; ///< The quantum number label of each tile
+  }; // class LabeledTiledRange1
+
+  /// Construct a tiled range from a list of labeled ranges
+
+  /// \tparam InIter Input iterator type for \c LabeledTiledRange1 objects
+  /// \param first An iterator to the first labeled range
+  /// \param last An iterator to one past the last labeled range
+  /// \return The tiled range that corresponds to the labeled ranges
+  template <typename InIter>
+  inline TiledRange make_trange(InIter first, InIter last) {
+    std::vector<TiledRange1> ranges;
+    for(; first != last; ++first)
+      ranges.push_back(first->trange1());
+    return TiledRange(ranges.begin(), ranges.end());
+  }
+
+  /// Construct the block shape of a symmetry-blocked tensor
+
+  /// A block is allowed when the combined label of the first \c nbra
+  /// dimensions is equal to the combined label of the remaining dimensions
+  /// and \c target , i.e.
+  /// \code
+  /// l[0] * ... * l[nbra-1] == target * l[nbra] * ... * l[dim-1]
+  /// \endcode
+  /// where \c * is the group product. For point group symmetry, where the
+  /// direct product of all labels must equal \c target , use
+  /// <tt>nbra == dim</tt>. Forbidden blocks are zero in the
+  /// returned shape, so they are never stored, evaluated, or contracted.
+  /// \tparam Group The quantum number group (e.g. \c AbelianIrrep or
+  /// \c SpinProjection )
+  /// \tparam InIter Input iterator type for \c LabeledTiledRange1 objects
+  /// \param first An iterator to the first labeled range
+  /// \param last An iterator to one past the last labeled range
+  /// \param nbra The number of dimensions on the bra side of the tensor
+  /// \param target The label of the tensor (the identity for totally
+  /// symmetric or spin conserving tensors)
+  /// \return A bitset where allowed blocks are set
+  template <typename Group, typename InIter>
+  inline detail::Bitset<> make_block_shape(InIter first, InIter last,
+      const std::size_t nbra, const typename Group::label_type target = Group::identity())
+  {
+    const std::vector<LabeledTiledRange1> ranges(first, last);
+    TA_USER_ASSERT(nbra <= ranges.size(),
+        "The number of bra dimensions is greater than the tensor order.");
+    const TiledRange trange = make_trange(ranges.begin(), ranges.end());
+
+    detail::Bitset<> shape(trange.tiles().volume());
+    TiledRange::range_type::const_iterator it = trange.tiles().begin();
+    for(std::size_t i = 0ul; i < shape.size(); ++i, ++it) {
+      typename Group::label_type bra = Group::identity();
+      typename Group::label_type ket = target;
+      for(std::size_t d = 0ul; d < nbra; ++d)
+        bra = Group::combine(bra, ranges[d].label((*it)[d]));
+      for(std::size_t d = nbra; d < ranges.size(); ++d)
+        ket = Group::combine(ket, ranges[d].label((*it)[d]));
+      if(Group::combine(bra, Group::inverse(ket)) == Group::identity())
+        shape.set(i);
+    }
+
+    return shape;
+  }
+
+  /// Exchange the data of two labeled ranges
+  inline void swap(LabeledTiledRange1& r0, LabeledTiledRange1& r1) { r0.swap(r1); }
+
+  /// Labeled range equality comparison
+  inline bool operator ==(const LabeledTiledRange1& r1, const LabeledTiledRange1& r2) {
+    return (r1.trange1() == r2.trange1()) && (r1.labels() == r2.labels());
+  }
+
+  /// Labeled range inequality comparison
+  inline bool operator !=(const LabeledTiledRange1& r1, const LabeledTiledRange1& r2) {
+    return ! operator ==(r1, r2);
+  }
+
+} // namespace TiledArray
+
+#endif // TILEDARRAY_LABELED_TILED_RANGE1_H__INCLUDED
@@ -0,0 +1,242 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEDARRAY_MATH_TEAM_H__INCLUDED
+#define TILEDARRAY_MATH_TEAM_H__INCLUDED
+
+#include <TiledArray/math/math.h>
+#include <TiledArray/madness.h>
+#include <algorithm>
+
+namespace TiledArray {
+  namespace math {
+
+    /// Thread team policy for kernels that work on a single large tile
+
+    /// A kernel is run by a team of threads only when its work is large and
+    /// the MADNESS thread pool has idle threads, i.e. there are fewer queued
+    /// tasks than threads. The team members are ordinary pool tasks, so the
+    /// number of running threads never exceeds the size of the thread pool.
+    /// BLAS should be configured to run single threaded.
+    class Team {
+    private:
+
+      static std::size_t& threshold_value() {
+        static std::size_t value = 1048576ul;
+        return value;
+      }
+
+    public:
+
+      /// Minimum work per team member accessor
+
+      /// \return The minimum work, in elements or multiply-adds, that is
+      /// assigned to one team member
+      static std::size_t threshold() { return threshold_value(); }
+
+      /// Set the minimum work per team member
+
+      /// \param value The minimum work per team member
+      /// \throw TiledArray::Exception When \c value is zero
+      static void threshold(const std::size_t value) {
+        TA_USER_ASSERT(value > 0ul, "The team work threshold must be greater than zero.");
+        threshold_value() = value;
+      }
+
+      /// Team size
+
+      /// \param work The total work of a kernel
+      /// \return The number of threads that should run the kernel
+      static std::size_t size(const std::size_t work) {
+        if(work < (threshold_value() * 2ul))
+          return 1ul;
+        const std::size_t threads = madness::ThreadPool::size();
+        const std::size_t queued = madness::ThreadPool::queue_size();
+        if(queued >= threads)
+          return 1ul;
+        return std::min(threads - queued + 1ul, work / threshold_value());
+      }
+
+    }; // class Team
+
+    namespace detail {
+
+      /// Pool task that runs one part of a team kernel
+
+      /// \tparam Op The kernel type, which must provide
+      /// <tt>operator()(std::size_t first, std::size_t last) const</tt>
+      template <typename Op>
+      class TeamTask : public madness::PoolTaskInterface {
+      private:
+        const Op& op_; ///< The kernel
+        const std::size_t first_; ///< The first work item
+        const std::size_t last_; ///< The end of the work items
+        madness::AtomicInt& remaining_; ///< The number of unfinished parts
+
+      public:
+        TeamTask(const Op& op, const std::size_t first, const std::size_t last,
+            madness::AtomicInt& remaining) :
+          madness::PoolTaskInterface(madness::TaskAttributes::hipri()),
+          op_(op), first_(first), last_(last), remaining_(remaining)
+        { }
+
+        virtual ~TeamTask() { }
+
+        virtual void run(const madness::TaskThreadEnv&) {
+          op_(first_, last_);
+          remaining_--;
+        }
+      }; // class TeamTask
+
+      /// Probe that checks that all parts of a team kernel are finished
+      class TeamProbe {
+      private:
+        const madness::AtomicInt& remaining_;
+
+      public:
+        TeamProbe(const madness::AtomicInt& remaining) : remaining_(remaining) { }
+
+        bool operator()() const { return remaining_ == 0; }
+      }; // class TeamProbe
+
+      /// Team kernel for a matrix multiplication, with rows distributed over the team
+      template <typename T>
+      class TeamGemm {
+      private:
+        const integer n_;
+        const integer k_;
+        const T alpha_;
+        const T* a_;
+        const T* b_;
+        T* c_;
+
+      public:
+        TeamGemm(const integer n, const integer k, const T alpha, const T* a,
+            const T* b, T* c) :
+          n_(n), k_(k), alpha_(alpha), a_(a), b_(b), c_(c)
+        { }
+
+        void operator()(const std::size_t first, const std::size_t last) const {
+          gemm(last - first, n_, k_, alpha_, a_ + first * k_, b_, c_ + first * n_);
+        }
+      }; // class TeamGemm
+
+      /// Team kernel for vector_op with two arguments
+      template <typename T, typename U, typename V, typename Op>
+      class TeamVectorOp {
+      private:
+        const T* t_;
+        const U* u_;
+        V* v_;
+        const Op& op_;
+
+      public:
+        TeamVectorOp(const T* t, const U* u, V* v, const Op& op) :
+          t_(t), u_(u), v_(v), op_(op)
+        { }
+
+        void operator()(const std::size_t first, const std::size_t last) const {
+          vector_op(last - first, t_ + first, u_ + first, v_ + first, op_);
+        }
+      }; // class TeamVectorOp
+
+      /// Team kernel for vector_assign
+      template <typename T, typename U, typename Op>
+      class TeamVectorAssign {
+      private:
+        const T* t_;
+        U* u_;
+        const Op& op_;
+
+      public:
+        TeamVectorAssign(const T* t, U* u, const Op& op) : t_(t), u_(u), op_(op) { }
+
+        void operator()(const std::size_t first, const std::size_t last) const {
+          vector_assign(last - first, t_ + first, u_ + first, op_);
+        }
+      }; // class TeamVectorAssign
+
+    } // namespace detail
+
+    /// Run a kernel with a team of threads
+
+    /// The work items <tt>[0, n)</tt> are divided into contiguous ranges, one
+    /// per team member. The calling thread evaluates the first range and
+    /// runs other tasks while it waits for the remaining ranges.
+    /// \tparam Op The kernel type, which must provide
+    /// <tt>operator()(std::size_t first, std::size_t last) const</tt>
+    /// \param n The number of work items
+    /// \param work The estimated total work of the kernel
+    /// \param op The kernel
+    template <typename Op>
+    inline void team_for(const std::size_t n, const std::size_t work, const Op& op) {
+      const std::size_t team = std::min(Team::size(work), n);
+      if(team <= 1ul) {
+        op(0ul, n);
+        return;
+      }
+
+      const std::size_t part = n / team;
+      const std::size_t extra = n % team;
+      madness::AtomicInt remaining;
+      remaining = team - 1ul;
+      std::size_t first = part + (extra ? 1ul : 0ul);
+      for(std::size_t p = 1ul; p < team; ++p) {
+        const std::size_t last = first + part + (p < extra ? 1ul : 0ul);
+        madness::ThreadPool::add(new detail::TeamTask<Op>(op, first, last, remaining));
+        first = last;
+      }
+      op(0ul, part + (extra ? 1ul : 0ul));
+
+      madness::ThreadPool::await(detail::TeamProbe(remaining));
+    }
+
+    /// Matrix multiplication with a team of threads
+
+    /// \c c += \c alpha * \c a * \c b , where the rows of \c c are divided
+    /// between the team members.
+    /// \sa gemm
+    template <typename T>
+    inline void team_gemm(const integer m, const integer n, const integer k,
+        const T alpha, const T* a, const T* b, T* c)
+    {
+      team_for(m, std::size_t(m) * std::size_t(n) * std::size_t(k),
+          detail::TeamGemm<T>(n, k, alpha, a, b, c));
+    }
+
+    /// Element-wise binary operation with a team of threads
+
+    /// \sa vector_op
+    template <typename T, typename U, typename V, typename Op>
+    inline void team_vector_op(const unsigned int n, const T* t, const U* u, V* v, const Op& op) {
+      team_for(n, n, detail::TeamVectorOp<T, U, V, Op>(t, u, v, op));
+    }
+
+    /// Element-wise assignment with a team of threads
+
+    /// \sa vector_assign
+    template <typename T, typename U, typename Op>
+    inline void team_vector_assign(const unsigned int n, const T* t, U* u, const Op& op) {
+      team_for(n, n, detail::TeamVectorAssign<T, U, Op>(t, u, op));
+    }
+
+  }  // namespace math
+}  // namespace TiledArray
+
+#endif // TILEDARRAY_MATH_TEAM_H__INCLUDED
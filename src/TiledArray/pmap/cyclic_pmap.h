@@ -30,10 +30,32 @@
 #include <TiledArray/pmap/pmap.h>
 #include <TiledArray/madness.h>
 #include <cmath>
+#include <algorithm>
 
 namespace TiledArray {
   namespace detail {
 
+    /// Process grid for a contraction result
+
+    /// The ratio of process rows to process columns is approximately the
+    /// ratio of tile rows to tile columns, and the grid is no larger than the
+    /// tile grid, so some processes may hold no result tiles.
+    /// \param procs The number of processes
+    /// \param rows The number of tile rows in the result
+    /// \param cols The number of tile columns in the result
+    /// \param[out] proc_rows The number of process rows
+    /// \param[out] proc_cols The number of process columns
+    inline void contraction_proc_grid(const std::size_t procs, const std::size_t rows,
+        const std::size_t cols, std::size_t& proc_rows, std::size_t& proc_cols)
+    {
+      TA_ASSERT(procs >= 1ul);
+      TA_ASSERT(rows >= 1ul);
+      TA_ASSERT(cols >= 1ul);
+      proc_cols = std::min(procs / std::max(std::min<std::size_t>(
+          std::sqrt(procs * rows / cols), procs), 1ul), cols);
+      proc_rows = std::min(procs / proc_cols, rows);
+    }
+
     /// Map processes using a 2D cyclic decomposition
 
     /// This map cyclicly distributes a two-dimensional grid of tiles among a
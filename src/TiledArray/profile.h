@@ -0,0 +1,316 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEDARRAY_PROFILE_H__INCLUDED
+#define TILEDARRAY_PROFILE_H__INCLUDED
+
+#include <TiledArray/error.h>
+#include <TiledArray/madness.h>
+#include <map>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+// Profiling macros. When TILEDARRAY_ENABLE_PROFILE is not defined, these
+// expand to nothing and their arguments are not evaluated.
+#ifdef TILEDARRAY_ENABLE_PROFILE
+
+#define TA_PROFILE_CONCAT_( a , b ) a ## b
+#define TA_PROFILE_CONCAT( a , b ) TA_PROFILE_CONCAT_( a , b )
+
+/// Time the enclosing scope as one task of operation \c name
+#define TA_PROFILE_SCOPE( name ) \
+    TiledArray::detail::ProfileScope TA_PROFILE_CONCAT( ta_profile_scope_ , __LINE__ )( name )
+
+/// Add \c n floating point operations to operation \c name
+#define TA_PROFILE_FLOPS( name , n ) \
+    TiledArray::detail::Profiler::instance().add_flops( name , n )
+
+/// Record a tile of \c bytes bytes sent by operation \c name
+#define TA_PROFILE_SEND( name , bytes ) \
+    TiledArray::detail::Profiler::instance().add_send( name , bytes )
+
+/// Record a tile of \c bytes bytes received by operation \c name
+#define TA_PROFILE_RECV( name , bytes ) \
+    TiledArray::detail::Profiler::instance().add_recv( name , bytes )
+
+#else
+
+#define TA_PROFILE_SCOPE( name )
+#define TA_PROFILE_FLOPS( name , n )
+#define TA_PROFILE_SEND( name , bytes )
+#define TA_PROFILE_RECV( name , bytes )
+
+#endif // TILEDARRAY_ENABLE_PROFILE
+
+namespace TiledArray {
+  namespace detail {
+
+    /// Performance counters for a single operation
+    struct ProfileCounters {
+      ProfileCounters() :
+          flops(0.0), tasks(0ul), tiles_sent(0ul), bytes_sent(0ul),
+          tiles_received(0ul), bytes_received(0ul), busy_time(0.0)
+      { }
+
+      double flops; ///< Floating point operations issued
+      unsigned long tasks; ///< Number of tasks run
+      unsigned long tiles_sent; ///< Number of tiles sent to other processes
+      unsigned long bytes_sent; ///< Number of bytes sent to other processes
+      unsigned long tiles_received; ///< Number of tiles received from other processes
+      unsigned long bytes_received; ///< Number of bytes received from other processes
+      double busy_time; ///< Wall time spent in tasks (seconds)
+    }; // struct ProfileCounters
+
+    /// A timed trace event
+    struct ProfileEvent {
+      const char* name; ///< The operation name
+      double start; ///< Start wall time (seconds)
+      double finish; ///< Finish wall time (seconds)
+      std::size_t thread; ///< Id of the thread that ran the event
+    }; // struct ProfileEvent
+
+    /// Process local performance counter and trace event store
+
+    /// All counters are accumulated per operation name. Access is serialized
+    /// with a spinlock, so recording is only enabled with
+    /// \c TILEDARRAY_ENABLE_PROFILE . Use the \c TA_PROFILE_* macros to record
+    /// data, rather than calling this object directly.
+    class Profiler {
+    public:
+      typedef std::map<std::string, ProfileCounters> counter_map; ///< Counter container type
+
+    private:
+      counter_map counters_; ///< Counters for each operation
+      std::vector<ProfileEvent> events_; ///< Trace events
+      double epoch_; ///< The wall time when the profiler was last reset
+      mutable madness::Spinlock lock_; ///< Lock for counters and events
+
+      Profiler() : counters_(), events_(), epoch_(madness::wall_time()), lock_() { }
+
+      // Not allowed
+      Profiler(const Profiler&);
+      Profiler& operator=(const Profiler&);
+
+      static std::size_t thread_id() {
+        return std::hash<std::thread::id>()(std::this_thread::get_id());
+      }
+
+    public:
+
+      /// Profiler accessor
+
+      /// \return A reference to the process local profiler
+      static Profiler& instance() {
+        static Profiler profiler;
+        return profiler;
+      }
+
+      /// Add floating point operations to the counters of \c name
+      void add_flops(const char* name, const double n) {
+        madness::ScopedMutex<madness::Spinlock> locker(&lock_);
+        counters_[name].flops += n;
+      }
+
+      /// Add a sent tile to the counters of \c name
+      void add_send(const char* name, const std::size_t bytes) {
+        madness::ScopedMutex<madness::Spinlock> locker(&lock_);
+        ProfileCounters& counters = counters_[name];
+        ++counters.tiles_sent;
+        counters.bytes_sent += bytes;
+      }
+
+      /// Add a received tile to the counters of \c name
+      void add_recv(const char* name, const std::size_t bytes) {
+        madness::ScopedMutex<madness::Spinlock> locker(&lock_);
+        ProfileCounters& counters = counters_[name];
+        ++counters.tiles_received;
+        counters.bytes_received += bytes;
+      }
+
+      /// Add a timed task event to the trace and counters of \c name
+      void add_event(const char* name, const double start, const double finish) {
+        ProfileEvent event = { name, start, finish, thread_id() };
+        madness::ScopedMutex<madness::Spinlock> locker(&lock_);
+        ProfileCounters& counters = counters_[name];
+        ++counters.tasks;
+        counters.busy_time += finish - start;
+        events_.push_back(event);
+      }
+
+      /// Clear all counters and events
+      void reset() {
+        madness::ScopedMutex<madness::Spinlock> locker(&lock_);
+        counters_.clear();
+        events_.clear();
+        epoch_ = madness::wall_time();
+      }
+
+      /// Counter accessor
+
+      /// \return A copy of the counters for all operations
+      counter_map counters() const {
+        madness::ScopedMutex<madness::Spinlock> locker(&lock_);
+        return counters_;
+      }
+
+      /// Write a Chrome trace (chrome://tracing or Perfetto) JSON document
+
+      /// Each task event is written as a complete event, and the counters of
+      /// each operation are written as a counter event at the end of the trace.
+      /// \param os The output stream
+      /// \param rank The process id used for all events
+      void write_trace(std::ostream& os, const ProcessID rank) const {
+        madness::ScopedMutex<madness::Spinlock> locker(&lock_);
+        const double now = madness::wall_time();
+        const char* separator = "\n";
+
+        os << "{\"traceEvents\":[";
+        for(std::vector<ProfileEvent>::const_iterator it = events_.begin(); it != events_.end(); ++it) {
+          os << separator << "{\"name\":\"" << it->name
+              << "\",\"cat\":\"TiledArray\",\"ph\":\"X\",\"ts\":" << (it->start - epoch_) * 1e6
+              << ",\"dur\":" << (it->finish - it->start) * 1e6
+              << ",\"pid\":" << rank << ",\"tid\":" << it->thread << "}";
+          separator = ",\n";
+        }
+        for(counter_map::const_iterator it = counters_.begin(); it != counters_.end(); ++it) {
+          os << separator << "{\"name\":\"" << it->first
+              << "\",\"cat\":\"TiledArray\",\"ph\":\"C\",\"ts\":" << (now - epoch_) * 1e6
+              << ",\"pid\":" << rank << ",\"args\":{\"flops\":" << it->second.flops
+              << ",\"tasks\":" << it->second.tasks
+              << ",\"tiles_sent\":" << it->second.tiles_sent
+              << ",\"bytes_sent\":" << it->second.bytes_sent
+              << ",\"tiles_received\":" << it->second.tiles_received
+              << ",\"bytes_received\":" << it->second.bytes_received
+              << ",\"busy_time\":" << it->second.busy_time << "}}";
+          separator = ",\n";
+        }
+        os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+      }
+
+      /// Write a counter summary
+
+      /// Idle time is estimated as the thread time available since the last
+      /// reset that was not spent in profiled tasks.
+      /// \param os The output stream
+      /// \param rank The process id of this process
+      /// \param threads The number of threads that run tasks
+      void write_counters(std::ostream& os, const ProcessID rank, const std::size_t threads) const {
+        madness::ScopedMutex<madness::Spinlock> locker(&lock_);
+        const double elapsed = madness::wall_time() - epoch_;
+        double busy = 0.0;
+
+        for(counter_map::const_iterator it = counters_.begin(); it != counters_.end(); ++it) {
+          os << rank << ": " << it->first
+              << " tasks=" << it->second.tasks
+              << " flops=" << it->second.flops
+              << " tiles_sent=" << it->second.tiles_sent
+              << " bytes_sent=" << it->second.bytes_sent
+              << " tiles_received=" << it->second.tiles_received
+              << " bytes_received=" << it->second.bytes_received
+              << " busy_time=" << it->second.busy_time << "\n";
+          busy += it->second.busy_time;
+        }
+
+        os << rank << ": elapsed=" << elapsed << " idle_time="
+            << (elapsed * double(threads) - busy) << "\n";
+      }
+
+    }; // class Profiler
+
+    /// Size of a tile in bytes
+
+    /// \tparam T The tile type
+    /// \param t The tile
+    /// \return The number of bytes used by the elements of \c t
+    template <typename T>
+    inline std::size_t tile_bytes(const T& t) {
+      return t.size() * sizeof(typename T::value_type);
+    }
+
+    /// Size of a tile future in bytes
+
+    /// \tparam T The tile type
+    /// \param f The tile future
+    /// \return The number of bytes used by the elements of the tile, or zero
+    /// if \c f has not been set.
+    template <typename T>
+    inline std::size_t tile_bytes(const madness::Future<T>& f) {
+      return (f.probe() ? tile_bytes(f.get()) : 0ul);
+    }
+
+    /// Record the wall time of a scope as a trace event
+    class ProfileScope {
+    private:
+      const char* name_; ///< The operation name
+      const double start_; ///< The start wall time
+
+      // Not allowed
+      ProfileScope(const ProfileScope&);
+      ProfileScope& operator=(const ProfileScope&);
+
+    public:
+      explicit ProfileScope(const char* name) :
+          name_(name), start_(madness::wall_time())
+      { }
+
+      ~ProfileScope() {
+        Profiler::instance().add_event(name_, start_, madness::wall_time());
+      }
+    }; // class ProfileScope
+
+  } // namespace detail
+
+  /// Clear all performance counters and trace events on this process
+  inline void profile_reset() {
+    detail::Profiler::instance().reset();
+  }
+
+  /// Write the performance counters of this process to an output stream
+
+  /// This function is available in all builds, but counters are only
+  /// recorded when TiledArray is configured with \c TILEDARRAY_ENABLE_PROFILE .
+  /// \param world The world of this process
+  /// \param os The output stream
+  inline void profile_write_counters(madness::World& world, std::ostream& os) {
+    detail::Profiler::instance().write_counters(os, world.rank(),
+        madness::ThreadPool::size() + 1);
+  }
+
+  /// Write a Chrome trace of this process
+
+  /// Each process writes <tt>prefix.rank.json</tt>, which can be loaded
+  /// in chrome://tracing or Perfetto; the process id of each event is the
+  /// process rank, so files from several processes may be loaded together.
+  /// \param world The world of this process
+  /// \param prefix The trace file name prefix
+  /// \throw TiledArray::Exception When the file cannot be opened
+  inline void profile_write_trace(madness::World& world, const std::string& prefix) {
+    std::stringstream filename;
+    filename << prefix << "." << world.rank() << ".json";
+    std::ofstream file(filename.str().c_str());
+    TA_USER_ASSERT(file.good(), "Unable to open the trace file.");
+    detail::Profiler::instance().write_trace(file, world.rank());
+  }
+
+} // namespace TiledArray
+
+#endif // TILEDARRAY_PROFILE_H__INCLUDED
@@ -0,0 +1,451 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEDARRAY_REDISTRIBUTOR_H__INCLUDED
+#define TILEDARRAY_REDISTRIBUTOR_H__INCLUDED
+
+#include <TiledArray/madness.h>
+#include <TiledArray/tiled_range.h>
+#include <TiledArray/bitset.h>
+#include <algorithm>
+#include <vector>
+
+namespace TiledArray {
+  namespace detail {
+
+    /// Find the tiles that overlap a range of elements
+
+    /// \param trange The tiled range
+    /// \param range A range of elements that is included in the elements of
+    /// \c trange
+    /// \return The range of the coordinate indices of the tiles of \c trange
+    /// that contain at least one element of \c range
+    inline Range tile_overlap(const TiledRange& trange, const Range& range) {
+      const unsigned int dim = range.dim();
+      TA_ASSERT(trange.tiles().dim() == dim);
+      Range::index start(dim, 0ul);
+      Range::index finish(dim, 0ul);
+      for(unsigned int d = 0u; d < dim; ++d) {
+        start[d] = trange.data()[d].element2tile(range.start()[d]);
+        finish[d] = trange.data()[d].element2tile(range.finish()[d] - 1ul) + 1ul;
+      }
+      return Range(start, finish);
+    }
+
+    /// Compute the shape of an array after it is retiled
+
+    /// \param source The tiled range of the array
+    /// \param shape The shape of the array
+    /// \param result The new tiled range of the array
+    /// \return The shape that contains the tiles of \c result that overlap
+    /// at least one non-zero tile of \c shape
+    inline Bitset<> retile_shape(const TiledRange& source, const Bitset<>& shape,
+        const TiledRange& result)
+    {
+      TA_ASSERT(shape.size() == source.tiles().volume());
+      Bitset<> result_shape(result.tiles().volume());
+      for(std::size_t i = 0ul; i < shape.size(); ++i) {
+        if(shape[i]) {
+          const Range overlap = tile_overlap(result, source.make_tile_range(i));
+          for(Range::const_iterator it = overlap.begin(); it != overlap.end(); ++it)
+            result_shape.set(result.tiles().ord(*it));
+        }
+      }
+      return result_shape;
+    }
+
+    /// Visit the contiguous rows of a block of a range
+
+    /// The rows of the block are as long as possible, so a block that spans
+    /// the trailing dimensions of \c range is visited with a single call to
+    /// \c op per leading index.
+    /// \tparam Index An array type
+    /// \tparam Op The visitor type, which must define
+    /// <tt>void operator()(std::size_t r, std::size_t b, std::size_t n) const</tt>
+    /// where \c r is the ordinal offset of the row in \c range, \c b is the
+    /// ordinal offset of the row in the block, and \c n is the row length.
+    /// \param range The range that contains the block
+    /// \param start The lower bound of the block
+    /// \param finish The upper bound of the block
+    /// \param op The visitor
+    template <typename Index, typename Op>
+    inline void for_each_block_row(const Range& range, const Index& start,
+        const Index& finish, const Op& op)
+    {
+      const unsigned int dim = range.dim();
+      TA_ASSERT(detail::size(start) == dim);
+      TA_ASSERT(detail::size(finish) == dim);
+
+      // Merge the trailing dimensions that the block spans into one row
+      unsigned int k = dim - 1u;
+      std::size_t row = finish[k] - start[k];
+      while((k > 0u) && (start[k] == range.start()[k]) && (finish[k] == range.finish()[k])) {
+        --k;
+        row *= finish[k] - start[k];
+      }
+
+      Range::index i(start.begin(), start.end());
+      std::size_t b = 0ul;
+      while(true) {
+        std::size_t r = 0ul;
+        for(unsigned int d = 0u; d <= k; ++d)
+          r += (i[d] - range.start()[d]) * range.weight()[d];
+        op(r, b, row);
+        b += row;
+
+        // Increment the leading dimensions of the index
+        unsigned int d = k;
+        for(; d > 0u; --d) {
+          if(++i[d - 1u] < finish[d - 1u])
+            break;
+          i[d - 1u] = start[d - 1u];
+        }
+        if(d == 0u)
+          return;
+      }
+    }
+
+    /// Copy a row of a tile into a contiguous block
+    template <typename T>
+    class PackRow {
+    private:
+      const T* tile_;
+      T* block_;
+
+    public:
+      PackRow(const T* tile, T* block) : tile_(tile), block_(block) { }
+
+      void operator()(const std::size_t r, const std::size_t b, const std::size_t n) const {
+        std::copy(tile_ + r, tile_ + r + n, block_ + b);
+      }
+    }; // class PackRow
+
+    /// Copy a row of a contiguous block into a tile
+    template <typename T>
+    class UnpackRow {
+    private:
+      T* tile_;
+      const T* block_;
+
+    public:
+      UnpackRow(T* tile, const T* block) : tile_(tile), block_(block) { }
+
+      void operator()(const std::size_t r, const std::size_t b, const std::size_t n) const {
+        std::copy(block_ + b, block_ + b + n, tile_ + r);
+      }
+    }; // class UnpackRow
+
+    /// Copy a block of a tile into a contiguous buffer
+
+    /// \tparam T The element type
+    /// \tparam Index An array type
+    /// \param range The range of the tile
+    /// \param tile The tile data
+    /// \param start The lower bound of the block
+    /// \param finish The upper bound of the block
+    /// \param block The buffer that will hold the block elements in row-major
+    /// order
+    template <typename T, typename Index>
+    inline void pack_block(const Range& range, const T* tile, const Index& start,
+        const Index& finish, T* block)
+    {
+      for_each_block_row(range, start, finish, PackRow<T>(tile, block));
+    }
+
+    /// Copy a contiguous buffer into a block of a tile
+
+    /// \tparam T The element type
+    /// \tparam Index An array type
+    /// \param range The range of the tile
+    /// \param tile The tile data
+    /// \param start The lower bound of the block
+    /// \param finish The upper bound of the block
+    /// \param block The buffer that holds the block elements in row-major
+    /// order
+    template <typename T, typename Index>
+    inline void unpack_block(const Range& range, T* tile, const Index& start,
+        const Index& finish, const T* block)
+    {
+      for_each_block_row(range, start, finish, UnpackRow<T>(tile, block));
+    }
+
+    /// Move the data of an \c Array to a different process map or tiling
+
+    /// Each process sends, for every result tile that overlaps one of its
+    /// local source tiles, the overlapping block to the owner of the result
+    /// tile. All blocks sent to the same process are packed into one message,
+    /// which is sent when the local source tiles have been evaluated. Source
+    /// tiles that have the same range as the result tile are sent without
+    /// copying. Each result tile is set when all the source tiles that
+    /// overlap it have been received; elements that are not covered by a
+    /// non-zero source tile are zero.
+    /// \tparam A The array type
+    template <typename A>
+    class Redistributor : public madness::WorldObject<Redistributor<A> > {
+    private:
+      typedef Redistributor<A> Redistributor_; ///< This object type
+      typedef madness::WorldObject<Redistributor_> wobj_type; ///< The base object type
+      typedef typename A::size_type size_type; ///< Size type
+      typedef typename A::value_type value_type; ///< The tile type
+      typedef typename value_type::value_type numeric_type; ///< The element type
+
+      /// A result tile that is assembled from the blocks of source tiles
+      struct Assembly {
+        value_type tile; ///< The result tile data
+        size_type count; ///< The number of source tiles that have not been received
+        madness::Future<value_type> result; ///< The result tile
+      }; // struct Assembly
+
+      typedef madness::ConcurrentHashMap<size_type, Assembly> assembly_container;
+
+      /// The data sent to one process
+      struct Message {
+        std::vector<size_type> tiles; ///< The ordinal indices of whole tiles
+        std::vector<value_type> values; ///< The whole tiles
+        std::vector<size_type> blocks; ///< The ordinal indices of the result tiles of the blocks
+        std::vector<size_type> bounds; ///< The lower and upper bound of each block
+        std::vector<numeric_type> data; ///< The elements of the blocks
+      }; // struct Message
+
+      A source_; ///< The source array
+      A result_; ///< The result array
+      std::vector<size_type> indices_; ///< List of local source tile indices
+      std::vector<madness::Future<value_type> > data_; ///< List of local source tiles
+      assembly_container assembly_; ///< The local result tiles that are not set
+
+      /// Check for a zero tile
+
+      /// Unlike \c A::is_zero() , the tiles of a symmetric array that do
+      /// not have a canonical index are zero.
+      /// \param a The array
+      /// \param i The ordinal index of a tile of \c a
+      /// \return \c true when tile \c i of \c a is not stored
+      static bool is_zero(const A& a, const size_type i) {
+        return (! a.is_dense()) && (! a.get_shape()[i]);
+      }
+
+      /// Task that will call send when all local tiles are ready to be sent
+      class DelaySend : public madness::TaskInterface {
+      private:
+        Redistributor_& parent_; ///< The parent redistributor
+
+      public:
+
+        /// Constructor
+        DelaySend(Redistributor_& parent) :
+          madness::TaskInterface(madness::TaskAttributes::hipri()),
+          parent_(parent)
+        {
+          typename std::vector<madness::Future<value_type> >::iterator it =
+              parent_.data_.begin();
+          typename std::vector<madness::Future<value_type> >::iterator end =
+              parent_.data_.end();
+          for(; it != end; ++it) {
+            if(! it->probe()) {
+              madness::DependencyInterface::inc();
+              it->register_callback(this);
+            }
+          }
+        }
+
+        /// Virtual destructor
+        virtual ~DelaySend() { }
+
+        /// Task send task function
+        virtual void run(const madness::TaskThreadEnv&) { parent_.send(); }
+
+      }; // class DelaySend
+
+      /// Add a source tile to the messages for the owners of the result tiles
+
+      /// \param i The ordinal index of the source tile
+      /// \param tile The source tile
+      /// \param messages The messages for each process
+      void pack(const size_type i, const value_type& tile, std::vector<Message>& messages) const {
+        const ProcessID rank = result_.get_world().rank();
+        const bool replicated = source_.get_pmap()->is_replicated();
+        const Range& range = tile.range();
+        const Range overlap = tile_overlap(result_.trange(), range);
+
+        for(Range::const_iterator it = overlap.begin(); it != overlap.end(); ++it) {
+          const size_type t = result_.range().ord(*it);
+          if(is_zero(result_, t))
+            continue;
+
+          // Replicated source tiles are only used by their local result tiles
+          const ProcessID owner = result_.owner(t);
+          if(replicated && (owner != rank))
+            continue;
+
+          Message& message = messages[owner];
+          const Range result_range = result_.trange().make_tile_range(*it);
+          if(result_range == range) {
+            message.tiles.push_back(t);
+            message.values.push_back(tile);
+          } else {
+            // Compute the overlap of the source and result tiles
+            Range::index start(range.dim(), 0ul);
+            Range::index finish(range.dim(), 0ul);
+            std::size_t volume = 1ul;
+            for(unsigned int d = 0u; d < range.dim(); ++d) {
+              start[d] = std::max(range.start()[d], result_range.start()[d]);
+              finish[d] = std::min(range.finish()[d], result_range.finish()[d]);
+              volume *= finish[d] - start[d];
+            }
+
+            message.blocks.push_back(t);
+            message.bounds.insert(message.bounds.end(), start.begin(), start.end());
+            message.bounds.insert(message.bounds.end(), finish.begin(), finish.end());
+            const std::size_t offset = message.data.size();
+            message.data.resize(offset + volume);
+            pack_block(range, tile.data(), start, finish, & message.data[offset]);
+          }
+        }
+      }
+
+      /// Send the blocks of the local source tiles to the owners of the result tiles
+      void send() {
+        madness::World& world = result_.get_world();
+        std::vector<Message> messages(world.size());
+        for(std::size_t n = 0ul; n < indices_.size(); ++n)
+          pack(indices_[n], data_[n].get(), messages);
+
+        for(ProcessID p = 0; p < world.size(); ++p) {
+          const Message& message = messages[p];
+          if(message.tiles.empty() && message.blocks.empty())
+            continue;
+
+          if(p == world.rank())
+            receive(message.tiles, message.values, message.blocks, message.bounds, message.data);
+          else
+            wobj_type::task(p, & Redistributor_::receive, message.tiles, message.values,
+                message.blocks, message.bounds, message.data, madness::TaskAttributes::hipri());
+        }
+      }
+
+      /// Copy the tiles and blocks of a message into the result tiles
+
+      /// \param tiles The ordinal indices of whole tiles
+      /// \param values The whole tiles
+      /// \param blocks The ordinal indices of the result tiles of the blocks
+      /// \param bounds The lower and upper bound of each block
+      /// \param data The elements of the blocks
+      void receive(const std::vector<size_type>& tiles, const std::vector<value_type>& values,
+          const std::vector<size_type>& blocks, const std::vector<size_type>& bounds,
+          const std::vector<numeric_type>& data)
+      {
+        TA_ASSERT(tiles.size() == values.size());
+
+        // A whole tile is the only source tile of its result tile
+        for(std::size_t n = 0ul; n < tiles.size(); ++n) {
+          typename assembly_container::accessor acc;
+          if(! assembly_.find(acc, tiles[n]))
+            TA_EXCEPTION("A result tile was received more than once.");
+          TA_ASSERT(acc->second.count == 1ul);
+          acc->second.result.set(values[n]);
+          assembly_.erase(acc);
+        }
+
+        const unsigned int dim = result_.range().dim();
+        std::vector<size_type>::const_iterator bounds_it = bounds.begin();
+        const numeric_type* block = (data.empty() ? NULL : & data.front());
+        for(std::size_t n = 0ul; n < blocks.size(); ++n, bounds_it += 2u * dim) {
+          const Range::index start(bounds_it, bounds_it + dim);
+          const Range::index finish(bounds_it + dim, bounds_it + 2u * dim);
+
+          typename assembly_container::accessor acc;
+          if(! assembly_.find(acc, blocks[n]))
+            TA_EXCEPTION("A result tile was received more than once.");
+          Assembly& assembly = acc->second;
+          if(assembly.tile.empty())
+            assembly.tile = value_type(result_.trange().make_tile_range(blocks[n]), numeric_type(0));
+          unpack_block(assembly.tile.range(), assembly.tile.data(), start, finish, block);
+          if((--assembly.count) == 0ul) {
+            assembly.result.set(assembly.tile);
+            assembly_.erase(acc);
+          }
+
+          std::size_t volume = 1ul;
+          for(unsigned int d = 0u; d < dim; ++d)
+            volume *= finish[d] - start[d];
+          block += volume;
+        }
+      }
+
+    public:
+
+      /// Constructor
+
+      /// This is a collective operation. The tiles of \c result are set
+      /// with futures that are set when the data of \c source arrives.
+      /// \param source The array that holds the data
+      /// \param result The array that will hold the data, which must have the
+      /// same elements as \c source and no tiles that have been set
+      Redistributor(const A& source, A result) :
+        wobj_type(source.get_world()), source_(source), result_(result),
+        indices_(), data_(), assembly_()
+      {
+        TA_ASSERT(source.trange().elements() == result.trange().elements());
+
+        // Count the source tiles that overlap each local result tile
+        typename A::pmap_interface::const_iterator end = result_.get_pmap()->end();
+        typename A::pmap_interface::const_iterator it = result_.get_pmap()->begin();
+        for(; it != end; ++it) {
+          if(is_zero(result_, *it))
+            continue;
+
+          const Range overlap = tile_overlap(source_.trange(),
+              result_.trange().make_tile_range(*it));
+          size_type count = 0ul;
+          for(Range::const_iterator o_it = overlap.begin(); o_it != overlap.end(); ++o_it)
+            if(! is_zero(source_, source_.range().ord(*o_it)))
+              ++count;
+
+          if(count == 0ul) {
+            result_.set(*it, value_type(result_.trange().make_tile_range(*it), numeric_type(0)));
+          } else {
+            typename assembly_container::accessor acc;
+            assembly_.insert(acc, *it);
+            acc->second.count = count;
+            result_.set(*it, acc->second.result);
+          }
+        }
+
+        // Generate a list of local source tiles
+        end = source_.get_pmap()->end();
+        it = source_.get_pmap()->begin();
+        for(; it != end; ++it)
+          if(! is_zero(source_, *it)) {
+            indices_.push_back(*it);
+            data_.push_back(source_.find(*it));
+          }
+
+        // Send the data when the local source tiles are ready
+        source_.get_world().taskq.add(new DelaySend(*this));
+
+        // Process any pending messages
+        wobj_type::process_pending();
+      }
+
+    }; // class Redistributor
+
+  }  // namespace detail
+}  // namespace TiledArray
+
+#endif // TILEDARRAY_REDISTRIBUTOR_H__INCLUDED
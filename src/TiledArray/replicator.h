@@ -21,6 +21,8 @@
 #define TILEDARRAY_REPLICATOR_H__INCLUDED
 
 #include <TiledArray/madness.h>
+#include <TiledArray/shared_tile_cache.h>
+#include <algorithm>
 
 namespace TiledArray {
   namespace detail {
@@ -43,6 +45,8 @@ namespace TiledArray {
       std::vector<madness::Future<typename A::value_type> > data_; ///< List of local tiles
       madness::AtomicInt sent_; ///< The number of nodes the data has been sent to
       madness::World& world_;
+      const std::vector<int> nodes_; ///< The host node of each process
+      SharedTileCache& cache_; ///< Tile cache shared by the processes of this node
       volatile callback_type callbacks_; ///< A callback stack
       volatile mutable bool probe_; ///< Cache for local data probe
 
@@ -122,18 +126,43 @@ namespace TiledArray {
       }
 
       /// Send all local data to the next node
+
+      /// Tiles sent to a process on the same host node are passed through the
+      /// node shared tile cache when possible.
       void send() {
         const long sent = ++sent_;
         const ProcessID dest = (world_.rank() + sent) % world_.size();
 
         if(dest != world_.rank()) {
-          wobj_type::task(dest, &  Replicator_::send_handler, indices_, data_,
-              madness::TaskAttributes::hipri());
+          if(cache_.enabled() && (nodes_[dest] == nodes_[world_.rank()])) {
+            std::vector<typename A::size_type> indices, shared;
+            std::vector<madness::Future<typename A::value_type> > data;
+            for(std::size_t t = 0ul; t < indices_.size(); ++t) {
+              if(cache_.insert(SharedTileCache::make_key(wobj_type::id(), 0ul, indices_[t]),
+                  data_[t].get(), 1l))
+              {
+                shared.push_back(indices_[t]);
+              } else {
+                indices.push_back(indices_[t]);
+                data.push_back(data_[t]);
+              }
+            }
+            wobj_type::task(dest, &  Replicator_::send_handler, indices, data, shared,
+                world_.rank(), madness::TaskAttributes::hipri());
+          } else {
+            wobj_type::task(dest, &  Replicator_::send_handler, indices_, data_,
+                std::vector<typename A::size_type>(), world_.rank(),
+                madness::TaskAttributes::hipri());
+          }
         } else
           do_callbacks(); // Replication is done
       }
 
-      void send_handler(const std::vector<typename A::size_type>& indices,
+      /// Copy tiles into the replicated array
+
+      /// \param indices The tile indices
+      /// \param data The tiles
+      void set_tiles(const std::vector<typename A::size_type>& indices,
           const std::vector<madness::Future<typename A::value_type> >& data)
       {
         typename std::vector<typename A::size_type>::const_iterator index_it =
@@ -145,16 +174,68 @@ namespace TiledArray {
 
         for(; data_it != data_end; ++data_it, ++index_it)
           destination_.set(*index_it, data_it->get());
+      }
+
+      /// Receive the local tiles of another node
+
+      /// Tiles that are missing from the shared tile cache are requested
+      /// from \c source, which sends them in a regular message.
+      /// \param indices The indices of the tiles in \c data
+      /// \param data The tiles
+      /// \param shared The indices of the tiles in the shared cache
+      /// \param source The node that sent the tiles
+      void send_handler(const std::vector<typename A::size_type>& indices,
+          const std::vector<madness::Future<typename A::value_type> >& data,
+          const std::vector<typename A::size_type>& shared, const ProcessID source)
+      {
+        set_tiles(indices, data);
+
+        // Copy the tiles in the shared cache
+        std::vector<typename A::size_type> missing;
+        typename std::vector<typename A::size_type>::const_iterator index_it = shared.begin();
+        for(; index_it != shared.end(); ++index_it) {
+          typename A::value_type value;
+          if(cache_.find(SharedTileCache::make_key(wobj_type::id(), 0ul, *index_it), value, true))
+            destination_.set(*index_it, value);
+          else
+            missing.push_back(*index_it);
+        }
+
+        if(! missing.empty())
+          wobj_type::task(source, & Replicator_::resend_handler, missing,
+              world_.rank(), madness::TaskAttributes::hipri());
 
         delay_send();
       }
 
+      /// Send local tiles that were missing from the shared tile cache
+
+      /// \param indices The indices of the missing tiles
+      /// \param dest The node that requested the tiles
+      void resend_handler(const std::vector<typename A::size_type>& indices,
+          const ProcessID dest)
+      {
+        std::vector<madness::Future<typename A::value_type> > data;
+        data.reserve(indices.size());
+        typename std::vector<typename A::size_type>::const_iterator index_it = indices.begin();
+        for(; index_it != indices.end(); ++index_it) {
+          const std::size_t t =
+              std::find(indices_.begin(), indices_.end(), *index_it) - indices_.begin();
+          TA_ASSERT(t < indices_.size());
+          data.push_back(data_[t]);
+        }
+
+        wobj_type::task(dest, & Replicator_::set_tiles, indices, data,
+            madness::TaskAttributes::hipri());
+      }
+
     public:
 
       Replicator(const A& source, const A destination) :
         wobj_type(source.get_world()), madness::Spinlock(),
         destination_(destination), indices_(), data_(), sent_(),
-        world_(source.get_world()), callbacks_()
+        world_(source.get_world()), nodes_(node_ids(source.get_world())),
+        cache_(SharedTileCache::instance(source.get_world())), callbacks_()
       {
         sent_ = 0;
 
@@ -0,0 +1,191 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEDARRAY_SHAPE_CONTRACT_H__INCLUDED
+#define TILEDARRAY_SHAPE_CONTRACT_H__INCLUDED
+
+#include <TiledArray/error.h>
+#include <TiledArray/bitset.h>
+#include <TiledArray/math/team.h>
+#include <vector>
+#include <climits>
+
+namespace TiledArray {
+  namespace detail {
+
+    /// Boolean matrix product of contraction argument shapes
+
+    /// The result tile <tt>(i,j)</tt> is non-zero when there is a \c x such
+    /// that the left tile <tt>(i,x)</tt> and the right tile <tt>(x,j)</tt>
+    /// are both non-zero. Row \c i of the result is the union of the rows of
+    /// the right shape that are selected by the non-zero tiles in row \c i of
+    /// the left shape, which is computed one block of bits at a time. Only
+    /// the non-zero tiles of the left shape are visited, and no storage
+    /// beyond one bit per result tile is needed. Result rows are divided
+    /// between the members of a thread team.
+    class ShapeContract {
+    public:
+      typedef Bitset<> shape_type; ///< Shape type
+      typedef shape_type::block_type block_type; ///< Bit block type
+      typedef std::size_t size_type; ///< Size type
+
+    private:
+      static const size_type block_bits = sizeof(block_type) * CHAR_BIT; ///< Bits per block
+
+      const shape_type& left_; ///< The left shape (empty when dense)
+      const shape_type& right_; ///< The right shape (empty when dense)
+      const size_type k_; ///< The number of columns in the left shape
+      const size_type n_; ///< The number of columns in the right shape
+      const size_type blocks_; ///< The number of bit blocks in a result row
+      block_type* rows_; ///< The result rows
+
+      /// Load a block of bits from a row
+
+      /// \param bits The bit set
+      /// \param first The offset of the first bit of the row in \c bits
+      /// \param size The number of bits in the row
+      /// \param b The block index in the row
+      /// \return Bits <tt>[b * block_bits, (b + 1) * block_bits)</tt> of
+      /// the row, where the bits beyond the end of the row are zero
+      static block_type load(const shape_type& bits, const size_type first,
+          const size_type size, const size_type b)
+      {
+        const size_type pos = first + b * block_bits;
+        const size_type block = pos / block_bits;
+        const size_type shift = pos % block_bits;
+        block_type result = bits.get()[block] >> shift;
+        if(shift && ((block + 1ul) < bits.num_blocks()))
+          result |= bits.get()[block + 1ul] << (block_bits - shift);
+        return result & mask(size, b);
+      }
+
+      /// Mask of the bits of a block that are in a row
+
+      /// \param size The number of bits in the row
+      /// \param b The block index in the row
+      /// \return A block where the bits that are inside the row are set
+      static block_type mask(const size_type size, const size_type b) {
+        const size_type tail = size - b * block_bits;
+        return (tail < block_bits ? (block_type(1) << tail) - block_type(1) : ~block_type(0));
+      }
+
+      /// Add a row of the right shape to a result row
+
+      /// \param row The result row
+      /// \param x The row of the right shape
+      void add_row(block_type* row, const size_type x) const {
+        if(right_.size() == 0ul) {
+          for(size_type b = 0ul; b < blocks_; ++b)
+            row[b] = mask(n_, b);
+        } else {
+          for(size_type b = 0ul; b < blocks_; ++b)
+            row[b] |= load(right_, x * n_, n_, b);
+        }
+      }
+
+    public:
+
+      /// Constructor
+
+      /// \param left The left shape, which is empty when the left argument is dense
+      /// \param right The right shape, which is empty when the right argument is dense
+      /// \param k The number of tile columns in the left argument
+      /// \param n The number of tile columns in the right argument
+      /// \param rows The result rows, with <tt>blocks(n)</tt> zero blocks per row
+      ShapeContract(const shape_type& left, const shape_type& right,
+          const size_type k, const size_type n, block_type* rows) :
+        left_(left), right_(right), k_(k), n_(n), blocks_(blocks(n)), rows_(rows)
+      { }
+
+      /// The number of bit blocks in a result row
+
+      /// \param n The number of tile columns in the result
+      /// \return The number of blocks that hold \c n bits
+      static size_type blocks(const size_type n) { return (n + block_bits - 1ul) / block_bits; }
+
+      /// Compute result rows
+
+      /// \param first The first result row
+      /// \param last The end of the result rows
+      void operator()(const size_type first, const size_type last) const {
+        for(size_type i = first; i < last; ++i) {
+          block_type* const row = rows_ + i * blocks_;
+          if(left_.size() == 0ul) {
+            for(size_type x = 0ul; x < k_; ++x)
+              add_row(row, x);
+          } else {
+            for(size_type b = 0ul; b * block_bits < k_; ++b) {
+              const block_type word = load(left_, i * k_, k_, b);
+              if(word == block_type(0))
+                continue;
+              for(size_type bit = 0ul; bit < block_bits; ++bit)
+                if(word & (block_type(1) << bit))
+                  add_row(row, b * block_bits + bit);
+            }
+          }
+        }
+      }
+
+    }; // class ShapeContract
+
+    /// Compute the shape of a contraction result
+
+    /// \param[out] result The result shape, which must have \c m*n bits
+    /// \param left The left shape, which is empty when the left argument is dense
+    /// \param right The right shape, which is empty when the right argument is dense
+    /// \param m The number of tile rows in the left argument
+    /// \param k The number of tile columns in the left argument
+    /// \param n The number of tile columns in the right argument
+    /// \sa ShapeContract
+    inline void contract_shape(Bitset<>& result, const Bitset<>& left,
+        const Bitset<>& right, const std::size_t m, const std::size_t k, const std::size_t n)
+    {
+      TA_ASSERT(result.size() == (m * n));
+      TA_ASSERT((left.size() == 0ul) || (left.size() == (m * k)));
+      TA_ASSERT((right.size() == 0ul) || (right.size() == (k * n)));
+
+      typedef ShapeContract::block_type block_type;
+      const std::size_t blocks = ShapeContract::blocks(n);
+      std::vector<block_type> rows(m * blocks, block_type(0));
+      if(rows.empty())
+        return;
+
+      // Compute the result rows
+      const std::size_t pairs = (left.size() == 0ul ? m * k : left.count());
+      math::team_for(m, pairs * blocks,
+          ShapeContract(left, right, k, n, & rows.front()));
+
+      // Copy the result rows into the result shape
+      const std::size_t block_bits = sizeof(block_type) * CHAR_BIT;
+      for(std::size_t i = 0ul; i < m; ++i) {
+        for(std::size_t b = 0ul; b < blocks; ++b) {
+          const block_type word = rows[i * blocks + b];
+          if(word == block_type(0))
+            continue;
+          for(std::size_t bit = 0ul; bit < block_bits; ++bit)
+            if(word & (block_type(1) << bit))
+              result.set(i * n + b * block_bits + bit);
+        }
+      }
+    }
+
+  } // namespace detail
+} // namespace TiledArray
+
+#endif // TILEDARRAY_SHAPE_CONTRACT_H__INCLUDED
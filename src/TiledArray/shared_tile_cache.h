@@ -0,0 +1,663 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEDARRAY_SHARED_TILE_CACHE_H__INCLUDED
+#define TILEDARRAY_SHARED_TILE_CACHE_H__INCLUDED
+
+#include <TiledArray/error.h>
+#include <TiledArray/madness.h>
+#include <TiledArray/bcast_group.h>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <sstream>
+
+#ifdef TILEDARRAY_ENABLE_SHARED_TILE_CACHE
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif // TILEDARRAY_ENABLE_SHARED_TILE_CACHE
+
+namespace TiledArray {
+  namespace detail {
+
+    /// Tile cache shared by the processes of a host node
+
+    /// The cache is a POSIX shared memory segment that is mapped by all
+    /// processes of a world that run on the same node. Tiles are stored in
+    /// serialized form, so a process that finds a tile in the cache makes a
+    /// private copy of it with a memory copy instead of a network transfer.
+    /// Each entry has a pin count: a pinned entry is kept until it has been
+    /// read once for each pin, while an unpinned entry may be evicted, least
+    /// recently used first, when space is needed. Entries are found through a
+    /// hash table in the segment, and the data area is allocated first fit
+    /// by walking the used entries in offset order, so the node-wide lock is
+    /// only held for short operations. The cache is only active when
+    /// TiledArray is configured with \c TILEDARRAY_ENABLE_SHARED_TILE_CACHE ,
+    /// \c initialize() has been called for the world, and the segment could
+    /// be mapped by every process on the node; otherwise, all insertions and
+    /// lookups fail and callers fall back to messages.
+    /// \note Readers deserialize a private copy of each tile, so the cache
+    /// reduces the network traffic between the processes of a node, not their
+    /// memory use: the segment, \c size() bytes or 256 MB by default, is used
+    /// in addition to the tiles held by each process.
+    class SharedTileCache {
+    public:
+      typedef SharedTileCache SharedTileCache_; ///< This object type
+
+      /// Cache entry key
+      struct key_type {
+        unsigned long world; ///< The world id of the object that owns the tile
+        unsigned long object; ///< The object id of the object that owns the tile
+        unsigned long tag; ///< Object defined tag
+        unsigned long index; ///< The tile index
+
+        bool operator==(const key_type& other) const {
+          return (world == other.world) && (object == other.object) &&
+              (tag == other.tag) && (index == other.index);
+        }
+      }; // struct key_type
+
+    private:
+
+      /// Cache entry
+
+      /// Entries are linked by their index in the entry table. A used entry
+      /// is in the list of its hash bucket, the list of used entries ordered
+      /// by data offset, and the list of used entries ordered by last access.
+      /// A free entry is only in the free list.
+      struct Entry {
+        key_type key; ///< The entry key
+        std::size_t offset; ///< The offset of the tile data in the data area
+        std::size_t size; ///< The size of the tile data
+        long pins; ///< The number of reads that must happen before eviction
+        long readers; ///< The number of processes that are reading the data
+        std::size_t next; ///< The next entry in the hash bucket or in the free list
+        std::size_t prev_block; ///< The used entry before this one in the data area
+        std::size_t next_block; ///< The used entry after this one in the data area
+        std::size_t older; ///< The used entry that was accessed before this one
+        std::size_t newer; ///< The used entry that was accessed after this one
+        bool used; ///< \c true when the entry holds a tile
+        bool hashed; ///< \c true when the entry can be found by its key
+        bool ready; ///< \c true when the tile data has been written
+      }; // struct Entry
+
+      /// Segment header
+      struct Header {
+#ifdef TILEDARRAY_ENABLE_SHARED_TILE_CACHE
+        pthread_mutex_t mutex; ///< Process shared mutex that guards the entries
+#endif // TILEDARRAY_ENABLE_SHARED_TILE_CACHE
+        std::size_t entries; ///< The number of entries
+        std::size_t buckets; ///< The number of hash buckets, a power of two
+        std::size_t capacity; ///< The size of the data area
+        std::size_t free; ///< The first free entry
+        std::size_t first_block; ///< The used entry with the lowest data offset
+        std::size_t last_block; ///< The used entry with the highest data offset
+        std::size_t oldest; ///< The least recently used entry
+        std::size_t newest; ///< The most recently used entry
+      }; // struct Header
+
+      static const std::size_t alignment = 64ul; ///< Alignment of tile data
+      static const std::size_t npos = ~0ul; ///< Null entry index
+
+      char* segment_; ///< The mapped segment, or NULL when the cache is inactive
+      std::size_t bytes_; ///< The size of the segment
+
+      static std::size_t& size_value() {
+        static std::size_t value = 268435456ul;
+        return value;
+      }
+
+      static std::size_t& entries_value() {
+        static std::size_t value = 4096ul;
+        return value;
+      }
+
+      /// The number of hash buckets for a number of entries
+      static std::size_t bucket_count(const std::size_t entries) {
+        std::size_t result = 1ul;
+        while(result < entries)
+          result <<= 1;
+        return result;
+      }
+
+      Header* header() const { return reinterpret_cast<Header*>(segment_); }
+
+      Entry* entry_table() const {
+        return reinterpret_cast<Entry*>(segment_ + round(sizeof(Header)));
+      }
+
+      std::size_t* bucket_table() const {
+        return reinterpret_cast<std::size_t*>(segment_ + round(sizeof(Header)) +
+            round(sizeof(Entry) * header()->entries));
+      }
+
+      char* data() const {
+        return segment_ + round(sizeof(Header)) + round(sizeof(Entry) * header()->entries) +
+            round(sizeof(std::size_t) * header()->buckets);
+      }
+
+      static std::size_t round(const std::size_t n) {
+        return (n + alignment - 1ul) & ~(alignment - 1ul);
+      }
+
+      void lock() const {
+#ifdef TILEDARRAY_ENABLE_SHARED_TILE_CACHE
+        pthread_mutex_lock(& header()->mutex);
+#endif // TILEDARRAY_ENABLE_SHARED_TILE_CACHE
+      }
+
+      void unlock() const {
+#ifdef TILEDARRAY_ENABLE_SHARED_TILE_CACHE
+        pthread_mutex_unlock(& header()->mutex);
+#endif // TILEDARRAY_ENABLE_SHARED_TILE_CACHE
+      }
+
+      /// The hash bucket of a key
+      std::size_t& bucket(const key_type& key) const {
+        madness::hashT seed = key.world;
+        madness::hash_combine(seed, key.object);
+        madness::hash_combine(seed, key.tag);
+        madness::hash_combine(seed, key.index);
+        return bucket_table()[seed & (header()->buckets - 1ul)];
+      }
+
+      /// Initialize the entries and buckets of a new segment
+
+      /// \param entries The number of entries
+      void format(const std::size_t entries) {
+        header()->entries = entries;
+        header()->buckets = bucket_count(entries);
+        header()->capacity = round(size_value());
+        header()->first_block = header()->last_block = npos;
+        header()->oldest = header()->newest = npos;
+        Entry* const table = entry_table();
+        for(std::size_t e = 0ul; e < entries; ++e) {
+          table[e].used = table[e].hashed = table[e].ready = false;
+          table[e].next = e + 1ul;
+        }
+        table[entries - 1ul].next = npos;
+        header()->free = 0ul;
+        std::fill_n(bucket_table(), header()->buckets, std::size_t(npos));
+      }
+
+      /// Find an entry
+
+      /// \note Assume the cache is locked
+      Entry* find_entry(const key_type& key) const {
+        Entry* const table = entry_table();
+        for(std::size_t e = bucket(key); e != npos; e = table[e].next)
+          if(table[e].key == key)
+            return table + e;
+        return NULL;
+      }
+
+      /// Remove an entry from its hash bucket, so it can no longer be found
+
+      /// \note Assume the cache is locked
+      void unhash(Entry* entry) {
+        Entry* const table = entry_table();
+        const std::size_t e = entry - table;
+        std::size_t* link = & bucket(entry->key);
+        while(*link != e)
+          link = & table[*link].next;
+        *link = entry->next;
+        entry->hashed = false;
+      }
+
+      /// Move an entry to the most recently used end of the access list
+
+      /// \note Assume the cache is locked
+      void touch(Entry* entry) {
+        Entry* const table = entry_table();
+        const std::size_t e = entry - table;
+        if(header()->newest == e)
+          return;
+
+        // Unlink the entry
+        if(entry->older != npos)
+          table[entry->older].newer = entry->newer;
+        else
+          header()->oldest = entry->newer;
+        table[entry->newer].older = entry->older;
+
+        // Append the entry
+        entry->older = header()->newest;
+        entry->newer = npos;
+        table[header()->newest].newer = e;
+        header()->newest = e;
+      }
+
+      /// Release an entry and its space in the data area
+
+      /// \note Assume the cache is locked
+      void release(Entry* entry) {
+        Entry* const table = entry_table();
+        const std::size_t e = entry - table;
+        if(entry->hashed)
+          unhash(entry);
+
+        if(entry->prev_block != npos)
+          table[entry->prev_block].next_block = entry->next_block;
+        else
+          header()->first_block = entry->next_block;
+        if(entry->next_block != npos)
+          table[entry->next_block].prev_block = entry->prev_block;
+        else
+          header()->last_block = entry->prev_block;
+
+        if(entry->older != npos)
+          table[entry->older].newer = entry->newer;
+        else
+          header()->oldest = entry->newer;
+        if(entry->newer != npos)
+          table[entry->newer].older = entry->older;
+        else
+          header()->newest = entry->older;
+
+        entry->used = entry->ready = false;
+        entry->next = header()->free;
+        header()->free = e;
+      }
+
+      /// Allocate an entry and space in the data area
+
+      /// The data area is searched for the first gap of \c size bytes by
+      /// walking the used entries in offset order. Unpinned entries are
+      /// evicted, least recently used first, until a free entry and a large
+      /// enough gap are found. The new entry is hashed under \c key and is
+      /// the most recently used entry.
+      /// \note Assume the cache is locked
+      /// \param key The entry key
+      /// \param size The number of bytes to allocate
+      /// \return The allocated entry, or NULL when there is not enough space
+      Entry* allocate(const key_type& key, const std::size_t size) {
+        Entry* const table = entry_table();
+        for(;;) {
+          // Find the first gap that is large enough, and the used entry
+          // that precedes it
+          if(header()->free != npos) {
+            std::size_t prev = npos;
+            std::size_t offset = 0ul;
+            std::size_t next = header()->first_block;
+            while((next != npos) && (table[next].offset - offset < size)) {
+              prev = next;
+              offset = round(table[next].offset + table[next].size);
+              next = table[next].next_block;
+            }
+
+            if((next != npos) || (header()->capacity - std::min(offset, header()->capacity) >= size)) {
+              const std::size_t e = header()->free;
+              Entry* const entry = table + e;
+              header()->free = entry->next;
+
+              entry->key = key;
+              entry->offset = offset;
+              entry->size = size;
+              entry->used = entry->hashed = true;
+              entry->ready = false;
+
+              // Link the entry in its hash bucket and in the block list
+              std::size_t& head = bucket(key);
+              entry->next = head;
+              head = e;
+              entry->prev_block = prev;
+              entry->next_block = next;
+              if(prev != npos)
+                table[prev].next_block = e;
+              else
+                header()->first_block = e;
+              if(next != npos)
+                table[next].prev_block = e;
+              else
+                header()->last_block = e;
+
+              // Append the entry to the access list
+              entry->older = header()->newest;
+              entry->newer = npos;
+              if(header()->newest != npos)
+                table[header()->newest].newer = e;
+              else
+                header()->oldest = e;
+              header()->newest = e;
+
+              return entry;
+            }
+          }
+
+          // Evict the least recently used entry
+          std::size_t victim = header()->oldest;
+          while((victim != npos) && ((! table[victim].ready) || (table[victim].pins != 0l) ||
+              (table[victim].readers != 0l)))
+            victim = table[victim].newer;
+          if(victim == npos)
+            return NULL;
+          release(table + victim);
+        }
+      }
+
+      /// Create or open the shared memory segment
+
+      /// \param world The world of the processes that share the segment
+      void open(madness::World& world) {
+#ifdef TILEDARRAY_ENABLE_SHARED_TILE_CACHE
+        // The process with the lowest rank on each node creates the segment,
+        // which is named after its process id.
+        const std::vector<int> nodes = node_ids(world);
+        const ProcessID rank = world.rank();
+        const ProcessID leader = std::find(nodes.begin(), nodes.end(), nodes[rank]) - nodes.begin();
+        std::vector<long> pids(world.size(), 0l);
+        pids[rank] = getpid();
+        world.gop.sum(& pids.front(), pids.size());
+        std::stringstream name;
+        name << "/tiledarray." << pids[leader] << "." << world.id();
+
+        const std::size_t entries = entries_value();
+        bytes_ = round(sizeof(Header)) + round(sizeof(Entry) * entries) +
+            round(sizeof(std::size_t) * bucket_count(entries)) + round(size_value());
+
+        if(rank == leader) {
+          const int fd = shm_open(name.str().c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+          if(fd != -1) {
+            if(posix_fallocate(fd, 0, bytes_) == 0) {
+              void* segment = mmap(NULL, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+              if(segment != MAP_FAILED) {
+                segment_ = static_cast<char*>(segment);
+                pthread_mutexattr_t attr;
+                pthread_mutexattr_init(& attr);
+                pthread_mutexattr_setpshared(& attr, PTHREAD_PROCESS_SHARED);
+                pthread_mutex_init(& header()->mutex, & attr);
+                pthread_mutexattr_destroy(& attr);
+                format(entries);
+              }
+            }
+            close(fd);
+          }
+        }
+        world.gop.barrier();
+
+        if((rank != leader) && (segment_ == NULL)) {
+          const int fd = shm_open(name.str().c_str(), O_RDWR, 0600);
+          if(fd != -1) {
+            void* segment = mmap(NULL, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if(segment != MAP_FAILED)
+              segment_ = static_cast<char*>(segment);
+            close(fd);
+          }
+        }
+
+        // The cache is used on a node only when all of its processes have
+        // mapped the segment.
+        std::vector<int> failed(world.size(), 0);
+        failed[rank] = (segment_ == NULL ? 1 : 0);
+        world.gop.sum(& failed.front(), failed.size());
+        for(ProcessID p = 0; p < world.size(); ++p) {
+          if((nodes[p] == nodes[rank]) && failed[p] && segment_) {
+            munmap(segment_, bytes_);
+            segment_ = NULL;
+          }
+        }
+
+        // The segment is removed when the last process unmaps it
+        if(rank == leader)
+          shm_unlink(name.str().c_str());
+#endif // TILEDARRAY_ENABLE_SHARED_TILE_CACHE
+      }
+
+      /// The caches that have been created, by world id
+      static std::map<unsigned long, std::shared_ptr<SharedTileCache_> >& caches() {
+        static std::map<unsigned long, std::shared_ptr<SharedTileCache_> > value;
+        return value;
+      }
+
+      /// The mutex that guards \c caches()
+      static madness::Mutex& mutex() {
+        static madness::Mutex value;
+        return value;
+      }
+
+      SharedTileCache() : segment_(NULL), bytes_(0ul) { }
+
+      // Not allowed
+      SharedTileCache(const SharedTileCache_&);
+      SharedTileCache_& operator=(const SharedTileCache_&);
+
+    public:
+
+      ~SharedTileCache() {
+#ifdef TILEDARRAY_ENABLE_SHARED_TILE_CACHE
+        if(segment_)
+          munmap(segment_, bytes_);
+#endif // TILEDARRAY_ENABLE_SHARED_TILE_CACHE
+      }
+
+      /// Create the shared tile cache of a world
+
+      /// The host nodes of the processes are exchanged, and the segment is
+      /// mapped by the processes of each node. This is a collective
+      /// operation, which must be called by all processes of \c world in the
+      /// same order with respect to other collective operations. Calls after
+      /// the first one for a world do nothing.
+      /// \param world The world
+      /// \note Applications call \c TiledArray::initialize() , which also
+      /// sets up the node ids when the cache is disabled.
+      /// \sa init_node_ids
+      static void initialize(madness::World& world) {
+        init_node_ids(world);
+        {
+          madness::ScopedMutex<madness::Mutex> locker(mutex());
+          if(caches().count(world.id()))
+            return;
+        }
+
+        // The segment is opened outside the lock, since it is collective
+        std::shared_ptr<SharedTileCache_> cache(new SharedTileCache_());
+        cache->open(world);
+
+        madness::ScopedMutex<madness::Mutex> locker(mutex());
+        caches()[world.id()] = cache;
+      }
+
+      /// Shared tile cache of a world
+
+      /// This function does not communicate.
+      /// \param world The world
+      /// \return The cache shared by the processes of \c world on this node,
+      /// or an inactive cache when \c initialize() has not been called for
+      /// \c world
+      static SharedTileCache_& instance(madness::World& world) {
+        static SharedTileCache_ inactive;
+        madness::ScopedMutex<madness::Mutex> locker(mutex());
+        std::map<unsigned long, std::shared_ptr<SharedTileCache_> >::const_iterator it =
+            caches().find(world.id());
+        return (it != caches().end() ? *(it->second) : inactive);
+      }
+
+      /// Size of the tile data area accessor
+
+      /// \return The size, in bytes, of the tile data area of a cache
+      static std::size_t size() { return size_value(); }
+
+      /// Set the size of the tile data area
+
+      /// This only affects caches that are created after the call.
+      /// \param value The size, in bytes, of the tile data area
+      /// \throw TiledArray::Exception When \c value is zero
+      static void size(const std::size_t value) {
+        TA_USER_ASSERT(value > 0ul, "The shared tile cache size must be greater than zero.");
+        size_value() = value;
+      }
+
+      /// Number of entries accessor
+
+      /// \return The maximum number of tiles in a cache
+      static std::size_t entries() { return entries_value(); }
+
+      /// Set the number of entries
+
+      /// This only affects caches that are created after the call.
+      /// \param value The maximum number of tiles in a cache
+      /// \throw TiledArray::Exception When \c value is zero
+      static void entries(const std::size_t value) {
+        TA_USER_ASSERT(value > 0ul, "The number of shared tile cache entries must be greater than zero.");
+        entries_value() = value;
+      }
+
+      /// Make a cache key
+
+      /// \param id The unique id of the world object that owns the tile
+      /// \param tag Object defined tag
+      /// \param index The tile index
+      /// \return The cache key
+      static key_type make_key(const madness::uniqueidT& id, const unsigned long tag,
+          const unsigned long index)
+      {
+        key_type key;
+        key.world = id.get_world_id();
+        key.object = id.get_obj_id();
+        key.tag = tag;
+        key.index = index;
+        return key;
+      }
+
+      /// Check that the cache is active on this node
+
+      /// \return \c true when tiles may be stored in the cache
+      bool enabled() const { return segment_ != NULL; }
+
+      /// Store a tile
+
+      /// If the tile is already in the cache, only the pin count is increased.
+      /// \tparam T The tile type
+      /// \param key The tile key
+      /// \param value The tile
+      /// \param pins The number of reads that must happen before the tile
+      /// may be evicted
+      /// \return \c true when the tile is in the cache
+      template <typename T>
+      bool insert(const key_type& key, const T& value, const long pins) {
+        if(! segment_)
+          return false;
+
+        // Get the size of the serialized tile
+        madness::archive::BufferOutputArchive count;
+        count & value;
+        const std::size_t size = count.size();
+
+        // Reserve an entry
+        lock();
+        Entry* entry = find_entry(key);
+        if(entry) {
+          entry->pins += pins;
+          unlock();
+          return true;
+        }
+        entry = allocate(key, size);
+        if(entry) {
+          entry->pins = pins;
+          entry->readers = 0l;
+        }
+        unlock();
+        if(entry == NULL)
+          return false;
+
+        // Write the tile outside the lock
+        madness::archive::BufferOutputArchive ar(data() + entry->offset, size);
+        ar & value;
+
+        lock();
+        entry->ready = true;
+        if((! entry->hashed) && (entry->readers == 0l))
+          release(entry); // The entry was erased while it was written
+        unlock();
+
+        return true;
+      }
+
+      /// Read a tile
+
+      /// \tparam T The tile type
+      /// \param key The tile key
+      /// \param[out] value The tile
+      /// \param pinned \c true when the reader holds a pin on the entry
+      /// \return \c true when the tile was found
+      template <typename T>
+      bool find(const key_type& key, T& value, const bool pinned) {
+        if(! segment_)
+          return false;
+
+        // Find the entry and prevent its eviction while it is read
+        lock();
+        Entry* entry = find_entry(key);
+        if(entry && (! entry->ready))
+          entry = NULL;
+        if(entry)
+          ++entry->readers;
+        unlock();
+        if(entry == NULL)
+          return false;
+
+        madness::archive::BufferInputArchive ar(data() + entry->offset, entry->size);
+        ar & value;
+
+        lock();
+        --entry->readers;
+        if(pinned)
+          --entry->pins;
+        if(! entry->hashed) {
+          // The entry was erased while it was read
+          if(entry->readers == 0l)
+            release(entry);
+        } else {
+          touch(entry);
+        }
+        unlock();
+
+        return true;
+      }
+
+      /// Remove a tile
+
+      /// The entry is removed from its hash bucket so it can no longer be
+      /// found. Its space is released once no process is reading or writing
+      /// the tile data.
+      /// \param key The tile key
+      void erase(const key_type& key) {
+        if(! segment_)
+          return;
+
+        lock();
+        Entry* entry = find_entry(key);
+        if(entry) {
+          entry->pins = 0l;
+          if(entry->ready && (entry->readers == 0l))
+            release(entry);
+          else
+            unhash(entry);
+        }
+        unlock();
+      }
+
+    }; // class SharedTileCache
+
+  } // namespace detail
+} // namespace TiledArray
+
+#endif // TILEDARRAY_SHARED_TILE_CACHE_H__INCLUDED
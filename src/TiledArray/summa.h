@@ -22,16 +22,20 @@
 
 #include <TiledArray/contraction_tensor_impl.h>
 #include <TiledArray/reduce_task.h>
+#include <TiledArray/bcast_group.h>
+#include <TiledArray/shared_tile_cache.h>
 
 namespace TiledArray {
   namespace expressions {
 
     /// Scalable Universal Matrix Multiplication Algorithm (SUMMA)
 
-    /// This algorithm is used to contract dense tensor. The arguments are
-    /// permuted such that the outer and inner indices are fused such that a
-    /// standard matrix multiplication algorithm can be used to contract the
-    /// tensors. SUMMA is described in:
+    /// This algorithm is used to contract distributed tensors. The arguments
+    /// are permuted such that the outer and inner indices are fused such that
+    /// a standard matrix multiplication algorithm can be used to contract the
+    /// tensors. Zero tiles of sparse arguments are not broadcast, pairs that
+    /// contain a zero tile are not contracted, and zero result tiles are not
+    /// stored. SUMMA is described in:
     /// Van De Geijn, R. A.; Watts, J. Concurrency Practice and Experience 1997, 9, 255-274.
     /// \tparam Left The left-hand-argument type
     /// \tparam Right The right-hand-argument type
@@ -41,6 +45,7 @@ namespace TiledArray {
       typedef madness::WorldObject<Summa<Left, Right> > WorldObject_; ///< Madness world object base class
       typedef ContractionTensorImpl<Left, Right> ContractionTensorImpl_;
       typedef typename ContractionTensorImpl_::TensorExpressionImpl_ TensorExpressionImpl_;
+      typedef typename ContractionTensorImpl_::TensorImpl_ TensorImpl_;
 
       // import functions from world object
       using WorldObject_::task;
@@ -63,6 +68,12 @@ namespace TiledArray {
       /// The right tensor cache container type
       typedef madness::ConcurrentHashMap<size_type, madness::Future<right_value_type> > right_container;
 
+      /// The container type of left tiles held for the shared cache readers
+      typedef madness::ConcurrentHashMap<size_type, std::pair<left_value_type, unsigned int> > left_held_container;
+
+      /// The container type of right tiles held for the shared cache readers
+      typedef madness::ConcurrentHashMap<size_type, std::pair<right_value_type, unsigned int> > right_held_container;
+
 
       /// Contraction and reduction task operation type
       typedef detail::ContractReduceOp<Left, Right> contract_reduce_op;
@@ -96,11 +107,15 @@ namespace TiledArray {
       using ContractionTensorImpl_::local_cols_; ///< The number of local element columns
       using ContractionTensorImpl_::local_size_; ///< Number of local elements
 
-      std::vector<ProcessID> row_group_; ///< The group of processes included in this node's row
-      std::vector<ProcessID> col_group_; ///< The group of processes included in this node's column
+      detail::BcastGroup row_group_; ///< The group of processes included in this node's row
+      detail::BcastGroup col_group_; ///< The group of processes included in this node's column
       left_container left_cache_; ///< Cache for left bcast tiles
       right_container right_cache_; ///< Cache for right bcast tiles
+      left_held_container left_held_; ///< Left tiles held for the shared cache readers
+      right_held_container right_held_; ///< Right tiles held for the shared cache readers
+      detail::SharedTileCache& cache_; ///< Tile cache shared by the processes of this node
       std::vector<result_datum> results_; ///< Task object that will contract and reduce tiles
+      TiledArray::detail::Bitset<> masked_; ///< The local results that are not evaluated
 
     private:
       // Not allowed
@@ -109,82 +124,177 @@ namespace TiledArray {
 
       /// Broadcast a tile to child nodes within group
 
-      /// This function will broadcast tiles from
-      template <typename Handler, typename Value>
-      void bcast(Handler handler, const size_type i, const Value& value,
-          const std::vector<ProcessID>& group, const ProcessID rank, const ProcessID root)
+      /// The tile is sent over the network once per host node and then
+      /// forwarded to the other processes on each node. When the node shared
+      /// tile cache is active, the process that receives the tile from
+      /// another node stores it in the cache, and the other processes on its
+      /// node copy it from the cache instead of receiving it in a message.
+      /// A tile that is forwarded through the cache is held in \c held until
+      /// each of those processes has replied, so that it can be sent to them
+      /// in a regular message when it is missing from the cache.
+      /// \tparam Handler The type of the remote task broadcast handler function
+      /// \tparam SharedHandler The type of the remote task broadcast handler
+      /// function for tiles in the shared cache
+      /// \tparam Held The container type of the held tiles
+      /// \tparam Value The value type of the tile to be broadcast
+      /// \param handler The remote task broadcast handler function
+      /// \param shared_handler The remote task broadcast handler function for
+      /// tiles in the shared cache
+      /// \param held The tiles that have been forwarded through the shared cache
+      /// \param i The index of the tile being broadcast
+      /// \param value The tile value being broadcast
+      /// \param row \c true to broadcast along the row group, \c false to
+      /// broadcast along the column group
+      /// \param rank The rank of this process in group
+      /// \param root The broadcast group root node
+      /// \param shared \c true when the tile is in the shared cache
+      /// \sa detail::BcastGroup
+      template <typename Handler, typename SharedHandler, typename Held, typename Value>
+      void bcast(Handler handler, SharedHandler shared_handler, Held& held,
+          const size_type i, const Value& value, const bool row, const ProcessID rank,
+          const ProcessID root, bool shared)
       {
-        const ProcessID size = group.size();
+        const detail::BcastGroup& group = (row ? row_group_ : col_group_);
 
         // Get the group child nodes
-        ProcessID child0, child1;
+        ProcessID children[4];
+        const unsigned int n = group.children(rank, root, children);
+
+        // Store the tile in the shared cache, pinned once for each of the
+        // other processes on this node
+        const int node = group.node(rank);
+        if((! shared) && (group.leader(node, root) == rank) && (group.node_size(node) > 1ul))
+          shared = cache_.insert(cache_key(row, i), value, group.node_size(node) - 1ul);
+
+        // Hold the tile until the children on this node have read it
+        if(shared) {
+          unsigned int readers = 0u;
+          for(unsigned int c = 0u; c < n; ++c)
+            if(group.node(children[c]) == node)
+              ++readers;
+
+          if(readers) {
+            typename Held::accessor acc;
+            held.insert(acc, i);
+            acc->second = std::make_pair(value, readers);
+          }
+        }
+
+        // Send the data to child nodes
+        for(unsigned int c = 0u; c < n; ++c) {
+          if(shared && (group.node(children[c]) == node)) {
+            task(group[children[c]], shared_handler, i, children[c], root, rank);
+          } else {
+            TA_PROFILE_SEND("summa", TiledArray::detail::tile_bytes(value));
+            task(group[children[c]], handler, i, value, children[c], root);
+          }
+        }
+      }
 
-        // Renumber processes so root has me=0
-        const int me = (rank + size - root) % size;
+      /// Release a tile that was forwarded through the shared cache
+
+      /// This function is called when a child has tried to read tile \c i
+      /// from the shared cache. If the tile was missing, it is sent to the
+      /// child in a regular broadcast message instead. The held tile is
+      /// released after the last child on this node has replied.
+      /// \tparam Handler The type of the remote task broadcast handler function
+      /// \tparam Held The container type of the held tiles
+      /// \param handler The remote task broadcast handler function
+      /// \param held The tiles that have been forwarded through the shared cache
+      /// \param row \c true for the row group, \c false for the column group
+      /// \param i The tile index
+      /// \param group_rank The rank of the child within the group
+      /// \param group_root The broadcast group root node
+      /// \param found \c true when the child found the tile in the cache
+      template <typename Handler, typename Held>
+      void bcast_shared_reply(Handler handler, Held& held, const bool row,
+          const size_type i, const ProcessID group_rank, const ProcessID group_root,
+          const bool found)
+      {
+        typename Held::accessor acc;
+        const bool held_tile = held.find(acc, i);
+        TA_ASSERT(held_tile);
+        typename Held::datumT::second_type::first_type value = acc->second.first;
+        if(--(acc->second.second) == 0u)
+          held.erase(acc);
+        else
+          acc.release();
 
-        // Left child
-        child0 = (me << 1) + 1 + root;
-        if((child0 >= size) && (child0 < (size + root)))
-          child0 -= size;
-        if(child0 >= size)
-          child0 = -1;
+        if(! found) {
+          const detail::BcastGroup& group = (row ? row_group_ : col_group_);
+          TA_PROFILE_SEND("summa", TiledArray::detail::tile_bytes(value));
+          task(group[group_rank], handler, i, value, group_rank, group_root);
+        }
+      }
 
-        // Right child
-        child1 = (me << 1) + 2 + root;
-        if((child1 >= size) && (child1 < (size + root)))
-          child1 -= size;
-        if(child1 >= size)
-          child1 = -1;
+      /// Broadcast a left tile from the root of the row group
 
-        // Send the data to child nodes
-        if(child0 != -1)
-          task(group[child0], handler, i, value, child0, root);
-        if(child1 != -1)
-          task(group[child1], handler, i, value, child1, root);
+      /// \param i The index of the tile being broadcast
+      /// \param value The tile value being broadcast
+      /// \param rank The rank of this process in the row group
+      void bcast_row_root(const size_type i, const left_value_type& value, const ProcessID rank) {
+        bcast(& Summa_::bcast_row_handler, & Summa_::bcast_row_shared_handler,
+            left_held_, i, value, true, rank, rank, false);
+      }
+
+      /// Broadcast a right tile from the root of the column group
+
+      /// \param i The index of the tile being broadcast
+      /// \param value The tile value being broadcast
+      /// \param rank The rank of this process in the column group
+      void bcast_col_root(const size_type i, const right_value_type& value, const ProcessID rank) {
+        bcast(& Summa_::bcast_col_handler, & Summa_::bcast_col_shared_handler,
+            right_held_, i, value, false, rank, rank, false);
       }
 
       /// Spawn broadcast task for tile \c i with \c value
 
-      /// If \c value has been set, two remote broadcast tasks will be spawned
+      /// If \c value has been set, the remote broadcast tasks will be spawned
       /// on the child nodes. Otherwise a local task is spawned that will
       /// broadcast the tile to the child nodes when the tile has been set.
-      /// \tparam Handler The type of the remote task broadcast handler function
+      /// \tparam Root The type of the root broadcast function
       /// \tparam Value The value type of the tile to be broadcast
-      /// \param handler The remote task broadcast handler function
+      /// \param root The root broadcast function
       /// \param i The index of the tile being broadcast
       /// \param value The tile value being broadcast
-      /// \param group The broadcast group
       /// \param rank The rank of this process in group
-      template <typename Handler, typename Value>
-      void spawn_bcast_task(Handler handler, const size_type i, const madness::Future<Value>& value,
-          const std::vector<ProcessID>& group, const ProcessID rank)
+      template <typename Root, typename Value>
+      void spawn_bcast_task(Root root, const size_type i,
+          const madness::Future<Value>& value, const ProcessID rank)
       {
         if(value.probe())
-          bcast(handler, i, value, group, rank, rank);
+          (this->*root)(i, value.get(), rank);
         else
-          task(rank_, & Summa_::template bcast<Handler, Value>, handler, i, value,
-              group, rank, rank);
+          task(rank_, root, i, value, rank);
       }
 
-      /// Task function used for broadcasting tiles along the row
+      /// Shared cache key of a broadcast tile
 
+      /// \param row \c true for tiles of the left argument, which are
+      /// broadcast along rows, \c false for tiles of the right argument
       /// \param i The tile index
-      /// \param group_rank The rank of this node within the group
-      /// \param group_root The broadcast group root node
-      void bcast_row_handler(const size_type i, left_value_type& value,
-          const ProcessID group_rank, const ProcessID group_root)
-      {
-        // Broadcast this task to the next nodes in the tree
-        bcast(& Summa_::bcast_row_handler, i, value, row_group_, group_rank, group_root);
+      /// \return The cache key
+      detail::SharedTileCache::key_type cache_key(const bool row, const size_type i) const {
+        return detail::SharedTileCache::make_key(WorldObject_::id(), (row ? 0ul : 1ul), i);
+      }
 
+      /// Copy a broadcast tile into the local cache
+
+      /// \tparam Cache The cache container type
+      /// \tparam Value The tile type
+      /// \param cache The local cache
+      /// \param i The tile index
+      /// \param value The tile
+      template <typename Cache, typename Value>
+      static void set_cache(Cache& cache, const size_type i, const Value& value) {
         // Copy tile into local cache
-        typename left_container::const_accessor acc;
-        const bool erase_cache = ! left_cache_.insert(acc, i);
-        madness::Future<left_value_type> tile = acc->second;
+        typename Cache::const_accessor acc;
+        const bool erase_cache = ! cache.insert(acc, i);
+        madness::Future<Value> tile = acc->second;
 
         // If the local future is already present, the cached value is not needed
         if(erase_cache)
-          left_cache_.erase(acc);
+          cache.erase(acc);
         else
           acc.release();
 
@@ -192,6 +302,62 @@ namespace TiledArray {
         tile.set(value);
       }
 
+      /// Task function used for broadcasting tiles along the row
+
+      /// \param i The tile index
+      /// \param group_rank The rank of this node within the group
+      /// \param group_root The broadcast group root node
+      void bcast_row_handler(const size_type i, left_value_type& value,
+          const ProcessID group_rank, const ProcessID group_root)
+      {
+        TA_PROFILE_RECV("summa", TiledArray::detail::tile_bytes(value));
+
+        // Broadcast this task to the next nodes in the tree
+        bcast(& Summa_::bcast_row_handler, & Summa_::bcast_row_shared_handler,
+            left_held_, i, value, true, group_rank, group_root, false);
+
+        set_cache(left_cache_, i, value);
+      }
+
+      /// Task function used for broadcasting tiles along the row with the shared cache
+
+      /// When the tile is missing from the shared cache, the parent is asked
+      /// to send it in a regular broadcast message.
+      /// \param i The tile index
+      /// \param group_rank The rank of this node within the group
+      /// \param group_root The broadcast group root node
+      /// \param group_parent The rank of the sending node within the group
+      void bcast_row_shared_handler(const size_type i, const ProcessID group_rank,
+          const ProcessID group_root, const ProcessID group_parent)
+      {
+        left_value_type value;
+        const bool found = cache_.find(cache_key(true, i), value, true);
+
+        if(found) {
+          // Broadcast this task to the next nodes in the tree
+          bcast(& Summa_::bcast_row_handler, & Summa_::bcast_row_shared_handler,
+              left_held_, i, value, true, group_rank, group_root, true);
+
+          set_cache(left_cache_, i, value);
+        }
+
+        task(row_group_[group_parent], & Summa_::bcast_row_shared_reply, i,
+            group_rank, group_root, found);
+      }
+
+      /// Task function used to reply to a row broadcast through the shared cache
+
+      /// \param i The tile index
+      /// \param group_rank The rank of the replying node within the group
+      /// \param group_root The broadcast group root node
+      /// \param found \c true when the tile was found in the shared cache
+      void bcast_row_shared_reply(const size_type i, const ProcessID group_rank,
+          const ProcessID group_root, const bool found)
+      {
+        bcast_shared_reply(& Summa_::bcast_row_handler, left_held_, true, i,
+            group_rank, group_root, found);
+      }
+
       /// Task function used for broadcasting tiles along the column
 
       /// \param i The tile index
@@ -200,22 +366,52 @@ namespace TiledArray {
       void bcast_col_handler(const size_type i, right_value_type& value,
           const ProcessID group_rank, const ProcessID group_root)
       {
+        TA_PROFILE_RECV("summa", TiledArray::detail::tile_bytes(value));
+
         // Broadcast this task to the next nodes in the tree
-        bcast(& Summa_::bcast_col_handler, i, value, col_group_, group_rank, group_root);
+        bcast(& Summa_::bcast_col_handler, & Summa_::bcast_col_shared_handler,
+            right_held_, i, value, false, group_rank, group_root, false);
 
-        // Copy tile into local cache
-        typename right_container::const_accessor acc;
-        const bool erase_cache = ! right_cache_.insert(acc, i);
-        madness::Future<right_value_type> tile = acc->second;
+        set_cache(right_cache_, i, value);
+      }
 
-        // If the local future is already present, the cached value is not needed
-        if(erase_cache)
-          right_cache_.erase(acc);
-        else
-          acc.release();
+      /// Task function used for broadcasting tiles along the column with the shared cache
 
-        // Set the local future with the broadcast value
-        tile.set(value);
+      /// When the tile is missing from the shared cache, the parent is asked
+      /// to send it in a regular broadcast message.
+      /// \param i The tile index
+      /// \param group_rank The rank of this node within the group
+      /// \param group_root The broadcast group root node
+      /// \param group_parent The rank of the sending node within the group
+      void bcast_col_shared_handler(const size_type i, const ProcessID group_rank,
+          const ProcessID group_root, const ProcessID group_parent)
+      {
+        right_value_type value;
+        const bool found = cache_.find(cache_key(false, i), value, true);
+
+        if(found) {
+          // Broadcast this task to the next nodes in the tree
+          bcast(& Summa_::bcast_col_handler, & Summa_::bcast_col_shared_handler,
+              right_held_, i, value, false, group_rank, group_root, true);
+
+          set_cache(right_cache_, i, value);
+        }
+
+        task(col_group_[group_parent], & Summa_::bcast_col_shared_reply, i,
+            group_rank, group_root, found);
+      }
+
+      /// Task function used to reply to a column broadcast through the shared cache
+
+      /// \param i The tile index
+      /// \param group_rank The rank of the replying node within the group
+      /// \param group_root The broadcast group root node
+      /// \param found \c true when the tile was found in the shared cache
+      void bcast_col_shared_reply(const size_type i, const ProcessID group_rank,
+          const ProcessID group_root, const bool found)
+      {
+        bcast_shared_reply(& Summa_::bcast_col_handler, right_held_, false, i,
+            group_rank, group_root, found);
       }
 
       /// Broadcast task for rows or columns
@@ -247,20 +443,34 @@ namespace TiledArray {
           if(owner_->left().is_local(i)) {
             if(! owner_->left().get_pmap()->is_replicated()) {
               for(; i < end; i += step) {
+                // Zero tiles are not broadcast
+                if(owner_->left().is_zero(i)) {
+                  col.push_back(col_datum(i, madness::Future<left_value_type>(left_value_type())));
+                  continue;
+                }
+
                 // Take the tile's local copy and add it to the column vector
                 col.push_back(col_datum(i, owner_->left().move(i)));
 
                 // Broadcast the tile to all nodes in the row
-                owner_->spawn_bcast_task(& Summa_::bcast_row_handler, i,
-                    col.back().second, owner_->row_group_, owner_->rank_col_);
+                owner_->spawn_bcast_task(& Summa_::bcast_row_root, i,
+                    col.back().second, owner_->rank_col_);
               }
             } else {
               for(; i < end; i += step)
                 // Take the tile's local copy and add it to the column vector
-                col.push_back(col_datum(i, owner_->left().move(i)));
+                col.push_back(col_datum(i, (owner_->left().is_zero(i) ?
+                    madness::Future<left_value_type>(left_value_type()) :
+                    owner_->left().move(i))));
             }
           } else {
             for(; i < end; i += step) {
+              // Zero tiles are not broadcast
+              if(owner_->left().is_zero(i)) {
+                col.push_back(col_datum(i, madness::Future<left_value_type>(left_value_type())));
+                continue;
+              }
+
               // Insert a future into the cache as a placeholder for the broadcast tile.
               typename left_container::const_accessor acc;
               const bool erase_cache = ! owner_->left_cache_.insert(acc, i);
@@ -297,20 +507,34 @@ namespace TiledArray {
           if(owner_->right().is_local(i)) {
             if(! owner_->right().get_pmap()->is_replicated()) {
               for(; i < end; i += owner_->proc_cols_) {
+                // Zero tiles are not broadcast
+                if(owner_->right().is_zero(i)) {
+                  row.push_back(row_datum(i, madness::Future<right_value_type>(right_value_type())));
+                  continue;
+                }
+
                 // Take the tile's local copy and add it to the row vector
                 row.push_back(row_datum(i, owner_->right().move(i)));
 
                 // Broadcast the tile to all nodes in the column
-                owner_->spawn_bcast_task(& Summa_::bcast_col_handler, i,
-                    row.back().second, owner_->col_group_, owner_->rank_row_);
+                owner_->spawn_bcast_task(& Summa_::bcast_col_root, i,
+                    row.back().second, owner_->rank_row_);
               }
             } else {
               for(; i < end; i += owner_->proc_cols_)
                 // Take the tile's local copy and add it to the row vector
-                row.push_back(row_datum(i, owner_->right().move(i)));
+                row.push_back(row_datum(i, (owner_->right().is_zero(i) ?
+                    madness::Future<right_value_type>(right_value_type()) :
+                    owner_->right().move(i))));
             }
           } else {
             for(; i < end; i += owner_->proc_cols_) {
+              // Zero tiles are not broadcast
+              if(owner_->right().is_zero(i)) {
+                row.push_back(row_datum(i, madness::Future<right_value_type>(right_value_type())));
+                continue;
+              }
+
               // Insert a future into the cache as a placeholder for the broadcast tile.
               typename right_container::const_accessor acc;
               const bool erase_cache = ! owner_->right_cache_.insert(acc, i);
@@ -384,9 +608,20 @@ namespace TiledArray {
 
         // Schedule contraction tasks
         typename std::vector<result_datum>::iterator it = results_.begin();
-        for(typename std::vector<col_datum>::const_iterator col_it = col_k0.begin(); col_it != col_k0.end(); ++col_it)
-          for(typename std::vector<row_datum>::const_iterator row_it = row_k0.begin(); row_it != row_k0.end(); ++row_it, ++it)
-            it->second.add(col_it->second, row_it->second, task_row_col_k2);
+        for(typename std::vector<col_datum>::const_iterator col_it = col_k0.begin(); col_it != col_k0.end(); ++col_it) {
+          const bool col_zero = ContractionTensorImpl_::left().is_zero(col_it->first);
+          for(typename std::vector<row_datum>::const_iterator row_it = row_k0.begin(); row_it != row_k0.end(); ++row_it, ++it) {
+            if(col_zero || ContractionTensorImpl_::right().is_zero(row_it->first)
+                || masked_[it - results_.begin()]) {
+              // Skip pairs with a zero tile or a masked result, but satisfy
+              // the broadcast dependency
+              if(task_row_col_k2)
+                task_row_col_k2->notify();
+            } else {
+              it->second.add(col_it->second, row_it->second, task_row_col_k2);
+            }
+          }
+        }
 
         // Spawn the task for the next iteration
         if(assign) {
@@ -420,20 +655,32 @@ namespace TiledArray {
           row_group_(),
           col_group_(),
           left_cache_(local_rows_ * k_),
-          right_cache_(local_cols_ * k_)
+          right_cache_(local_cols_ * k_),
+          left_held_(),
+          right_held_(),
+          cache_(detail::SharedTileCache::instance(left.get_world())),
+          results_(),
+          masked_(local_size_)
       {
+        // Get the host node of all processes
+        const std::vector<int> nodes = detail::node_ids(WorldObject_::get_world());
+
         if(rank_ < proc_size_) {
           // Fill the row group with all the processes in rank's row
-          row_group_.reserve(proc_cols_);
+          std::vector<ProcessID> row_group;
+          row_group.reserve(proc_cols_);
           ProcessID row_first = rank_ - rank_col_;
           const ProcessID row_last = row_first + proc_cols_;
           for(; row_first < row_last; ++row_first)
-            row_group_.push_back(row_first);
+            row_group.push_back(row_first);
+          row_group_ = detail::BcastGroup(row_group, nodes);
 
           // Fill the col group with all the processes in rank's column
-          col_group_.reserve(proc_rows_);
+          std::vector<ProcessID> col_group;
+          col_group.reserve(proc_rows_);
           for(ProcessID col_first = rank_col_; col_first < proc_size_; col_first += proc_cols_)
-            col_group_.push_back(col_first);
+            col_group.push_back(col_first);
+          col_group_ = detail::BcastGroup(col_group, nodes);
         }
 
         WorldObject_::process_pending();
@@ -469,7 +716,10 @@ namespace TiledArray {
               const size_type ij = i * n_ + j;
               results_.push_back(result_datum(ij,
                   reduce_pair_task(get_world(), contract_reduce_op(*this))));
-              TensorExpressionImpl_::set(ij, results_.back().second.result());
+              if(TensorExpressionImpl_::is_masked(ij))
+                masked_.set(results_.size() - 1ul);
+              else if(! TensorImpl_::is_zero(TensorExpressionImpl_::perm_index(ij)))
+                TensorExpressionImpl_::set(ij, results_.back().second.result());
             }
 
           // Spawn the first step in the algorithm
@@ -0,0 +1,216 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEDARRAY_SYMMETRY_H__INCLUDED
+#define TILEDARRAY_SYMMETRY_H__INCLUDED
+
+#include <TiledArray/permutation.h>
+#include <TiledArray/error.h>
+#include <vector>
+#include <algorithm>
+
+namespace TiledArray {
+
+  /// Permutational symmetry descriptor
+
+  /// A symmetry object describes the group of index permutations under which
+  /// a tensor is invariant, up to a sign. For every element \c g of the group
+  /// and every index \c i the tensor satisfies
+  /// \code
+  /// t[g ^ i] == sign(g) * t[i]
+  /// \endcode
+  /// The group is constructed as the closure of the generators added with
+  /// \c add() . Only the tiles with a canonical (lexicographically smallest)
+  /// index within each orbit need to be stored; every other tile is a
+  /// permuted (and possibly negated) copy of its canonical tile.
+  class Symmetry {
+  public:
+    typedef Symmetry Symmetry_; ///< This object type
+    typedef std::size_t size_type; ///< Size type
+
+    /// Construct a symmetry object with no symmetry (identity only)
+
+    /// \param dim The tensor order
+    explicit Symmetry(const unsigned int dim = 0u) :
+        perms_(1, make_identity(dim)), signs_(1, 1)
+    { }
+
+    /// Copy constructor
+
+    /// \param other The symmetry object to be copied
+    Symmetry(const Symmetry_& other) :
+        perms_(other.perms_), signs_(other.signs_)
+    { }
+
+    /// Assignment operator
+
+    /// \param other The symmetry object to be copied
+    /// \return A reference to this object
+    Symmetry_& operator=(const Symmetry_& other) {
+      perms_ = other.perms_;
+      signs_ = other.signs_;
+      return *this;
+    }
+
+    /// Add a symmetry generator
+
+    /// The symmetry group is extended to the closure of the current group and
+    /// \c perm .
+    /// \param perm The permutation that leaves the tensor invariant
+    /// \param sign The sign of the tensor under \c perm ( \c 1 for symmetric,
+    /// \c -1 for antisymmetric)
+    /// \return A reference to this object
+    /// \throw TiledArray::Exception When the dimension of \c perm does not match
+    /// the dimension of this symmetry, or when \c sign is not \c 1 or \c -1 .
+    Symmetry_& add(const Permutation& perm, const int sign = 1) {
+      TA_USER_ASSERT(perm.dim() == dim(),
+          "The permutation dimension does not match that of the symmetry.");
+      TA_USER_ASSERT((sign == 1) || (sign == -1),
+          "The symmetry sign must be 1 or -1.");
+
+      insert(perm, sign);
+
+      // Close the group under composition
+      for(std::size_t i = 0ul; i < perms_.size(); ++i)
+        for(std::size_t j = 0ul; j <= i; ++j) {
+          insert(perms_[i] ^ perms_[j], signs_[i] * signs_[j]);
+          insert(perms_[j] ^ perms_[i], signs_[i] * signs_[j]);
+        }
+
+      return *this;
+    }
+
+    /// Symmetry dimension accessor
+
+    /// \return The order of the tensor described by this symmetry
+    unsigned int dim() const { return perms_.front().dim(); }
+
+    /// Group order accessor
+
+    /// \return The number of elements in the symmetry group
+    size_type order() const { return perms_.size(); }
+
+    /// Check for the trivial symmetry
+
+    /// \return \c true when the symmetry group contains only the identity
+    bool is_trivial() const { return perms_.size() == 1ul; }
+
+    /// Group element accessor
+
+    /// \param i The group element index
+    /// \return The permutation of the \c i -th group element
+    const Permutation& perm(const size_type i) const {
+      TA_ASSERT(i < perms_.size());
+      return perms_[i];
+    }
+
+    /// Group element sign accessor
+
+    /// \param i The group element index
+    /// \return The sign of the \c i -th group element
+    int sign(const size_type i) const {
+      TA_ASSERT(i < signs_.size());
+      return signs_[i];
+    }
+
+    /// Find the canonical index of \c index
+
+    /// \tparam Index The coordinate index type
+    /// \param[in] index The coordinate index
+    /// \param[out] perm The permutation that maps the canonical index to
+    /// \c index (i.e. <tt>index == perm ^ canonical</tt>)
+    /// \param[out] sign The sign of the \c index tile relative to the
+    /// canonical tile
+    /// \return The canonical index of \c index
+    template <typename Index>
+    Index canonical(const Index& index, Permutation& perm, int& sign) const {
+      TA_ASSERT(index.size() == dim());
+      Index result = index;
+      size_type g = 0ul;
+      for(size_type i = 1ul; i < perms_.size(); ++i) {
+        Index candidate = index;
+        permute(perms_[i], index, candidate);
+        if(std::lexicographical_compare(candidate.begin(), candidate.end(),
+            result.begin(), result.end()))
+        {
+          result = candidate;
+          g = i;
+        }
+      }
+
+      perm = -perms_[g];
+      sign = signs_[g];
+      return result;
+    }
+
+    /// Check for a canonical index
+
+    /// \tparam Index The coordinate index type
+    /// \param index The coordinate index
+    /// \return \c true if \c index is the smallest index in its orbit
+    template <typename Index>
+    bool is_unique(const Index& index) const {
+      TA_ASSERT(index.size() == dim());
+      Index candidate = index;
+      for(size_type i = 1ul; i < perms_.size(); ++i) {
+        permute(perms_[i], index, candidate);
+        if(std::lexicographical_compare(candidate.begin(), candidate.end(),
+            index.begin(), index.end()))
+          return false;
+      }
+      return true;
+    }
+
+  private:
+
+    static Permutation make_identity(const unsigned int dim) {
+      std::vector<std::size_t> p(dim);
+      for(unsigned int i = 0u; i < dim; ++i)
+        p[i] = i;
+      return Permutation(p.begin(), p.end());
+    }
+
+    template <typename Index>
+    static void permute(const Permutation& perm, const Index& index, Index& result) {
+      detail::permute_array(perm.begin(), perm.end(), index.begin(), result.begin());
+    }
+
+    /// Insert a group element if it is not already in the group
+
+    /// \throw TiledArray::Exception When the element is already in the group
+    /// with the opposite sign, which implies the tensor is identically zero.
+    void insert(const Permutation& perm, const int sign) {
+      std::vector<Permutation>::iterator it =
+          std::find(perms_.begin(), perms_.end(), perm);
+      if(it == perms_.end()) {
+        perms_.push_back(perm);
+        signs_.push_back(sign);
+      } else {
+        TA_USER_ASSERT(signs_[std::distance(perms_.begin(), it)] == sign,
+            "The symmetry generators are inconsistent; the tensor would be identically zero.");
+      }
+    }
+
+    std::vector<Permutation> perms_; ///< Group elements
+    std::vector<int> signs_; ///< The sign of each group element
+  }; // class Symmetry
+
+} // namespace TiledArray
+
+#endif // TILEDARRAY_SYMMETRY_H__INCLUDED
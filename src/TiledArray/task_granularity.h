@@ -0,0 +1,100 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEDARRAY_TASK_GRANULARITY_H__INCLUDED
+#define TILEDARRAY_TASK_GRANULARITY_H__INCLUDED
+
+#include <TiledArray/error.h>
+#include <TiledArray/madness.h>
+#include <algorithm>
+
+namespace TiledArray {
+  namespace detail {
+
+    /// Task granularity policy for tile evaluation
+
+    /// The cost of a tile task is estimated by the number of elements in the
+    /// tile. Tiles that are much smaller than the target cost are evaluated
+    /// in batches, so the scheduling overhead is amortized over several tiles,
+    /// and tiles that are much larger than the target cost are evaluated by
+    /// several tasks that each compute a contiguous range of elements.
+    class TaskGranularity {
+    private:
+
+      static std::size_t& target_value() {
+        static std::size_t value = 16384ul;
+        return value;
+      }
+
+    public:
+
+      /// Target task cost accessor
+
+      /// \return The target number of elements evaluated by one task
+      static std::size_t target() { return target_value(); }
+
+      /// Set the target task cost
+
+      /// \param value The target number of elements evaluated by one task
+      /// \throw TiledArray::Exception When \c value is zero
+      static void target(const std::size_t value) {
+        TA_USER_ASSERT(value > 0ul, "The target task size must be greater than zero.");
+        target_value() = value;
+      }
+
+      /// Batch test
+
+      /// \param volume The number of elements in a tile
+      /// \return \c true if the tile should be evaluated with other tiles
+      static bool is_small(const std::size_t volume) {
+        return (volume * 4ul) < target_value();
+      }
+
+      /// Number of tasks used to evaluate a tile
+
+      /// Tiles are only split when they are at least four times larger than
+      /// the target cost, and never into more parts than there are threads.
+      /// \param volume The number of elements in a tile
+      /// \return The number of tasks that should evaluate the tile
+      static std::size_t splits(const std::size_t volume) {
+        if(volume < (target_value() * 4ul))
+          return 1ul;
+        const std::size_t threads = madness::ThreadPool::size() + 1ul;
+        return std::min(volume / target_value(), threads);
+      }
+
+      /// Element range of one part of a split tile
+
+      /// \param volume The number of elements in the tile
+      /// \param parts The number of parts
+      /// \param part The part index
+      /// \return The first element of \c part
+      static std::size_t first(const std::size_t volume, const std::size_t parts,
+          const std::size_t part)
+      {
+        TA_ASSERT(part <= parts);
+        return (volume / parts) * part + std::min(volume % parts, part);
+      }
+
+    }; // class TaskGranularity
+
+  } // namespace detail
+} // namespace TiledArray
+
+#endif // TILEDARRAY_TASK_GRANULARITY_H__INCLUDED
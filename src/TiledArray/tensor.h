@@ -24,6 +24,7 @@
 #include <TiledArray/range.h>
 #include <TiledArray/madness.h>
 #include <TiledArray/math/functional.h>
+#include <TiledArray/math/team.h>
 
 namespace TiledArray {
 
@@ -223,7 +224,7 @@ namespace TiledArray {
           pimpl_.reset(new Impl(other.range(), other.begin()));
       } else {
         TA_ASSERT(pimpl_->range_ == other.range());
-        math::vector_assign(pimpl_->data_.size(), other.data(), pimpl_->data_.data(),
+        math::team_vector_assign(pimpl_->data_.size(), other.data(), pimpl_->data_.data(),
             math::PlusAssign<value_type, typename Tensor<U, AU>::value_type>());
       }
 
@@ -243,7 +244,7 @@ namespace TiledArray {
               math::Negate<typename Tensor<U, AU>::value_type, value_type>()));
       } else {
         TA_ASSERT(pimpl_->range_ == other.range());
-        math::vector_assign(pimpl_->data_.size(), other.data(), pimpl_->data_.data(),
+        math::team_vector_assign(pimpl_->data_.size(), other.data(), pimpl_->data_.data(),
             math::MinusAssign<value_type, typename Tensor<U, AU>::value_type>());
       }
 
@@ -262,7 +263,7 @@ namespace TiledArray {
           pimpl_.reset(new Impl(other.range(), 0));
       } else {
         TA_ASSERT(pimpl_->range_ == other.range());
-        math::vector_assign(pimpl_->data_.size(), other.data(), pimpl_->data_.data(),
+        math::team_vector_assign(pimpl_->data_.size(), other.data(), pimpl_->data_.data(),
             math::MultipliesAssign<value_type, typename Tensor<U, AU>::value_type>());
       }
 
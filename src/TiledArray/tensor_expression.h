@@ -21,8 +21,14 @@
 #define TILEDARRAY_TENSOR_EXPRESSION_IMPL_H__INCLUDED
 
 #include <TiledArray/tensor_impl.h>
+#include <TiledArray/fixed_range.h>
 #include <TiledArray/expressions/variable_list.h>
 #include <TiledArray/pmap/blocked_pmap.h>
+#include <TiledArray/profile.h>
+#include <TiledArray/affinity.h>
+#include <TiledArray/symmetry.h>
+#include <sstream>
+#include <typeinfo>
 
 namespace TiledArray {
 
@@ -65,27 +71,65 @@ namespace TiledArray {
                                   ///< This is just here as a sanity check to make sure evaluate is only run once.
                                   ///< It is NOT thread safe.
         numeric_type scale_; ///< The scale factor for this expression
+        shape_type mask_; ///< The result tiles that are evaluated (zero size == all)
+
+        /// Element visitor that copies a tile element to its permuted position
+        class PermuteValue {
+        private:
+          value_type& result_;
+          const value_type& value_;
+
+        public:
+          PermuteValue(value_type& result, const value_type& value) :
+            result_(result), value_(value)
+          { }
+
+          void operator()(const size_type i, const size_type o) const {
+            result_[o] = value_[i];
+          }
+        }; // class PermuteValue
+
+        /// Tile visitor that copies a shape bit to its permuted position
+        class PermuteShape {
+        private:
+          shape_type& result_;
+          const shape_type& shape_;
+
+        public:
+          PermuteShape(shape_type& result, const shape_type& shape) :
+            result_(result), shape_(shape)
+          { }
+
+          void operator()(const size_type i, const size_type o) const {
+            if(shape_[i])
+              result_.set(o);
+          }
+        }; // class PermuteShape
 
         /// Task function for permuting result tensor
 
+        /// The permutation is run on the NUMA node that holds \c value .
         /// \param index The index of this tile
         /// \param value The unpermuted result tile
         void permute_and_set_with_value(const size_type index, const value_type& value) {
+          TiledArray::detail::run_near(TensorImpl_::get_world(), value.data(), this,
+              & TensorExpressionImpl_::permute_tile, index, value);
+        }
+
+        /// Permute and set tile \c index
+
+        /// \param index The index of this tile
+        /// \param value The unpermuted result tile
+        void permute_tile(const size_type index, const value_type& value) {
           // Create tensor to hold the result
           value_type result(perm_ ^ value.range());
 
           // Construct the inverse permuted weight and size for this tensor
           std::vector<std::size_t> ip_weight = (-perm_) ^ result.range().weight();
-          const typename value_type::range_type::index& start = value.range().start();
-
-          // Coordinated iterator for the value range
-          typename value_type::range_type::const_iterator value_range_it =
-              value.range().begin();
 
           // permute the data
-          const size_type end = result.size();
-          for(size_type value_it = 0ul; value_it != end; ++value_it, ++value_range_it)
-            result[TiledArray::detail::calc_ordinal(*value_range_it, ip_weight, start)] = value[value_it];
+          TiledArray::detail::permute_each(value.range(), ip_weight, 0ul, result.size(),
+              PermuteValue(result, value));
 
           // Store the permuted tensor
           TensorImpl_::set(TensorImpl_::range().ord(perm_ ^ trange_.tiles().idx(index)),
@@ -130,6 +174,32 @@ namespace TiledArray {
             return i;
         }
 
+        /// Check for a result mask
+
+        /// \return \c true when only some of the result tiles are evaluated
+        bool has_mask() const { return mask_.size() != 0ul; }
+
+        /// Check for a result tile that is not evaluated
+
+        /// Derived classes should not compute or set the tiles that are
+        /// masked, and should release the argument tiles they would have used.
+        /// \param i The index in the unpermuted index space
+        /// \return \c true when tile \c i is excluded by the result mask
+        bool is_masked(size_type i) const {
+          return has_mask() && (! mask_[perm_index(i)]);
+        }
+
+        /// Check for a permuted result
+
+        /// \return \c true when the result tiles are permuted copies of the
+        /// tiles evaluated by the derived class
+        bool is_permuted() const { return perm_.dim() != 0ul; }
+
+        /// Check that the structure of this tensor has been evaluated
+
+        /// \return \c true when the shape of this tensor has its final value
+        bool is_evaluated() const { return evaluated_; }
+
       public:
         /// Constructor
 
@@ -146,7 +216,8 @@ namespace TiledArray {
           perm_(),
           trange_(trange),
           evaluated_(false),
-          scale_(1)
+          scale_(1),
+          mask_(0ul)
         { }
 
         virtual ~TensorExpressionImpl() { }
@@ -186,6 +257,20 @@ namespace TiledArray {
           return trange_.make_tile_range(i);
         }
 
+        /// Restrict the evaluation to a subset of the result tiles
+
+        /// Only the result tiles that are set in \c mask are evaluated, the
+        /// others are never set. The mask applies to this expression only, so
+        /// the child expressions still evaluate all of their tiles. This must
+        /// be called before \c eval() .
+        /// \param mask The result tiles to be evaluated, in the layout of the
+        /// result variable list
+        void mask(const shape_type& mask) {
+          TA_ASSERT(! evaluated_);
+          TA_ASSERT(mask.size() == TensorImpl_::size());
+          mask_ = mask;
+        }
+
         /// Modify the expression scale factor
 
         /// scale = scale * value
@@ -203,12 +288,83 @@ namespace TiledArray {
         /// \return The current scale factor
         numeric_type scale() const { return scale_; }
 
+        /// Estimated tile density
+
+        /// This value may be used before the tensor is evaluated, e.g. to
+        /// choose an evaluation order. The shape of a sparse tensor is not set
+        /// until it is evaluated, so derived classes should estimate the
+        /// density from their arguments before then. The default
+        /// implementation counts the non-zero tiles of an evaluated tensor,
+        /// and assumes an unevaluated tensor is dense.
+        /// \return The fraction of non-zero tiles
+        virtual double density() const {
+          if(TensorImpl_::is_dense() || (! evaluated_))
+            return 1.0;
+          return double(TensorImpl_::shape().count()) / double(TensorImpl_::size());
+        }
+
+        /// Preferred process map for the result tiles
+
+        /// Evaluating this expression with the preferred process map, in the
+        /// current variable order, produces each result tile on the process
+        /// that already holds the data it is computed from. The default
+        /// implementation has no preference.
+        /// \return The preferred process map, or an empty pointer
+        virtual std::shared_ptr<pmap_interface> result_pmap() const {
+          return std::shared_ptr<pmap_interface>();
+        }
+
+        /// Check for result tiles that may be modified
+
+        /// The result tiles of an expression are temporaries owned by the
+        /// expression, so a caller that takes a tile with \c move() may modify
+        /// it in place. Derived classes that store tiles shared with other
+        /// objects must return \c false . This is only valid after the
+        /// structure of the expression has been evaluated.
+        /// \return \c true when the result tiles may be modified
+        virtual bool is_consumable() const { return true; }
+
+        /// Write the structural key of this expression
+
+        /// Two expressions with equal keys compute the same result from the
+        /// same arrays. The default key is unique to this object.
+        /// \param os The output stream for the key
+        virtual void make_key(std::ostream& os) const { os << "@" << this; }
+
+        /// Collect the arrays read by this expression
+
+        /// \param[out] arrays The addresses of the arrays read by this
+        /// expression are appended to this list
+        virtual void collect_arrays(std::vector<const void*>&) const { }
+
 
         virtual void assign(std::shared_ptr<TensorExpressionImpl_>& pimpl, TensorExpression<Tile>& other) {
           pimpl = other.pimpl_;
           other.pimpl_.reset();
         }
 
+        /// Add a tensor expression to this object
+
+        /// Only expressions that refer to an array may be accumulation targets.
+        /// \param pimpl A shared pointer to this object
+        /// \param other The expression to be accumulated
+        /// \param subtract \c true when \c other is subtracted
+        virtual void accumulate(std::shared_ptr<TensorExpressionImpl_>&, TensorExpression<Tile>&, const bool) {
+          TA_USER_ASSERT(false, "You cannot accumulate into a tensor expression that is not an array.");
+        }
+
+      protected:
+
+        /// Write the variable list and scale factor of this expression to a key
+
+        /// \param os The output stream for the key
+        void make_key_suffix(std::ostream& os) const {
+          os << "[";
+          for(VariableList::const_iterator it = vars_.begin(); it != vars_.end(); ++it)
+            os << (it == vars_.begin() ? "" : ",") << *it;
+          os << "]*" << scale_;
+        }
+
       private:
 
         /// Function for evaluating this tensor's tiles
@@ -265,22 +421,17 @@ namespace TiledArray {
               // Construct the inverse permuted weight and size for this tensor
               std::vector<std::size_t> ip_weight =
                   (-perm_) ^ TensorImpl_::trange().tiles().weight();
-              const typename range_type::index& start = trange_.tiles().start();
-
-              // Get range iterator
-              typename range_type::const_iterator range_it =
-                  trange_.tiles().begin();
 
               // Construct temp shape
               const size_type size = TensorImpl_::size();
-              TiledArray::detail::Bitset<> s0(TensorImpl_::size());
+              shape_type s0(size);
               this->make_shape(s0);
 
               // Set the new shape
-              for(size_type i = 0ul; i < size; ++i, ++range_it)
-                if(s0[i])
-                  TensorImpl_::shape(TiledArray::detail::calc_ordinal(*range_it,
-                      ip_weight, start), true);
+              shape_type s1(size);
+              TiledArray::detail::permute_each(trange_.tiles(), ip_weight, 0ul, size,
+                  PermuteShape(s1, s0));
+              TensorImpl_::shape(s1);
             }
 
           } else {
@@ -374,6 +525,28 @@ namespace TiledArray {
         return *this;
       }
 
+      /// Add a tensor expression to the array referenced by this expression
+
+      /// Each tile of \c other is added to the matching array tile as soon as
+      /// it is evaluated, without a temporary array for \c other . The tiled
+      /// ranges must match.
+      /// \param other The tensor expression to be added
+      /// \return A reference to this object
+      TensorExpression_& operator+=(const TensorExpression_& other) {
+        pimpl_->accumulate(pimpl_, const_cast<TensorExpression_&>(other), false);
+        return *this;
+      }
+
+      /// Subtract a tensor expression from the array referenced by this expression
+
+      /// \param other The tensor expression to be subtracted
+      /// \return A reference to this object
+      /// \sa operator+=()
+      TensorExpression_& operator-=(const TensorExpression_& other) {
+        pimpl_->accumulate(pimpl_, const_cast<TensorExpression_&>(other), true);
+        return *this;
+      }
+
       /// Evaluate tensor to destination
 
       /// \tparam Dest The destination tensor type
@@ -405,15 +578,100 @@ namespace TiledArray {
         TA_ASSERT(pimpl_->range().dim() == DIM);
         typedef Array<typename value_type::value_type, DIM, value_type> array_type;
 
-        // Evaluate this tensor and wait
-        pimpl_->eval(pimpl_->vars(),
-            std::shared_ptr<pmap_interface>(
-            new TiledArray::detail::BlockedPmap(pimpl_->get_world(),
-            pimpl_->size()))).get();
+        // Evaluate this tensor
+        return const_cast<TensorExpression*>(this)->eval_to_array<array_type>(pimpl_->vars(),
+            select_pmap(pimpl_->vars(), std::shared_ptr<pmap_interface>()));
+      }
+
+      /// Evaluate this tensor expression into a new array
+
+      /// When the result is dense, this function does not wait for the
+      /// evaluation. The array is constructed immediately, and its tiles are
+      /// set as they are evaluated, so reading a tile only waits for that
+      /// tile. The shape of a sparse result is only known after the structure
+      /// of the expression has been evaluated, so for sparse results this
+      /// function waits for the structure, but not for the tiles.
+      /// \tparam A The array type
+      /// \param vars The result variable list
+      /// \param pmap The process map of the result array
+      /// \return An array that holds the result tiles
+      template <typename A>
+      A eval_to_array(const VariableList& vars, const std::shared_ptr<pmap_interface>& pmap) {
+        TA_ASSERT(pimpl_);
+        if(pimpl_->is_dense()) {
+          // The tiled range must be read before evaluation starts, since the
+          // evaluation task permutes it.
+          A array(pimpl_->get_world(), (vars != pimpl_->vars() ?
+              vars.permutation(pimpl_->vars()) ^ pimpl_->trange() : pimpl_->trange()), pmap);
+
+          madness::Future<bool> done = pimpl_->eval(vars, pmap);
+          pimpl_->get_world().taskq.add(& TensorExpression_::template move_to_array<A>,
+              array, pimpl_, done, madness::TaskAttributes::hipri());
+
+          return array;
+        }
+
+        pimpl_->eval(vars, pmap).get();
+        return convert_to_array<A>();
+      }
+
+      /// Evaluate this tensor expression into a new symmetric array
+
+      /// Only the result tiles with a canonical index, as defined by \c sym ,
+      /// are evaluated and stored in the result. The child expressions are
+      /// still evaluated in full, e.g. a symmetric argument array is expanded.
+      /// The caller must know that the result has the symmetry \c sym , since
+      /// it is not checked. This function waits in the same cases as
+      /// \c eval_to_array(vars,pmap) .
+      /// \tparam A The array type
+      /// \param vars The result variable list
+      /// \param pmap The process map of the result array
+      /// \param sym The permutational symmetry of the result
+      /// \return A symmetric array that holds the canonical result tiles
+      template <typename A>
+      A eval_to_array(const VariableList& vars, const std::shared_ptr<pmap_interface>& pmap,
+          const Symmetry& sym)
+      {
+        TA_ASSERT(pimpl_);
+        const trange_type trange = (vars != pimpl_->vars() ?
+            vars.permutation(pimpl_->vars()) ^ pimpl_->trange() : pimpl_->trange());
+        A array(pimpl_->get_world(), trange, sym, pmap);
+        pimpl_->mask(array.get_shape());
+
+        if(pimpl_->is_dense()) {
+          madness::Future<bool> done = pimpl_->eval(vars, pmap);
+          pimpl_->get_world().taskq.add(& TensorExpression_::template move_to_array<A>,
+              array, pimpl_, done, madness::TaskAttributes::hipri());
+
+          return array;
+        }
+
+        pimpl_->eval(vars, pmap).get();
+        A result(pimpl_->get_world(), trange, sym, pimpl_->shape(), pmap);
+        move_to_array(result, pimpl_, true);
+        return result;
+      }
+
+    private:
+
+      /// Move the local result tiles into an array
 
-        return const_cast<TensorExpression*>(this)->convert_to_array<Array<typename value_type::value_type, DIM, value_type> >();
+      /// Only the non-zero tiles that are stored by \c array are moved, i.e.
+      /// the canonical tiles of a symmetric array.
+      /// \tparam A The array type
+      /// \param array The destination array
+      /// \param pimpl The evaluated expression
+      template <typename A>
+      static void move_to_array(A array, const std::shared_ptr<impl_type>& pimpl, bool) {
+        typename pmap_interface::const_iterator it = pimpl->pmap()->begin();
+        const typename pmap_interface::const_iterator end = pimpl->pmap()->end();
+        for(; it != end; ++it)
+          if((! array.is_zero(*it)) && array.is_unique(*it))
+            array.set(*it, pimpl->move(*it));
       }
 
+    public:
+
       template <typename A>
       A convert_to_array() {
         if(pimpl_->is_dense()) {
@@ -523,6 +781,88 @@ namespace TiledArray {
         return pimpl_->is_dense();
       }
 
+      /// Estimated tile density
+
+      /// \return The fraction of non-zero tiles
+      double density() const {
+        TA_ASSERT(pimpl_);
+        return pimpl_->density();
+      }
+
+      /// Check for result tiles that may be modified
+
+      /// \return \c true when the tiles taken with \c move() may be modified
+      /// in place
+      bool is_consumable() const {
+        TA_ASSERT(pimpl_);
+        return pimpl_->is_consumable();
+      }
+
+      /// Preferred process map accessor
+
+      /// \return The process map preferred for the result tiles, or an empty
+      /// pointer
+      std::shared_ptr<pmap_interface> result_pmap() const {
+        TA_ASSERT(pimpl_);
+        return pimpl_->result_pmap();
+      }
+
+      /// Select the process map for the evaluation of this expression
+
+      /// When \c vars is the current variable list, the process map preferred
+      /// by the expression is used, so result tiles stay where they are
+      /// computed. Otherwise the destination process map \c pmap is used, and
+      /// when there is none, a new blocked process map is used. Replicated
+      /// process maps and process maps of a different size are ignored.
+      /// \param vars The result variable list
+      /// \param pmap The process map of the destination, or an empty pointer
+      /// \return The process map for the result tiles
+      std::shared_ptr<pmap_interface> select_pmap(const VariableList& vars,
+          const std::shared_ptr<pmap_interface>& pmap) const
+      {
+        TA_ASSERT(pimpl_);
+        if(vars == pimpl_->vars()) {
+          std::shared_ptr<pmap_interface> result = pimpl_->result_pmap();
+          if(result && (result->size() == pimpl_->size()) && (! result->is_replicated()))
+            return result;
+        }
+
+        if(pmap && (pmap->size() == pimpl_->size()) && (! pmap->is_replicated()))
+          return pmap;
+
+        return std::shared_ptr<pmap_interface>(
+            new TiledArray::detail::BlockedPmap(pimpl_->get_world(), pimpl_->size()));
+      }
+
+      /// Structural key accessor
+
+      /// Two expressions with equal keys compute the same result from the
+      /// same arrays.
+      /// \return The structural key of this expression
+      std::string key() const {
+        TA_ASSERT(pimpl_);
+        std::stringstream ss;
+        pimpl_->make_key(ss);
+        return ss.str();
+      }
+
+      /// Write the structural key of this expression
+
+      /// \param os The output stream for the key
+      void make_key(std::ostream& os) const {
+        TA_ASSERT(pimpl_);
+        pimpl_->make_key(os);
+      }
+
+      /// Collect the arrays read by this expression
+
+      /// \param[out] arrays The addresses of the arrays read by this
+      /// expression are appended to this list
+      void collect_arrays(std::vector<const void*>& arrays) const {
+        TA_ASSERT(pimpl_);
+        pimpl_->collect_arrays(arrays);
+      }
+
       /// Tensor shape accessor
 
       /// \return A reference to the tensor shape map
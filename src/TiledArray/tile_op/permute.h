@@ -28,10 +28,103 @@
 
 #include <TiledArray/tensor.h>
 #include <TiledArray/permutation.h>
+#include <TiledArray/fixed_range.h>
+#include <TiledArray/math/team.h>
 
 namespace TiledArray {
   namespace math {
 
+    namespace detail {
+
+      /// Identity element operation
+      struct PermuteIdentity {
+        template <typename T>
+        const T& operator()(const T& t) const { return t; }
+      }; // struct PermuteIdentity
+
+      /// Element visitor that applies an operation to a tensor element
+      template <typename Res, typename Arg, typename Op>
+      class PermuteElement {
+      private:
+        Res& result_;
+        const Arg& arg_;
+        const Op& op_;
+
+      public:
+        PermuteElement(Res& result, const Arg& arg, const Op& op) :
+          result_(result), arg_(arg), op_(op)
+        { }
+
+        /// Set result element \c o from argument element \c i
+        void operator()(const std::size_t i, const std::size_t o) const {
+          result_[o] = op_(arg_[i]);
+        }
+      }; // class PermuteElement
+
+      /// Element visitor that applies an operation to a pair of tensor elements
+      template <typename Res, typename Left, typename Right, typename Op>
+      class PermuteElement2 {
+      private:
+        Res& result_;
+        const Left& left_;
+        const Right& right_;
+        const Op& op_;
+
+      public:
+        PermuteElement2(Res& result, const Left& left, const Right& right, const Op& op) :
+          result_(result), left_(left), right_(right), op_(op)
+        { }
+
+        /// Set result element \c o from argument elements \c i
+        void operator()(const std::size_t i, const std::size_t o) const {
+          result_[o] = op_(left_[i], right_[i]);
+        }
+      }; // class PermuteElement2
+
+      /// Team kernel that applies an operation to a tensor and permutes the result
+      template <typename Res, typename Arg, typename Op>
+      class TeamPermute {
+      private:
+        Res& result_;
+        const Arg& arg_;
+        const std::vector<std::size_t>& ip_weight_;
+        const Op& op_;
+
+      public:
+        TeamPermute(Res& result, const Arg& arg, const std::vector<std::size_t>& ip_weight, const Op& op) :
+          result_(result), arg_(arg), ip_weight_(ip_weight), op_(op)
+        { }
+
+        void operator()(const std::size_t first, const std::size_t last) const {
+          TiledArray::detail::permute_each(arg_.range(), ip_weight_, first, last,
+              PermuteElement<Res, Arg, Op>(result_, arg_, op_));
+        }
+      }; // class TeamPermute
+
+      /// Team kernel that applies an operation to a pair of tensors and permutes the result
+      template <typename Res, typename Left, typename Right, typename Op>
+      class TeamPermute2 {
+      private:
+        Res& result_;
+        const Left& left_;
+        const Right& right_;
+        const std::vector<std::size_t>& ip_weight_;
+        const Op& op_;
+
+      public:
+        TeamPermute2(Res& result, const Left& left, const Right& right,
+            const std::vector<std::size_t>& ip_weight, const Op& op) :
+          result_(result), left_(left), right_(right), ip_weight_(ip_weight), op_(op)
+        { }
+
+        void operator()(const std::size_t first, const std::size_t last) const {
+          TiledArray::detail::permute_each(left_.range(), ip_weight_, first, last,
+              PermuteElement2<Res, Left, Right, Op>(result_, left_, right_, op_));
+        }
+      }; // class TeamPermute2
+
+    } // namespace detail
+
     /// Permute a tensor
 
     /// Permute \c tensor by \c perm and place the permuted result in \c result .
@@ -46,24 +139,7 @@ namespace TiledArray {
     inline void permute(Tensor<ResT,ResA>& result, const Permutation& perm,
         const Tensor<ArgT, ArgA>& tensor)
     {
-      TA_ASSERT(perm.dim() == tensor.range().dim());
-
-      // Create tensor to hold the result
-      result = perm ^ tensor.range();
-
-      // Construct the inverse permuted weight and size for this tensor
-      std::vector<std::size_t> ip_weight = (-perm) ^ result.range().weight();
-      const typename Tensor<ArgT,ArgA>::range_type::size_array& start =
-          tensor.range().start();
-
-      // Coordinated iterator for the value range
-      typename Tensor<ArgT,ArgA>::range_type::const_iterator it =
-          tensor.range().begin();
-
-      // permute the data
-      const std::size_t end = result.size();
-      for(std::size_t i = 0ul; i != end; ++i, ++it)
-        result[TiledArray::detail::calc_ordinal(*it, ip_weight, start)] = tensor[i];
+      permute(result, perm, tensor, detail::PermuteIdentity());
     }
 
     /// Apply an operation to a tensor and permute the result
@@ -90,16 +166,11 @@ namespace TiledArray {
 
       // Construct the inverse permuted weight and size for this tensor
       std::vector<std::size_t> ip_weight = (-perm) ^ result.range().weight();
-      const typename Tensor<ArgT,ArgA>::range_type::size_array& start = tensor.range().start();
-
-      // Coordinated iterator for the value range
-      typename Tensor<ArgT,ArgA>::range_type::const_iterator it =
-          tensor.range().begin();
 
       // permute the data
       const std::size_t end = result.size();
-      for(std::size_t i = 0ul; i != end; ++i, ++it)
-        result[TiledArray::detail::calc_ordinal(*it, ip_weight, start)] = op(tensor[i]);
+      team_for(end, end, detail::TeamPermute<Tensor<ResT,ResA>, Tensor<ArgT,ArgA>, Op>(
+          result, tensor, ip_weight, op));
     }
 
     /// Apply an operation to a pair of tensors and permute the result
@@ -131,17 +202,11 @@ namespace TiledArray {
 
       // Construct the inverse permuted weight and size for this tensor
       std::vector<std::size_t> ip_weight = (-perm) ^ result.range().weight();
-      const typename Tensor<LeftT, LeftA>::range_type::size_array& start =
-          left.range().start();
-
-      // Coordinated iterator for the value range
-      typename Tensor<LeftT, LeftA>::range_type::const_iterator it =
-          left.range().begin();
 
       // permute the data
       const std::size_t end = result.size();
-      for(std::size_t i = 0ul; i != end; ++i, ++it)
-        result[TiledArray::detail::calc_ordinal(*it, ip_weight, start)] = op(left[i], right[i]);
+      team_for(end, end, detail::TeamPermute2<Tensor<ResT,ResA>, Tensor<LeftT,LeftA>,
+          Tensor<RightT,RightA>, Op>(result, left, right, ip_weight, op));
     }
 
   }  // namespace math
@@ -0,0 +1,85 @@
+/*
+ *  This file is a part of TiledArray.
+ *  Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TILEDARRAY_TILE_TRUNCATION_H__INCLUDED
+#define TILEDARRAY_TILE_TRUNCATION_H__INCLUDED
+
+#include <TiledArray/error.h>
+#include <cmath>
+#include <cstdlib>
+
+namespace TiledArray {
+  namespace detail {
+
+    /// Tile truncation policy
+
+    /// Tiles with a Frobenius norm that is less than a threshold are removed
+    /// from an array by \c Array::truncate() . When the automatic truncation
+    /// threshold is greater than zero, arrays are truncated with it after an
+    /// expression is assigned or added to them.
+    class TileTruncation {
+    private:
+
+      static double& threshold_value() {
+        static double value = 0.0;
+        return value;
+      }
+
+    public:
+
+      /// Automatic truncation threshold accessor
+
+      /// \return The threshold used after expression assignment, or zero when
+      /// arrays are not truncated automatically
+      static double threshold() { return threshold_value(); }
+
+      /// Set the automatic truncation threshold
+
+      /// Automatic truncation waits for the assigned tiles to be evaluated
+      /// and is collective, so it must be set to the same value on all
+      /// processes.
+      /// \param value The new threshold, where zero disables automatic truncation
+      /// \throw TiledArray::Exception When \c value is negative
+      static void threshold(const double value) {
+        TA_USER_ASSERT(value >= 0.0, "The truncation threshold must not be negative.");
+        threshold_value() = value;
+      }
+
+      /// Frobenius norm of a tile
+
+      /// \tparam Tile The tile type
+      /// \param tile The tile
+      /// \return The square root of the sum of the squared magnitudes of the
+      /// elements of \c tile
+      template <typename Tile>
+      static double norm(const Tile& tile) {
+        double result = 0.0;
+        for(typename Tile::const_iterator it = tile.begin(); it != tile.end(); ++it) {
+          const double value = std::abs(*it);
+          result += value * value;
+        }
+        return std::sqrt(result);
+      }
+
+    }; // class TileTruncation
+
+  } // namespace detail
+} // namespace TiledArray
+
+#endif // TILEDARRAY_TILE_TRUNCATION_H__INCLUDED
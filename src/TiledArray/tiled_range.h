@@ -159,6 +159,37 @@ namespace TiledArray {
       return result;
     }
 
+    /// Convert an element index to a tile index
+
+    /// Unlike the version that returns the tile index, \c result is reused
+    /// and no memory is allocated when its capacity is sufficient.
+    /// \tparam Index the index type
+    /// \param index The element index to convert
+    /// \param[out] result The tile index that corresponds to \c index
+    template <typename Index>
+    void element_to_tile(const Index& index, typename range_type::index& result) const {
+      const unsigned int dim = range_.dim();
+      result.resize(dim);
+      for(size_type i = 0; i < dim; ++i)
+        result[i] = ranges_[i].element2tile(index[i]);
+    }
+
+    /// Convert an element index to a tile ordinal index
+
+    /// \tparam Index the index type
+    /// \param index The element index to convert
+    /// \return The ordinal index of the tile that contains \c index
+    template <typename Index>
+    size_type element_to_tile_ord(const Index& index) const {
+      TA_ASSERT(element_range_.includes(index));
+      const unsigned int dim = range_.dim();
+      size_type result = 0ul;
+      for(size_type i = 0; i < dim; ++i)
+        result += (ranges_[i].element2tile(index[i]) - range_.start()[i]) * range_.weight()[i];
+
+      return result;
+    }
+
     /// Tile dimension boundary array accessor
 
     /// \return A reference to the array of Range1 objects.
@@ -21,6 +21,7 @@
 #define TILEDARRAY_TILED_RANGE1_H__INCLUDED
 
 #include <TiledArray/range.h>
+#include <algorithm>
 
 namespace TiledArray {
 
@@ -29,6 +30,9 @@ namespace TiledArray {
   /// the format {a0, a1, a2, ...}, where 0 <= a0 < a1 < a2 < ... Each tile is
   /// defined as [a0,a1), [a1,a2), ... The number of tiles in the range will be
   /// equal to one less than the number of elements in the array.
+  /// Only the tile boundaries are stored. When all tiles, except possibly the
+  /// last, have the same size, the tile that contains an element is computed
+  /// directly; otherwise it is found with a binary search of the boundaries.
   class TiledRange1 {
   private:
     struct Enabler { };
@@ -40,7 +44,7 @@ namespace TiledArray {
     /// Default constructor, range of 0 tiles and elements.
     TiledRange1() :
         range_(0,0), element_range_(0,0),
-        tile_ranges_(1, range_type(0,0)), elem2tile_(1, 0)
+        tile_ranges_(1, range_type(0,0)), block_size_(0ul)
     {
       init_map_();
     }
@@ -50,7 +54,7 @@ namespace TiledArray {
     template <typename RandIter>
     TiledRange1(RandIter first, RandIter last, const size_type start_tile_index = 0,
         typename madness::enable_if<detail::is_random_iterator<RandIter>, Enabler >::type = Enabler()) :
-        range_(), element_range_(), tile_ranges_(), elem2tile_()
+        range_(), element_range_(), tile_ranges_(), block_size_(0ul)
     {
       TA_STATIC_ASSERT(detail::is_random_iterator<RandIter>::value);
       init_tiles_(first, last, start_tile_index);
@@ -60,7 +64,7 @@ namespace TiledArray {
     /// Copy constructor
     TiledRange1(const TiledRange1& rng) :
         range_(rng.range_), element_range_(rng.element_range_),
-        tile_ranges_(rng.tile_ranges_), elem2tile_(rng.elem2tile_)
+        tile_ranges_(rng.tile_ranges_), block_size_(rng.block_size_)
     { }
 
     /// Construct a 1D tiled range.
@@ -72,7 +76,9 @@ namespace TiledArray {
     /// \param n The number of tiles.
     /// \param t0 The first lower bound
     /// \param t1 ... are the tile boundaries.
-    explicit TiledRange1(const size_type start_tile_index, const std::size_t n, const size_type t0, const size_type t1, ...) {
+    explicit TiledRange1(const size_type start_tile_index, const std::size_t n, const size_type t0, const size_type t1, ...) :
+        range_(), element_range_(), tile_ranges_(), block_size_(0ul)
+    {
       TA_ASSERT(n >= 1);
       va_list ap;
       va_start(ap, t1);
@@ -110,7 +116,7 @@ namespace TiledArray {
       if(! includes(element_range_, e))
         return tile_ranges_.end();
       const_iterator result = tile_ranges_.begin();
-      result += element2tile(e);
+      result += element2tile(e) - range_.first;
       return result;
     }
 
@@ -130,22 +136,63 @@ namespace TiledArray {
       return tile_ranges_[i - range_.first];
     }
 
-    const size_type& element2tile(const size_type& i) const {
+    /// Find the tile that contains an element
+
+    /// \param i The element index
+    /// \return The index of the tile that contains element \c i
+    size_type element2tile(const size_type i) const {
       TA_ASSERT( includes(element_range_, i) );
-      return elem2tile_[i - element_range_.first];
+      if(block_size_ != 0ul)
+        return range_.first + (i - element_range_.first) / block_size_;
+
+      const_iterator it = std::upper_bound(tile_ranges_.begin(), tile_ranges_.end(), i,
+          & TiledRange1::less_finish);
+      return range_.first + (it - tile_ranges_.begin());
+    }
+
+    /// Find the tiles that contain a sequence of elements
+
+    /// Consecutive elements that are in the same tile are assigned that tile
+    /// without a search, so sorted sequences are converted in linear time.
+    /// \tparam InIter An input iterator type for element indices
+    /// \tparam OutIter An output iterator type for tile indices
+    /// \param first The first element index
+    /// \param last The end of the element indices
+    /// \param result The first tile index of the result
+    /// \return The end of the tile indices
+    template <typename InIter, typename OutIter>
+    OutIter element2tile(InIter first, InIter last, OutIter result) const {
+      TA_STATIC_ASSERT(detail::is_input_iterator<InIter>::value);
+      if(block_size_ != 0ul) {
+        for(; first != last; ++first, ++result)
+          *result = element2tile(*first);
+      } else {
+        size_type t = range_.first;
+        for(; first != last; ++first, ++result) {
+          const size_type e = *first;
+          if(! includes(tile_ranges_[t - range_.first], e))
+            t = element2tile(e);
+          *result = t;
+        }
+      }
+
+      return result;
     }
 
     void swap(TiledRange1& other) { // no throw
       std::swap(range_, other.range_);
       std::swap(element_range_, other.element_range_);
       std::swap(tile_ranges_, other.tile_ranges_);
-      std::swap(elem2tile_, other.elem2tile_);
+      std::swap(block_size_, other.block_size_);
     }
 
   private:
 
     static bool includes(const range_type& r, size_type i) { return (i >= r.first) && (i < r.second); }
 
+    /// Compare an element index with the upper bound of a tile
+    static bool less_finish(const size_type i, const range_type& r) { return i < r.second; }
+
     /// Validates tile_boundaries
     template <typename RandIter>
     static void valid_(RandIter first, RandIter last) {
@@ -173,17 +220,25 @@ namespace TiledArray {
     }
 
     /// Initialize secondary data
+
+    /// The block size is set when all tiles, except the last, have the same
+    /// size and the last tile is not larger than the others.
     void init_map_() {
+      block_size_ = 0ul;
+
       // check for 0 size range.
       if((element_range_.second - element_range_.first) == 0)
         return;
 
-      // initialize elem2tile map
-      elem2tile_.resize(element_range_.second - element_range_.first);
+      const size_type block_size = tile_ranges_.front().second - tile_ranges_.front().first;
       const size_type end = range_.second - range_.first;
-      for(size_type t = 0; t < end; ++t)
-        for(size_type e = tile_ranges_[t].first; e < tile_ranges_[t].second; ++e)
-          elem2tile_[e - element_range_.first] = t + range_.first;
+      for(size_type t = 1ul; t < end; ++t) {
+        const size_type size = tile_ranges_[t].second - tile_ranges_[t].first;
+        if((size > block_size) || ((size < block_size) && ((t + 1ul) != end)))
+          return;
+      }
+
+      block_size_ = block_size;
     }
 
     friend std::ostream& operator <<(std::ostream&, const TiledRange1&);
@@ -192,7 +247,7 @@ namespace TiledArray {
     range_type range_; ///< stores the overall dimensions of the tiles.
     range_type element_range_; ///< stores overall element dimensions.
     std::vector<range_type> tile_ranges_; ///< stores the dimensions of each tile.
-    std::vector<size_type> elem2tile_; ///< maps element index to tile index (secondary data).
+    size_type block_size_; ///< The size of uniform tiles, or zero when tiles are not uniform (secondary data).
 
   }; // class TiledRange1
 
@@ -22,6 +22,8 @@
 
 #include <TiledArray/tensor_expression.h>
 #include <TiledArray/tensor.h>
+#include <TiledArray/affinity.h>
+#include <TiledArray/task_granularity.h>
 
 namespace TiledArray {
   namespace expressions {
@@ -76,6 +78,19 @@ namespace TiledArray {
           return result_type(arg.range(), arg.begin(), op_);
         }
 
+        /// Evaluate a range of result elements
+
+        /// \param[out] result The result element array
+        /// \param arg The argument tile
+        /// \param first The first element to evaluate
+        /// \param last The end of the element range
+        void eval_range(value_type* result, argument_type arg, const std::size_t first,
+            const std::size_t last) const
+        {
+          for(std::size_t i = first; i < last; ++i)
+            result[i] = op_(arg[i]);
+        }
+
       }; // class UnaryTileOp
 
     }  // namespace detail
@@ -130,12 +145,156 @@ namespace TiledArray {
         /// Virtual destructor
         virtual ~UnaryTensorImpl() { }
 
+        /// Collect the arrays read by this expression
+
+        /// The structural key is not overridden, since the tile operation may
+        /// hold a constant that is not part of its type.
+        /// \param[out] arrays The addresses of the arrays read by this
+        /// expression are appended to this list
+        virtual void collect_arrays(std::vector<const void*>& arrays) const {
+          arg_.collect_arrays(arrays);
+        }
+
+        /// Estimated tile density
+
+        /// \return The density of the argument, which has the same zero tiles
+        virtual double density() const {
+          return (TensorImpl_::is_dense() ? 1.0 : arg_.density());
+        }
+
+        /// Preferred process map for the result tiles
+
+        /// \return The preferred process map of the argument when it has the
+        /// variable order of this expression, or an empty pointer
+        virtual std::shared_ptr<pmap_interface> result_pmap() const {
+          return (arg_.vars() == TensorExpressionImpl_::vars() ?
+              arg_.result_pmap() : std::shared_ptr<pmap_interface>());
+        }
+
       private:
 
-        void eval_tile(const size_type i, const typename arg_tensor_type::value_type& tile) {
+        void eval_local_tile(const size_type i, const typename arg_tensor_type::value_type& tile) {
+          TA_PROFILE_SCOPE("unary");
           TensorExpressionImpl_::set(i, op_(tile));
         }
 
+        /// Evaluate tile \c i on the NUMA node that holds its argument
+        void eval_tile(const size_type i, const typename arg_tensor_type::value_type& tile) {
+          TiledArray::detail::run_near(TensorImpl_::get_world(), tile.data(), this,
+              & UnaryTensorImpl_::eval_local_tile, i, tile);
+        }
+
+        typedef typename arg_tensor_type::value_type arg_value_type;
+
+        /// Task that evaluates a batch of small tiles
+        class EvalBatchTask : public madness::TaskInterface {
+        private:
+          UnaryTensorImpl_& owner_; ///< The tensor that owns the tiles
+          std::vector<size_type> index_; ///< The tile indices
+          std::vector<madness::Future<arg_value_type> > arg_; ///< Argument tiles
+          size_type volume_; ///< The total number of elements in the batch
+
+        public:
+          EvalBatchTask(UnaryTensorImpl_& owner) :
+            madness::TaskInterface(madness::TaskAttributes()),
+            owner_(owner), index_(), arg_(), volume_(0ul)
+          { }
+
+          virtual ~EvalBatchTask() { }
+
+          /// Add a tile to the batch
+
+          /// \param i The tile index
+          /// \param arg The argument tile
+          /// \param volume The number of elements in the tile
+          void add(const size_type i, const madness::Future<arg_value_type>& arg,
+              const size_type volume)
+          {
+            index_.push_back(i);
+            arg_.push_back(arg);
+            if(! arg_.back().probe()) {
+              madness::DependencyInterface::inc();
+              arg_.back().register_callback(this);
+            }
+            volume_ += volume;
+          }
+
+          /// The total number of elements in the batch
+          size_type volume() const { return volume_; }
+
+          virtual void run(const madness::TaskThreadEnv&) {
+            for(std::size_t k = 0ul; k < index_.size(); ++k)
+              owner_.eval_tile(index_[k], arg_[k].get());
+          }
+        }; // class EvalBatchTask
+
+        /// Evaluate a range of elements in a split tile
+
+        /// The tile is stored when the last range has been evaluated.
+        /// \param i The tile index
+        /// \param result The result tile
+        /// \param arg The argument tile
+        /// \param first The first element to evaluate
+        /// \param last The end of the element range
+        /// \param remaining The number of ranges that have not been evaluated
+        void eval_tile_range(const size_type i, value_type result, const arg_value_type& arg,
+            const size_type first, const size_type last, madness::AtomicInt* remaining)
+        {
+          {
+            TA_PROFILE_SCOPE("unary");
+            op_.eval_range(result.data(), arg, first, last);
+          }
+          if(remaining->dec_and_test()) {
+            delete remaining;
+            TensorExpressionImpl_::set(i, result);
+          }
+        }
+
+        /// Evaluate a large tile with several tasks
+
+        /// \param i The tile index
+        /// \param arg The argument tile
+        void eval_split_tile(const size_type i, const arg_value_type& arg) {
+          const size_type volume = arg.range().volume();
+          const size_type parts = TiledArray::detail::TaskGranularity::splits(volume);
+          value_type result(arg.range());
+          madness::AtomicInt* remaining = new madness::AtomicInt();
+          *remaining = parts;
+          for(size_type part = 1ul; part < parts; ++part)
+            TensorImpl_::get_world().taskq.add(this, & UnaryTensorImpl_::eval_tile_range,
+                i, result, arg,
+                TiledArray::detail::TaskGranularity::first(volume, parts, part),
+                TiledArray::detail::TaskGranularity::first(volume, parts, part + 1ul),
+                remaining);
+          eval_tile_range(i, result, arg, 0ul,
+              TiledArray::detail::TaskGranularity::first(volume, parts, 1ul), remaining);
+        }
+
+        /// Spawn the evaluation of a tile
+
+        /// Small tiles are added to \c batch , which is submitted when it
+        /// reaches the target task size; large tiles are split.
+        /// \param i The tile index
+        /// \param[in,out] batch The current batch of small tiles
+        void spawn_tile(const size_type i, EvalBatchTask*& batch) {
+          const size_type volume = TensorExpressionImpl_::make_tile_range(i).volume();
+          if(TiledArray::detail::TaskGranularity::is_small(volume)) {
+            if(! batch)
+              batch = new EvalBatchTask(*this);
+            batch->add(i, arg_.move(i), volume);
+            if(batch->volume() >= TiledArray::detail::TaskGranularity::target()) {
+              TensorImpl_::get_world().taskq.add(batch);
+              batch = NULL;
+            }
+          } else if(TiledArray::detail::TaskGranularity::splits(volume) > 1ul) {
+            TensorImpl_::get_world().taskq.add(this,
+                & UnaryTensorImpl_::eval_split_tile, i, arg_.move(i));
+          } else {
+            TensorImpl_::get_world().taskq.add(this,
+                & UnaryTensorImpl_::eval_tile, i, arg_.move(i));
+          }
+        }
+
         /// Function for evaluating this tensor's tiles
 
         /// This function is run inside a task, and will run after \c eval_children
@@ -148,16 +307,22 @@ namespace TiledArray {
           // Make sure all local tiles are present.
           const typename pmap_interface::const_iterator end = TensorImpl_::pmap()->end();
           typename pmap_interface::const_iterator it = TensorImpl_::pmap()->begin();
-          if(arg_.is_dense()) {
+          EvalBatchTask* batch = NULL;
+          if(arg_.is_dense() && (! TensorExpressionImpl_::has_mask())) {
             for(; it != end; ++it)
-              TensorImpl_::get_world().taskq.add(this,
-                  & UnaryTensorImpl_::eval_tile, *it, arg_.move(*it));
+              spawn_tile(*it, batch);
           } else {
-            for(; it != end; ++it)
-              if(! arg_.is_zero(*it))
-                TensorImpl_::get_world().taskq.add(this,
-                    & UnaryTensorImpl_::eval_tile, *it, arg_.move(*it));
+            for(; it != end; ++it) {
+              if(arg_.is_zero(*it))
+                continue;
+              if(TensorExpressionImpl_::is_masked(*it))
+                arg_.move(*it); // Cleanup unused tiles
+              else
+                spawn_tile(*it, batch);
+            }
           }
+          if(batch)
+            TensorImpl_::get_world().taskq.add(batch);
 
           arg_.release();
         }
@@ -24,11 +24,207 @@
 #include <TiledArray/lazy_sync.h>
 #include <TiledArray/reduce_task.h>
 #include <TiledArray/pmap/hash_pmap.h>
+#include <deque>
+#include <vector>
+#include <algorithm>
 
 namespace TiledArray {
+  namespace detail {
+
+    /// Work queue of a process that shares its work by work stealing
+
+    /// Work items are started from the front of the queue, at most
+    /// \c window() at a time, and the items of the next window are handed
+    /// out for prefetching. A process whose queue is empty asks the other
+    /// processes for work in turn, with at most one request pending. A
+    /// victim keeps a full window and hands over half of the rest, up to
+    /// \c max_steal() items, from the back of its queue. A thief stops
+    /// asking after every other process has refused in a row, and starts
+    /// asking again when one of the processes that refused it has work to
+    /// hand over, so requests that arrive before the victim has queued its
+    /// work are not lost.
+    /// \tparam T The work item type
+    /// \note This object is not thread safe.
+    template <typename T>
+    class StealQueue {
+    public:
+      typedef T value_type; ///< The work item type
+
+    private:
+      std::deque<T> queue_; ///< Work items that have not been started
+      std::size_t window_; ///< The number of items started at once
+      std::size_t running_; ///< The number of started items that are not finished
+      std::size_t prefetched_; ///< The number of items at the front of the queue that were prefetched
+      ProcessID rank_; ///< This process
+      ProcessID size_; ///< The number of processes
+      ProcessID victim_; ///< The process that is asked for work next
+      ProcessID refusals_; ///< The number of consecutive refused steal requests
+      bool stealing_; ///< \c true while a steal request is pending
+      std::vector<ProcessID> refused_; ///< The thieves that were refused
+
+    public:
+
+      /// Constructor
+
+      /// \param rank This process
+      /// \param size The number of processes
+      /// \param window The number of items started at once
+      StealQueue(const ProcessID rank, const ProcessID size, const std::size_t window) :
+        queue_(), window_(window), running_(0ul), prefetched_(0ul), rank_(rank),
+        size_(size), victim_((rank + 1) % size), refusals_(0), stealing_(false),
+        refused_()
+      {
+        TA_ASSERT(window > 0ul);
+      }
+
+      /// The number of items started at once
+      std::size_t window() const { return window_; }
+
+      /// The number of items that have not been started
+      std::size_t size() const { return queue_.size(); }
+
+      /// The number of started items that are not finished
+      std::size_t running() const { return running_; }
+
+      /// The number of consecutive refused steal requests
+      ProcessID refusals() const { return refusals_; }
+
+      /// \c true while a steal request is pending
+      bool stealing() const { return stealing_; }
+
+      /// Maximum number of items handed over by one steal
+      std::size_t max_steal() const { return 4ul * window_; }
+
+      /// The number of items handed over by a victim
+
+      /// \param queued The number of items in the victim queue
+      /// \param window The number of items the victim starts at once
+      /// \param max The maximum number of items handed over
+      /// \return Half of the items beyond a full window, rounded up, and at
+      /// most \c max
+      static std::size_t steal_size(const std::size_t queued, const std::size_t window,
+          const std::size_t max)
+      {
+        if(queued <= window)
+          return 0ul;
+        return std::min((queued - window + 1ul) / 2ul, max);
+      }
+
+      /// Add an item to the back of the queue
+
+      /// \param item The work item
+      void push(const T& item) { queue_.push_back(item); }
+
+      /// Take the items to be started
+
+      /// \param[out] start The items to be started are appended to this list
+      /// \param[out] prefetch The items of the next window that have not
+      /// been prefetched are appended to this list
+      /// \return The process that is asked for work, or -1 when no steal
+      /// request is sent
+      ProcessID start(std::vector<T>& start, std::vector<T>& prefetch) {
+        while((running_ < window_) && (! queue_.empty())) {
+          start.push_back(queue_.front());
+          queue_.pop_front();
+          ++running_;
+          if(prefetched_ > 0ul)
+            --prefetched_;
+        }
+
+        const std::size_t next = std::min(window_, queue_.size());
+        for(; prefetched_ < next; ++prefetched_)
+          prefetch.push_back(queue_[prefetched_]);
+
+        if(queue_.empty() && (! stealing_) && (refusals_ < (size_ - 1))) {
+          stealing_ = true;
+          const ProcessID victim = victim_;
+          victim_ = (victim_ + 1) % size_;
+          if(victim_ == rank_)
+            victim_ = (victim_ + 1) % size_;
+          return victim;
+        }
+
+        return -1;
+      }
+
+      /// Mark a started item as finished
+      void finish() {
+        TA_ASSERT(running_ > 0ul);
+        --running_;
+      }
+
+      /// Hand over items to a thief
+
+      /// A thief that gets no items is recorded, so it can be woken when
+      /// there is work to hand over.
+      /// \param thief The process that asks for work
+      /// \param[out] work The items handed over are appended to this list
+      void steal(const ProcessID thief, std::vector<T>& work) {
+        for(std::size_t n = steal_size(queue_.size(), window_, max_steal()); n > 0ul; --n) {
+          work.push_back(queue_.back());
+          queue_.pop_back();
+        }
+        prefetched_ = std::min(prefetched_, queue_.size());
+
+        if(work.empty() && (std::find(refused_.begin(), refused_.end(), thief) == refused_.end()))
+          refused_.push_back(thief);
+      }
+
+      /// Receive the reply to a steal request
+
+      /// \param work The items handed over by the victim
+      void receive(const std::vector<T>& work) {
+        stealing_ = false;
+        if(work.empty()) {
+          ++refusals_;
+        } else {
+          refusals_ = 0;
+          queue_.insert(queue_.end(), work.begin(), work.end());
+        }
+      }
+
+      /// Take the refused thieves once there is work to hand over
+
+      /// \param[out] thieves The refused thieves are appended to this list
+      /// when this queue has items beyond a full window
+      void wake(std::vector<ProcessID>& thieves) {
+        if(queue_.size() > window_) {
+          thieves.insert(thieves.end(), refused_.begin(), refused_.end());
+          refused_.clear();
+        }
+      }
+
+      /// A victim that refused this process has work to hand over
+
+      /// \param victim The process that has work
+      void woken(const ProcessID victim) {
+        refusals_ = 0;
+        victim_ = victim;
+      }
+
+    }; // class StealQueue
+
+  } // namespace detail
+
   namespace expressions {
 
     /// Very Sparse General Matrix Multiplication
+
+    /// Each process owns the result tiles of its process grid position, and
+    /// computes each result tile as a sparse dot product of a row of left
+    /// tiles and a column of right tiles. Result tiles are queued, and only a
+    /// few are evaluated at a time, so the remaining tiles can be stolen by
+    /// other processes that run out of work. A process without work asks the
+    /// other processes for work in turn. The victim hands over up to half of
+    /// the tiles it has not started, and the thief fetches the argument tiles,
+    /// computes the dot products, and sends the result tiles to the owner.
+    /// The argument tiles of the next window are fetched while the current
+    /// window is evaluated. The extra communication is bounded: a steal is
+    /// one request and one reply, a reply has at most a fixed number of
+    /// tiles, remote argument tiles are cached, and a process stops stealing
+    /// after every other process has refused in a row, until one of them has
+    /// work to hand over.
+    /// \sa TiledArray::detail::StealQueue
     template <typename Left, typename Right>
     class VSpGemm : public madness::WorldObject<VSpGemm<Left, Right> >, public ContractionTensorImpl<Left, Right> {
     protected:
@@ -75,10 +271,16 @@ namespace TiledArray {
 
       typedef detail::ContractReduceOp<Left, Right> contract_reduce_op;
 
+      /// A pending result tile (the ordinal index and the owner)
+      typedef std::pair<size_type, ProcessID> work_type;
+
       left_container left_cache_;
       right_container right_cache_;
       madness::AtomicInt count_;
 
+      TiledArray::detail::StealQueue<work_type> work_; ///< Result tiles that have not been started
+      madness::Mutex mutex_; ///< Protects \c work_
+
       /// Request A tile from \c arg
 
       /// If the tile is stored locally, the a copy of the future of the
@@ -120,7 +322,8 @@ namespace TiledArray {
       /// Compute row/column \c a of left with column/row \c b of right.
       /// \param i The row of the result tile to be computed
       /// \param j The column of the result tile to be computed
-      void dot_product(const size_type i, const size_type j) {
+      /// \return A future to the (unpermuted) result tile
+      madness::Future<value_type> dot_product(const size_type i, const size_type j) {
         // Construct a reduction object
         TiledArray::detail::ReducePairTask<contract_reduce_op>
             local_reduce_op(WorldObject_::get_world(), contract_reduce_op(*this));
@@ -136,10 +339,128 @@ namespace TiledArray {
             local_reduce_op.add(get_left(a), get_right(b));
 
         TA_ASSERT(local_reduce_op.count() != 0ul);
-        // This will start the reduction tasks, submit the permute task of
-        // the result of the reduction, and return the resulting future
-        ContractionTensorImpl_::set(i * n_ + j, local_reduce_op.submit());
+        // This will start the reduction tasks and return the resulting future
+        return local_reduce_op.submit();
+      }
+
+      /// Fetch the argument tiles of a result tile
+
+      /// The fetched tiles are cached, so \c dot_product() does not wait for
+      /// a new remote request.
+      /// \param work The result tile
+      void prefetch(const work_type& work) {
+        size_type a = (work.first / n_) * k_;
+        size_type b = work.first % n_;
+        const size_type end = a + k_;
+        for(; a < end; ++a, b += n_)
+          if(!(ContractionTensorImpl_::left().is_zero(a) || ContractionTensorImpl_::right().is_zero(b))) {
+            get_left(a);
+            get_right(b);
+          }
+      }
+
+      /// Wake the thieves that were refused when there is work to hand over
+
+      /// \param thieves The refused thieves
+      void wake(const std::vector<ProcessID>& thieves) {
+        for(std::vector<ProcessID>::const_iterator it = thieves.begin(); it != thieves.end(); ++it)
+          WorldObject_::task(*it, & VSpGemm_::woken, rank_);
+      }
+
+      /// Start the evaluation of a result tile
+
+      /// Local tiles are stored when they are done. Stolen tiles are sent to
+      /// their owner. The next tile is started when this tile is done.
+      /// \param work The result tile
+      void start(const work_type& work) {
+        madness::Future<value_type> result = dot_product(work.first / n_, work.first % n_);
+        if(work.second == rank_)
+          ContractionTensorImpl_::set(work.first, result);
+        TensorImpl_::get_world().taskq.add(this, & VSpGemm_::finish, work, result);
+      }
+
+      /// Finish the evaluation of a result tile and start the next one
+
+      /// \param work The result tile
+      /// \param tile The result tile value
+      void finish(const work_type& work, const value_type& tile) {
+        if(work.second != rank_)
+          WorldObject_::task(work.second, & VSpGemm_::set_stolen, work.first, tile);
+
+        {
+          madness::ScopedMutex<madness::Mutex> locker(& mutex_);
+          work_.finish();
+        }
+        run();
+      }
+
+      /// Store a result tile that was computed by another process
+
+      /// \param i The ordinal index of the (unpermuted) result tile
+      /// \param tile The result tile
+      void set_stolen(const size_type i, const value_type& tile) {
+        ContractionTensorImpl_::set(i, tile);
+      }
+
+      /// Start queued tiles up to the window size, or ask for work
+
+      /// The arguments of the next window are prefetched. When the queue is
+      /// empty, a steal request is sent to the next victim.
+      void run() {
+        std::vector<work_type> work;
+        std::vector<work_type> next;
+        ProcessID victim = -1;
+        {
+          madness::ScopedMutex<madness::Mutex> locker(& mutex_);
+          victim = work_.start(work, next);
+        }
+
+        for(typename std::vector<work_type>::const_iterator it = work.begin(); it != work.end(); ++it)
+          start(*it);
+        for(typename std::vector<work_type>::const_iterator it = next.begin(); it != next.end(); ++it)
+          prefetch(*it);
+        if(victim != -1)
+          WorldObject_::task(victim, & VSpGemm_::steal, rank_);
+      }
+
+      /// Hand over queued tiles to another process
+
+      /// \param thief The process that asks for work
+      void steal(const ProcessID thief) {
+        std::vector<work_type> work;
+        {
+          madness::ScopedMutex<madness::Mutex> locker(& mutex_);
+          work_.steal(thief, work);
+        }
 
+        WorldObject_::task(thief, & VSpGemm_::steal_reply, work);
+      }
+
+      /// Receive stolen tiles
+
+      /// Stolen tiles keep their owner, so tiles that are stolen again are
+      /// still sent to the process that stores them.
+      /// \param work The stolen result tiles
+      void steal_reply(const std::vector<work_type>& work) {
+        std::vector<ProcessID> thieves;
+        {
+          madness::ScopedMutex<madness::Mutex> locker(& mutex_);
+          work_.receive(work);
+          work_.wake(thieves);
+        }
+        wake(thieves);
+        run();
+      }
+
+      /// Ask for work again after a victim that refused has work
+
+      /// \param victim The process that has work to hand over
+      void woken(const ProcessID victim) {
+        {
+          madness::ScopedMutex<madness::Mutex> locker(& mutex_);
+          work_.woken(victim);
+        }
+        run();
       }
 
     public:
@@ -147,7 +468,8 @@ namespace TiledArray {
           WorldObject_(left.get_world()),
           ContractionTensorImpl_(left, right),
           left_cache_(local_rows_ * k_),
-          right_cache_(local_cols_ * k_)
+          right_cache_(local_cols_ * k_),
+          work_(rank_, size_, madness::ThreadPool::size() + 1ul), mutex_()
       {
         count_ = local_rows_ * local_cols_;
         WorldObject_::process_pending();
@@ -200,16 +522,27 @@ namespace TiledArray {
       }
 
       virtual void eval_tiles() {
-        // Spawn task for local tile evaluation
-        for(size_type i = rank_row_; i < m_; i += proc_rows_)
-          for(size_type j = rank_col_; j < n_; j += proc_cols_) {
-            if(! TensorImpl_::is_zero(TensorExpressionImpl_::perm_index(i * n_ + j))) {
-              WorldObject_::task(rank_, & VSpGemm_::dot_product, i, j);
-            } else if((count_--) == 1) {
-              // Cleanup data for children if this is the last tile
-              lazy_sync(WorldObject_::get_world(), WorldObject_::id(), Cleanup(*this));
+        // Queue the local tiles
+        std::vector<ProcessID> thieves;
+        {
+          madness::ScopedMutex<madness::Mutex> locker(& mutex_);
+          for(size_type i = rank_row_; i < m_; i += proc_rows_)
+            for(size_type j = rank_col_; j < n_; j += proc_cols_) {
+              if(! TensorImpl_::is_zero(TensorExpressionImpl_::perm_index(i * n_ + j))) {
+                work_.push(work_type(i * n_ + j, rank_));
+              } else if((count_--) == 1) {
+                // Cleanup data for children if this is the last tile
+                lazy_sync(WorldObject_::get_world(), WorldObject_::id(), Cleanup(*this));
+              }
             }
-          }
+
+          // Steal requests that arrived before the tiles were queued were refused
+          work_.wake(thieves);
+        }
+        wake(thieves);
+
+        // Start the first window of tiles
+        run();
       }
 
     }; // class VSpGemm
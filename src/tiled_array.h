@@ -20,8 +20,14 @@
 #ifndef TILED_ARRAY_H__INCLUDED
 #define TILED_ARRAY_H__INCLUDED
 
+#include <TiledArray/initialize.h>
 #include <TiledArray/array.h>
+#include <TiledArray/labeled_tiled_range1.h>
 #include <TiledArray/expressions.h>
+#include <TiledArray/contraction_order.h>
+#include <TiledArray/eval_graph.h>
+#include <TiledArray/coo.h>
+#include <TiledArray/array_stream.h>
 #include <TiledArray/eigen.h>
 
 # if TILEDARRAY_HAS_ELEMENTAL
@@ -0,0 +1,122 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TiledArray/affinity.h"
+#include "TiledArray/tensor.h"
+#include "unit_test_config.h"
+
+using namespace TiledArray;
+using TiledArray::detail::NumaTopology;
+using TiledArray::detail::AffinityQueue;
+using TiledArray::detail::AffinityWork;
+
+struct AffinityFixture {
+  AffinityFixture() : count(0) { }
+
+  ~AffinityFixture() { }
+
+  void add(const int value, const int factor) { count += value * factor; }
+
+  /// Work item that increments a shared counter
+  class CountWork : public AffinityWork {
+  private:
+    madness::AtomicInt& counter_;
+
+  public:
+    CountWork(madness::AtomicInt& counter) : counter_(counter) { }
+
+    virtual ~CountWork() { }
+
+    virtual void run() { counter_++; }
+  }; // class CountWork
+
+  int count;
+}; // struct AffinityFixture
+
+BOOST_FIXTURE_TEST_SUITE( affinity_suite, AffinityFixture )
+
+BOOST_AUTO_TEST_CASE( topology )
+{
+  const NumaTopology& topology = NumaTopology::instance();
+  BOOST_CHECK(topology.nodes() >= 1);
+  BOOST_CHECK(topology.current_node() >= 0);
+  BOOST_CHECK(topology.current_node() < topology.nodes());
+
+  // Unknown memory locations do not have a home node
+  BOOST_CHECK_EQUAL(topology.node_of(NULL), -1);
+
+  std::vector<int> data(1024, 1);
+  BOOST_CHECK(topology.node_of(& data.front()) >= 0);
+  BOOST_CHECK(topology.node_of(& data.front()) < topology.nodes());
+}
+
+BOOST_AUTO_TEST_CASE( queue )
+{
+  madness::AtomicInt counter;
+  counter = 0;
+
+  // Work in any node queue is run, either by a local or a stealing thread
+  AffinityQueue& queue = AffinityQueue::instance();
+  const int nodes = NumaTopology::instance().nodes();
+  for(int i = 0; i < 100; ++i)
+    queue.add(*GlobalFixture::world, i % nodes, new CountWork(counter));
+  GlobalFixture::world->gop.fence();
+
+  BOOST_CHECK_EQUAL(int(counter), 100);
+}
+
+BOOST_AUTO_TEST_CASE( run_near )
+{
+  // Work on local data is run immediately
+  std::vector<int> data(1024, 1);
+  TiledArray::detail::run_near(*GlobalFixture::world, & data.front(), this,
+      & AffinityFixture::add, 2, 3);
+  TiledArray::detail::run_near(*GlobalFixture::world, NULL, this,
+      & AffinityFixture::add, 1, 4);
+  GlobalFixture::world->gop.fence();
+
+  BOOST_CHECK_EQUAL(count, 10);
+}
+
+BOOST_AUTO_TEST_CASE( numa_allocator )
+{
+  // The home node is restored when a scope ends
+  const int home = TiledArray::detail::numa_home();
+  {
+    TiledArray::detail::NumaHomeScope scope(0);
+    {
+      TiledArray::detail::NumaHomeScope inner(-1);
+      BOOST_CHECK_EQUAL(TiledArray::detail::numa_home(), -1);
+    }
+#ifdef TILEDARRAY_ENABLE_NUMA_AFFINITY
+    BOOST_CHECK_EQUAL(TiledArray::detail::numa_home(), 0);
+#endif // TILEDARRAY_ENABLE_NUMA_AFFINITY
+
+    // Tiles allocated on the home node hold their data
+    typedef Tensor<double, TiledArray::NumaAllocator<double> > tile_type;
+    const tile_type tile(Range(std::vector<std::size_t>(2, 0ul), std::vector<std::size_t>(2, 64ul)), 1.0);
+    BOOST_CHECK_EQUAL(tile.size(), 4096ul);
+    for(std::size_t i = 0ul; i < tile.size(); ++i)
+      BOOST_CHECK_EQUAL(tile[i], 1.0);
+    BOOST_CHECK(NumaTopology::instance().node_of(tile.data()) >= 0);
+  }
+  BOOST_CHECK_EQUAL(TiledArray::detail::numa_home(), home);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,169 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <limits>
+#include "TiledArray/algebra/utils.h"
+#include "unit_test_config.h"
+#include "range_fixture.h"
+
+using namespace TiledArray;
+
+struct AlgebraUtilsFixture : public TiledRangeFixture {
+  typedef Array<double, GlobalFixture::dim> ArrayD;
+
+  AlgebraUtilsFixture() : world(*GlobalFixture::world), x(), list() {
+    for(std::size_t i = 0; i < tr.tiles().volume(); ++i)
+      if(i % 3)
+        list.push_back(i);
+
+    for(int k = 0; k < 3; ++k)
+      x.push_back(make_array(k + 1));
+    x.push_back(make_sparse_array(4));
+    world.gop.fence();
+  }
+
+  ~AlgebraUtilsFixture() {
+    GlobalFixture::world->gop.fence();
+  }
+
+  // Make a dense array where the tiles of the array k differ from each other
+  ArrayD make_array(const int k) {
+    ArrayD result(world, tr);
+    for(std::size_t i = 0ul; i < tr.tiles().volume(); ++i)
+      if(result.is_local(i))
+        result.set(i, double(k) + 0.25 * double(i % 5));
+    return result;
+  }
+
+  // Make a sparse array with the tiles in list
+  ArrayD make_sparse_array(const int k) {
+    ArrayD result(world, tr, list.begin(), list.end());
+    for(std::vector<std::size_t>::const_iterator it = list.begin(); it != list.end(); ++it)
+      if(result.is_local(*it))
+        result.set(*it, double(k) - 0.5 * double(*it % 7));
+    return result;
+  }
+
+  // Check that the local tiles of result and expected are equal
+  static void check_array(const ArrayD& result, const ArrayD& expected) {
+    for(std::size_t i = 0ul; i < expected.trange().tiles().volume(); ++i) {
+      if(! expected.is_local(i))
+        continue;
+      BOOST_CHECK_EQUAL(result.is_zero(i), expected.is_zero(i));
+      if(expected.is_zero(i))
+        continue;
+      const ArrayD::value_type r = result.find(i).get();
+      const ArrayD::value_type e = expected.find(i).get();
+      BOOST_REQUIRE_EQUAL(r.range(), e.range());
+      for(std::size_t j = 0ul; j < e.size(); ++j)
+        BOOST_CHECK_CLOSE(r[j], e[j], 1.0e-10);
+    }
+  }
+
+  madness::World& world;
+  std::vector<ArrayD> x; ///< Three dense arrays and a sparse array
+  std::vector<std::size_t> list;
+}; // struct AlgebraUtilsFixture
+
+BOOST_FIXTURE_TEST_SUITE( algebra_utils_suite , AlgebraUtilsFixture )
+
+BOOST_AUTO_TEST_CASE( multi_dot_product )
+{
+  const std::vector<double> result =
+      TiledArray::multi_dot_product(x[0], x.begin(), x.end());
+
+  BOOST_REQUIRE_EQUAL(result.size(), x.size());
+  for(std::size_t k = 0ul; k < x.size(); ++k)
+    BOOST_CHECK_CLOSE(result[k], dot_product(x[0], x[k]), 1.0e-10);
+
+  // An empty sequence
+  BOOST_CHECK(TiledArray::multi_dot_product(x[0], x.begin(), x.begin()).empty());
+}
+
+BOOST_AUTO_TEST_CASE( dot_products )
+{
+  // Pairs of dense arrays, a dense with a sparse array, and sparse arrays
+  const ArrayD left[4] = { x[0], x[1], x[2], x[3] };
+  const ArrayD right[4] = { x[1], x[1], x[3], x[3] };
+  const std::vector<double> result = TiledArray::dot_products(left, left + 4, right);
+
+  BOOST_REQUIRE_EQUAL(result.size(), 4ul);
+  for(std::size_t k = 0ul; k < 4ul; ++k)
+    BOOST_CHECK_CLOSE(result[k], dot_product(left[k], right[k]), 1.0e-10);
+}
+
+BOOST_AUTO_TEST_CASE( multi_axpy_dense )
+{
+  const double a[3] = { 0.5, -1.0, 2.0 };
+  ArrayD y = make_array(5);
+  ArrayD expected = make_array(5);
+  world.gop.fence();
+
+  multi_axpy(y, 3.0, a, a + 3, x.begin());
+
+  scale(expected, 3.0);
+  for(std::size_t k = 0ul; k < 3ul; ++k)
+    axpy(expected, a[k], x[k]);
+  world.gop.fence();
+
+  BOOST_CHECK(y.is_dense());
+  check_array(y, expected);
+}
+
+BOOST_AUTO_TEST_CASE( multi_axpy_zero_beta )
+{
+  // The tiles of y are not read when beta is zero
+  const double a[2] = { 1.5, -0.5 };
+  ArrayD y(world, tr);
+  for(std::size_t i = 0ul; i < tr.tiles().volume(); ++i)
+    if(y.is_local(i))
+      y.set(i, std::numeric_limits<double>::quiet_NaN());
+  ArrayD expected = make_array(5);
+  world.gop.fence();
+
+  multi_axpy(y, 0.0, a, a + 2, x.begin());
+
+  scale(expected, 0.0);
+  for(std::size_t k = 0ul; k < 2ul; ++k)
+    axpy(expected, a[k], x[k]);
+  world.gop.fence();
+
+  check_array(y, expected);
+}
+
+BOOST_AUTO_TEST_CASE( multi_axpy_sparse )
+{
+  // A sparse argument is combined with axpy
+  const double a[2] = { 2.0, -1.0 };
+  const ArrayD xs[2] = { x[3], x[1] };
+  ArrayD y = make_sparse_array(6);
+  ArrayD expected = make_sparse_array(6);
+  world.gop.fence();
+
+  multi_axpy(y, 0.5, a, a + 2, xs);
+
+  scale(expected, 0.5);
+  for(std::size_t k = 0ul; k < 2ul; ++k)
+    axpy(expected, a[k], xs[k]);
+  world.gop.fence();
+
+  check_array(y, expected);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -18,6 +18,7 @@
  */
 
 #include "TiledArray/annotated_tensor.h"
+#include "TiledArray/expressions.h"
 #include "unit_test_config.h"
 #include "array_fixture.h"
 
@@ -94,4 +95,150 @@ BOOST_AUTO_TEST_CASE( eval )
   }
 }
 
+BOOST_AUTO_TEST_CASE( assign )
+{
+  ArrayN c(world, tr);
+
+  // The assignment does not wait for the tiles, so each tile is read
+  // through its future
+  BOOST_REQUIRE_NO_THROW(c(vars) = a(vars));
+  BOOST_CHECK(c.trange() == a.trange());
+
+  // The result keeps the process map of the argument, so no tiles are moved
+  BOOST_CHECK(c.get_pmap() == a.get_pmap());
+  for(std::size_t i = 0; i < c.size(); ++i) {
+    if(c.is_local(i)) {
+      const ArrayN::value_type c_tile = c.find(i).get();
+      const ArrayN::value_type a_tile = a.find(i).get();
+      BOOST_CHECK_EQUAL(c_tile.range(), a_tile.range());
+      BOOST_CHECK_EQUAL_COLLECTIONS(c_tile.begin(), c_tile.end(),
+          a_tile.begin(), a_tile.end());
+    }
+  }
+
+  world.gop.fence();
+}
+
+BOOST_AUTO_TEST_CASE( accumulate )
+{
+  ArrayN c(world, tr);
+  for(ArrayN::range_type::const_iterator it = c.range().begin(); it != c.range().end(); ++it)
+    if(c.is_local(*it))
+      c.set(*it, 2);
+
+  BOOST_REQUIRE_NO_THROW(c(vars) += a(vars));
+  for(std::size_t i = 0; i < c.size(); ++i) {
+    if(c.is_local(i)) {
+      const ArrayN::value_type c_tile = c.find(i).get();
+      const ArrayN::value_type a_tile = a.find(i).get();
+      for(std::size_t j = 0; j < c_tile.size(); ++j)
+        BOOST_CHECK_EQUAL(c_tile[j], a_tile[j] + 2);
+    }
+  }
+
+  BOOST_REQUIRE_NO_THROW(c(vars) -= a(vars));
+  for(std::size_t i = 0; i < c.size(); ++i) {
+    if(c.is_local(i)) {
+      const ArrayN::value_type c_tile = c.find(i).get();
+      for(std::size_t j = 0; j < c_tile.size(); ++j)
+        BOOST_CHECK_EQUAL(c_tile[j], 2);
+    }
+  }
+
+  // A shared array is not modified
+  ArrayN d = c;
+  BOOST_REQUIRE_NO_THROW(c(vars) += a(vars));
+  for(std::size_t i = 0; i < d.size(); ++i) {
+    if(d.is_local(i)) {
+      const ArrayN::value_type d_tile = d.find(i).get();
+      for(std::size_t j = 0; j < d_tile.size(); ++j)
+        BOOST_CHECK_EQUAL(d_tile[j], 2);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( accumulate_shared_tiles )
+{
+  ArrayN c(world, tr);
+  for(ArrayN::range_type::const_iterator it = c.range().begin(); it != c.range().end(); ++it)
+    if(c.is_local(*it))
+      c.set(*it, 2);
+
+  // The tiles of d are shallow copies of the tiles of c
+  ArrayN d(world, tr);
+  d(vars) = c(vars);
+  world.gop.fence();
+
+  BOOST_REQUIRE_NO_THROW(c(vars) += a(vars));
+  for(std::size_t i = 0; i < d.size(); ++i) {
+    if(d.is_local(i)) {
+      const ArrayN::value_type d_tile = d.find(i).get();
+      for(std::size_t j = 0; j < d_tile.size(); ++j)
+        BOOST_CHECK_EQUAL(d_tile[j], 2);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( accumulate_expression )
+{
+  ArrayN c(world, tr);
+  for(ArrayN::range_type::const_iterator it = c.range().begin(); it != c.range().end(); ++it)
+    if(c.is_local(*it))
+      c.set(*it, 2);
+
+  // The sums are written into the expression tiles, not the argument tiles
+  BOOST_REQUIRE_NO_THROW(c(vars) += a(vars) + a(vars));
+  BOOST_REQUIRE_NO_THROW(c(vars) -= 3 * a(vars));
+  for(std::size_t i = 0; i < c.size(); ++i) {
+    if(c.is_local(i)) {
+      const ArrayN::value_type c_tile = c.find(i).get();
+      const ArrayN::value_type a_tile = a.find(i).get();
+      for(std::size_t j = 0; j < c_tile.size(); ++j)
+        BOOST_CHECK_EQUAL(c_tile[j], 2 - a_tile[j]);
+    }
+  }
+
+  // Subtracting into a zero array negates the expression tiles
+  const std::vector<std::size_t> empty;
+  ArrayN z(world, tr, empty.begin(), empty.end());
+  ArrayN s(world, tr, c.range().begin(), c.range().end());
+  for(ArrayN::range_type::const_iterator it = s.range().begin(); it != s.range().end(); ++it)
+    if(s.is_local(*it))
+      s.set(*it, 1);
+  world.gop.fence();
+  BOOST_REQUIRE_NO_THROW(z(vars) -= s(vars) + s(vars));
+  for(std::size_t i = 0; i < z.size(); ++i) {
+    if(z.is_local(i)) {
+      const ArrayN::value_type z_tile = z.find(i).get();
+      for(std::size_t j = 0; j < z_tile.size(); ++j)
+        BOOST_CHECK_EQUAL(z_tile[j], -2);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( subtract_keeps_expression )
+{
+  ArrayN c(world, tr);
+  for(ArrayN::range_type::const_iterator it = c.range().begin(); it != c.range().end(); ++it)
+    if(c.is_local(*it))
+      c.set(*it, 2);
+
+  // Subtracting an expression does not change its sign for the next use
+  array_annotation expr = a(vars);
+  BOOST_REQUIRE_NO_THROW(c(vars) -= expr);
+  BOOST_CHECK_EQUAL(expr.scale(), 1);
+
+  ArrayN e(world, tr);
+  e(vars) = a(vars);
+  BOOST_REQUIRE_NO_THROW(c(vars) -= e(vars));
+  for(std::size_t i = 0; i < c.size(); ++i) {
+    if(c.is_local(i)) {
+      const ArrayN::value_type c_tile = c.find(i).get();
+      const ArrayN::value_type a_tile = a.find(i).get();
+      for(std::size_t j = 0; j < c_tile.size(); ++j)
+        BOOST_CHECK_EQUAL(c_tile[j], 2 - 2 * a_tile[j]);
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
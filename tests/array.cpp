@@ -20,6 +20,7 @@
 #include "array_fixture.h"
 #include "unit_test_config.h"
 #include "TiledArray/expressions.h"
+#include "TiledArray/pmap/hash_pmap.h"
 
 using namespace TiledArray;
 
@@ -39,6 +40,14 @@ ArrayFixture::~ArrayFixture() {
   GlobalFixture::world->gop.fence();
 }
 
+// Make a tile where each element is equal to its ordinal index in elements
+static ArrayFixture::tile_type make_ord_tile(const Range& range, const Range& elements) {
+  std::vector<int> data;
+  for(Range::const_iterator it = range.begin(); it != range.end(); ++it)
+    data.push_back(elements.ord(*it));
+  return ArrayFixture::tile_type(range, data.begin());
+}
+
 
 BOOST_FIXTURE_TEST_SUITE( array_suite , ArrayFixture )
 
@@ -226,5 +235,146 @@ BOOST_AUTO_TEST_CASE( make_replicated )
   }
 }
 
+BOOST_AUTO_TEST_CASE( truncate )
+{
+  // No tile is removed from a
+  BOOST_REQUIRE_NO_THROW(a.truncate(0.5));
+  BOOST_CHECK(a.is_dense());
+
+  // Tiles with an even index are zero
+  ArrayN b(world, tr);
+  for(std::size_t i = 0ul; i < b.size(); ++i)
+    if(b.is_local(i))
+      b.set(i, (i % 2ul ? 1 : 0));
+  world.gop.fence();
+
+  BOOST_REQUIRE_NO_THROW(b.truncate(0.5));
+  BOOST_CHECK(! b.is_dense());
+  for(std::size_t i = 0ul; i < b.size(); ++i) {
+    BOOST_CHECK_EQUAL(b.is_zero(i), (i % 2ul == 0ul));
+    if(b.is_local(i) && ! b.is_zero(i)) {
+      madness::Future<ArrayN::value_type> tile = b.find(i);
+      for(ArrayN::value_type::const_iterator it = tile.get().begin(); it != tile.get().end(); ++it)
+        BOOST_CHECK_EQUAL(*it, 1);
+    }
+  }
+
+#ifdef TA_EXCEPTION_ERROR
+  BOOST_CHECK_THROW(b.truncate(-1.0), Exception);
+#endif // TA_EXCEPTION_ERROR
+}
+
+BOOST_AUTO_TEST_CASE( redistribute )
+{
+  std::shared_ptr<ArrayN::pmap_interface> distributed_pmap = a.get_pmap();
+  std::shared_ptr<ArrayN::pmap_interface> pmap(new detail::HashPmap(world, a.size()));
+
+  BOOST_REQUIRE_NO_THROW(a.redistribute(pmap));
+  BOOST_CHECK_EQUAL(a.get_pmap(), pmap);
+  BOOST_CHECK(a.is_dense());
+  world.gop.fence();
+
+  // Check that the local tiles have moved
+  for(ArrayN::const_iterator it = a.begin(); it != a.end(); ++it) {
+    BOOST_CHECK_EQUAL(pmap->owner(it.ordinal()), world.rank());
+    const ArrayN::value_type tile = (*it).future().get();
+    BOOST_CHECK_EQUAL(tile.range(), a.trange().make_tile_range(it.ordinal()));
+    for(ArrayN::value_type::const_iterator v = tile.begin(); v != tile.end(); ++v)
+      BOOST_CHECK_EQUAL(*v, distributed_pmap->owner(it.ordinal()) + 1);
+  }
+
+#ifdef TA_EXCEPTION_ERROR
+  std::shared_ptr<ArrayN::pmap_interface> bad_pmap(new detail::HashPmap(world, a.size() + 1ul));
+  BOOST_CHECK_THROW(a.redistribute(bad_pmap), Exception);
+#endif // TA_EXCEPTION_ERROR
+}
+
+BOOST_AUTO_TEST_CASE( retile )
+{
+  ArrayN b(world, tr);
+  for(std::size_t i = 0ul; i < b.size(); ++i)
+    if(b.is_local(i))
+      b.set(i, make_ord_tile(tr.make_tile_range(i), tr.elements()));
+  world.gop.fence();
+
+  // Retile with uniform tiles that do not align with the old tiles
+  std::vector<std::size_t> boundaries;
+  for(std::size_t e = tr1.elements().first; e < tr1.elements().second; e += 7ul)
+    boundaries.push_back(e);
+  boundaries.push_back(tr1.elements().second);
+  const std::vector<TiledRange1> new_dims(GlobalFixture::dim,
+      TiledRange1(boundaries.begin(), boundaries.end()));
+  const TiledRange new_tr(new_dims.begin(), new_dims.end());
+
+  BOOST_REQUIRE_NO_THROW(b.retile(new_tr));
+  BOOST_CHECK_EQUAL(b.trange(), new_tr);
+  BOOST_CHECK(b.is_dense());
+  world.gop.fence();
+
+  for(ArrayN::const_iterator it = b.begin(); it != b.end(); ++it) {
+    const ArrayN::value_type tile = (*it).future().get();
+    const ArrayN::value_type expected = make_ord_tile(new_tr.make_tile_range(it.ordinal()), tr.elements());
+    BOOST_CHECK_EQUAL(tile.range(), expected.range());
+    BOOST_CHECK_EQUAL_COLLECTIONS(tile.begin(), tile.end(), expected.begin(), expected.end());
+  }
+
+  // Retile back to the original tiles
+  BOOST_REQUIRE_NO_THROW(b.retile(tr));
+  world.gop.fence();
+  for(ArrayN::const_iterator it = b.begin(); it != b.end(); ++it) {
+    const ArrayN::value_type tile = (*it).future().get();
+    const ArrayN::value_type expected = make_ord_tile(tr.make_tile_range(it.ordinal()), tr.elements());
+    BOOST_CHECK_EQUAL_COLLECTIONS(tile.begin(), tile.end(), expected.begin(), expected.end());
+  }
+
+#ifdef TA_EXCEPTION_ERROR
+  std::vector<std::size_t> short_boundaries(boundaries.begin(), boundaries.end() - 1);
+  const std::vector<TiledRange1> bad_dims(GlobalFixture::dim,
+      TiledRange1(short_boundaries.begin(), short_boundaries.end()));
+  BOOST_CHECK_THROW(b.retile(TiledRange(bad_dims.begin(), bad_dims.end())), Exception);
+
+  // Blocks are only sent to the owner of a new tile, so replicas would never be set
+  const std::shared_ptr<ArrayN::pmap_interface> replicated(
+      new detail::ReplicatedPmap(world, new_tr.tiles().volume()));
+  BOOST_CHECK_THROW(b.retile(new_tr, replicated), Exception);
+#endif // TA_EXCEPTION_ERROR
+}
+
+BOOST_AUTO_TEST_CASE( retile_sparse )
+{
+  ArrayN b(world, tr, list.begin(), list.end());
+  for(std::vector<std::size_t>::const_iterator it = list.begin(); it != list.end(); ++it)
+    if(b.is_local(*it))
+      b.set(*it, make_ord_tile(tr.make_tile_range(*it), tr.elements()));
+  world.gop.fence();
+
+  std::vector<std::size_t> boundaries;
+  for(std::size_t e = tr1.elements().first; e < tr1.elements().second; e += 4ul)
+    boundaries.push_back(e);
+  boundaries.push_back(tr1.elements().second);
+  const std::vector<TiledRange1> new_dims(GlobalFixture::dim,
+      TiledRange1(boundaries.begin(), boundaries.end()));
+  const TiledRange new_tr(new_dims.begin(), new_dims.end());
+  const detail::Bitset<> shape = detail::retile_shape(tr, b.get_shape(), new_tr);
+
+  BOOST_REQUIRE_NO_THROW(b.retile(new_tr));
+  BOOST_CHECK(! b.is_dense());
+  for(std::size_t i = 0ul; i < b.size(); ++i)
+    BOOST_CHECK_EQUAL(b.is_zero(i), ! shape[i]);
+  world.gop.fence();
+
+  // Elements that are not in a non-zero old tile are zero
+  for(ArrayN::const_iterator it = b.begin(); it != b.end(); ++it) {
+    const ArrayN::value_type tile = (*it).future().get();
+    ArrayN::value_type::const_iterator v = tile.begin();
+    for(Range::const_iterator e = tile.range().begin(); e != tile.range().end(); ++e, ++v) {
+      if(tr.element_to_tile_ord(*e) % 3ul)
+        BOOST_CHECK_EQUAL(*v, int(tr.elements().ord(*e)));
+      else
+        BOOST_CHECK_EQUAL(*v, 0);
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -36,6 +36,18 @@ struct ArrayFixture : public TiledRangeFixture {
 
   ~ArrayFixture();
 
+  // Check that each local element of result is equal to factor * a + offset
+  void check_linear(const ArrayN& result, const int factor, const int offset = 0) const {
+    for(std::size_t i = 0ul; i < result.size(); ++i) {
+      if(result.is_local(i)) {
+        const tile_type r = result.find(i).get();
+        const tile_type x = a.find(i).get();
+        BOOST_REQUIRE_EQUAL(r.size(), x.size());
+        for(std::size_t j = 0ul; j < r.size(); ++j)
+          BOOST_CHECK_EQUAL(r[j], factor * x[j] + offset);
+      }
+    }
+  }
 
   std::vector<std::size_t> list;
   madness::World& world;
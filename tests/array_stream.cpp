@@ -0,0 +1,118 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TiledArray/array_stream.h"
+#include "unit_test_config.h"
+#include "array_fixture.h"
+
+using namespace TiledArray;
+
+struct ArrayStreamFixture : public ArrayFixture {
+  ArrayStreamFixture() { }
+
+  ~ArrayStreamFixture() { }
+
+  /// Read all elements of \c array in chunks of \c chunk elements
+  static std::vector<int> read_all(const ArrayN& array, const std::size_t chunk,
+      const std::size_t prefetch)
+  {
+    std::vector<int> result;
+    std::vector<int> buffer(chunk);
+    ArrayReader<ArrayN> reader(array, prefetch);
+    while(! reader.done()) {
+      const std::size_t n = reader.read(& buffer.front(), chunk);
+      result.insert(result.end(), buffer.begin(), buffer.begin() + n);
+    }
+    return result;
+  }
+}; // struct ArrayStreamFixture
+
+BOOST_FIXTURE_TEST_SUITE( array_stream_suite, ArrayStreamFixture )
+
+BOOST_AUTO_TEST_CASE( read )
+{
+  // Each element of a is equal to the owner of its tile plus one
+  const std::vector<int> elements = read_all(a, 7ul, 2ul);
+  BOOST_REQUIRE_EQUAL(elements.size(), tr.elements().volume());
+
+  std::size_t i = 0ul;
+  for(Range::const_iterator it = tr.elements().begin(); it != tr.elements().end(); ++it, ++i)
+    BOOST_CHECK_EQUAL(elements[i], int(a.owner(tr.element_to_tile(*it))) + 1);
+}
+
+BOOST_AUTO_TEST_CASE( prefetch )
+{
+  // The prefetch window is counted in tiles and may end inside a slab
+  const std::size_t slab_tiles = tr.tiles().volume() / tr.tiles().size()[0];
+  const std::vector<int> expected = read_all(a, 5ul, 0ul);
+  BOOST_CHECK(read_all(a, 5ul, 1ul) == expected);
+  BOOST_CHECK(read_all(a, 5ul, slab_tiles + 3ul) == expected);
+  BOOST_CHECK(read_all(a, 5ul, tr.tiles().volume()) == expected);
+}
+
+BOOST_AUTO_TEST_CASE( write )
+{
+  ArrayN b(world, tr);
+  if(world.rank() == 0) {
+    std::vector<int> buffer(tr.elements().volume());
+    for(std::size_t i = 0ul; i < buffer.size(); ++i)
+      buffer[i] = i;
+
+    // Write the array in uneven chunks
+    ArrayWriter<ArrayN> writer(b);
+    std::size_t first = 0ul;
+    for(std::size_t n = 1ul; first < buffer.size(); ++n) {
+      n = std::min(n, buffer.size() - first);
+      writer.write(& buffer[first], n);
+      first += n;
+    }
+    BOOST_CHECK(writer.done());
+    BOOST_CHECK_THROW(writer.write(& buffer.front(), 1ul), Exception);
+  }
+  world.gop.fence();
+
+  const std::vector<int> elements = read_all(b, 1000ul, 0ul);
+  BOOST_REQUIRE_EQUAL(elements.size(), tr.elements().volume());
+  for(std::size_t i = 0ul; i < elements.size(); ++i)
+    BOOST_CHECK_EQUAL(elements[i], int(i));
+}
+
+BOOST_AUTO_TEST_CASE( write_sparse )
+{
+  // Elements of zero tiles are discarded
+  ArrayN b(world, tr, list.begin(), list.end());
+  if(world.rank() == 0) {
+    std::vector<int> buffer(tr.elements().volume());
+    for(std::size_t i = 0ul; i < buffer.size(); ++i)
+      buffer[i] = i + 1;
+
+    ArrayWriter<ArrayN> writer(b);
+    writer.write(& buffer.front(), buffer.size());
+    BOOST_CHECK(writer.done());
+  }
+  world.gop.fence();
+
+  const std::vector<int> elements = read_all(b, 13ul, 3ul);
+  BOOST_REQUIRE_EQUAL(elements.size(), tr.elements().volume());
+  std::size_t i = 0ul;
+  for(Range::const_iterator it = tr.elements().begin(); it != tr.elements().end(); ++it, ++i)
+    BOOST_CHECK_EQUAL(elements[i], (b.is_zero(tr.element_to_tile(*it)) ? 0 : int(i) + 1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
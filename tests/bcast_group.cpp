@@ -0,0 +1,132 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TiledArray/bcast_group.h"
+#include "unit_test_config.h"
+#include "global_fixture.h"
+
+using namespace TiledArray;
+using TiledArray::detail::BcastGroup;
+
+struct BcastGroupFixture {
+  BcastGroupFixture() : nodes(), ranks() {
+    // 23 processes on 4 nodes of uneven size, where the processes of a node
+    // do not have consecutive ranks
+    for(int p = 0; p < 23; ++p)
+      nodes.push_back((p * 3) % 4);
+
+    // The group contains every other process
+    for(int p = 1; p < 23; p += 2)
+      ranks.push_back(p);
+  }
+
+  ~BcastGroupFixture() { }
+
+  // Walk the broadcast tree from root and count the number of times each
+  // member receives the data and the number of messages between nodes.
+  void bcast(const BcastGroup& group, const ProcessID root,
+      std::vector<int>& received, int& remote) const
+  {
+    received.assign(group.size(), 0);
+    remote = 0;
+    received[root] = 1;
+    std::vector<ProcessID> queue(1, root);
+    while(! queue.empty()) {
+      const ProcessID rank = queue.back();
+      queue.pop_back();
+
+      ProcessID children[4];
+      const unsigned int n = group.children(rank, root, children);
+      for(unsigned int c = 0u; c < n; ++c) {
+        ++received[children[c]];
+        if(group.node(children[c]) != group.node(rank))
+          ++remote;
+        queue.push_back(children[c]);
+      }
+    }
+  }
+
+  std::vector<int> nodes;
+  std::vector<ProcessID> ranks;
+}; // struct BcastGroupFixture
+
+BOOST_FIXTURE_TEST_SUITE( bcast_group_suite, BcastGroupFixture )
+
+BOOST_AUTO_TEST_CASE( constructor )
+{
+  BOOST_REQUIRE_NO_THROW(BcastGroup g(ranks, nodes));
+  BcastGroup group(ranks, nodes);
+
+  BOOST_CHECK_EQUAL(group.size(), ranks.size());
+  BOOST_CHECK_EQUAL(group.nodes(), 4ul);
+  for(std::size_t m = 0ul; m < ranks.size(); ++m) {
+    BOOST_CHECK_EQUAL(group[m], ranks[m]);
+
+    // Members on the same node have the same group node
+    for(std::size_t n = 0ul; n < ranks.size(); ++n)
+      BOOST_CHECK_EQUAL(group.node(m) == group.node(n), nodes[ranks[m]] == nodes[ranks[n]]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( bcast_tree )
+{
+  BcastGroup group(ranks, nodes);
+
+  for(ProcessID root = 0; root < ProcessID(group.size()); ++root) {
+    std::vector<int> received;
+    int remote = 0;
+    bcast(group, root, received, remote);
+
+    // Each member receives the data exactly once
+    for(std::size_t m = 0ul; m < received.size(); ++m)
+      BOOST_CHECK_EQUAL(received[m], 1);
+
+    // The data is sent to each other node once
+    BOOST_CHECK_EQUAL(remote, int(group.nodes()) - 1);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( single_node )
+{
+  // All processes are on the same node
+  BcastGroup group(ranks, std::vector<int>(nodes.size(), 0));
+  BOOST_CHECK_EQUAL(group.nodes(), 1ul);
+
+  std::vector<int> received;
+  int remote = 0;
+  bcast(group, 3, received, remote);
+  for(std::size_t m = 0ul; m < received.size(); ++m)
+    BOOST_CHECK_EQUAL(received[m], 1);
+  BOOST_CHECK_EQUAL(remote, 0);
+}
+
+BOOST_AUTO_TEST_CASE( node_ids )
+{
+  const std::vector<int>& ids = detail::node_ids(* GlobalFixture::world);
+  BOOST_CHECK_EQUAL(ids.size(), std::size_t(GlobalFixture::world->size()));
+
+  // Node ids are numbered in order of the lowest rank on each node
+  int max_id = -1;
+  for(std::size_t p = 0ul; p < ids.size(); ++p) {
+    BOOST_CHECK(ids[p] <= max_id + 1);
+    max_id = std::max(max_id, ids[p]);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
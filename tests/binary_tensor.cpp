@@ -87,6 +87,38 @@ BOOST_AUTO_TEST_CASE( result )
   }
 }
 
+BOOST_AUTO_TEST_CASE( density )
+{
+  BOOST_CHECK_EQUAL(btt.density(), 1.0);
+
+  // Cerate even and odd bitsets
+  TiledArray::detail::Bitset<> even(tr.tiles().volume());
+  TiledArray::detail::Bitset<> odd(tr.tiles().volume());
+  for(std::size_t i = 0; i < tr.tiles().volume(); ++i)
+    if(i % 2)
+      odd.set(i);
+    else
+      even.set(i);
+  ArrayN aeven(world, tr, even);
+  ArrayN aodd(world, tr, odd);
+  aeven.set_all_local(3);
+  aodd.set_all_local(2);
+  const double de = double(even.count()) / double(tr.tiles().volume());
+  const double dodd = double(odd.count()) / double(tr.tiles().volume());
+
+  // The density of an unevaluated expression is estimated from its arguments
+  tensor_expression sum = make_binary_tensor(aeven(vars), aodd(vars), make_binary_tile_op(std::plus<int>()));
+  tensor_expression product = make_binary_tensor(aeven(vars), aodd(vars), make_binary_tile_op(std::multiplies<int>()));
+  BOOST_CHECK_CLOSE(sum.density(), de + dodd - de * dodd, 1.0e-10);
+  BOOST_CHECK_CLOSE(product.density(), de * dodd, 1.0e-10);
+
+  // and is counted once it has been evaluated
+  product.eval(product.vars(), std::shared_ptr<tensor_expression::pmap_interface>(
+      new TiledArray::detail::BlockedPmap(world, product.size()))).get();
+  BOOST_CHECK_EQUAL(product.density(), 0.0);
+  world.gop.fence();
+}
+
 BOOST_AUTO_TEST_CASE( result_add_sparse )
 {
   // Cerate even and odd bitsets
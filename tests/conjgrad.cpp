@@ -0,0 +1,189 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <limits>
+#include "TiledArray/algebra/conjgrad.h"
+#include "unit_test_config.h"
+#include "range_fixture.h"
+
+using namespace TiledArray;
+
+struct ConjGradFixture : public Range1Fixture {
+  typedef Array<double, 2> Array2;
+
+  /// Symmetric positive definite operator <tt>a(x) = d*x + x^T/2</tt>
+
+  /// The diagonal \c d is applied element-wise and is at least two, so each
+  /// pair of transposed elements is coupled by a positive definite block.
+  struct Operator {
+    Operator(const Array2& d) : d_(d) { }
+
+    void operator()(const Array2& x, Array2& result) {
+      result("i,j") = multiply(d_("i,j"), x("i,j")) + 0.5 * x("j,i");
+    }
+
+    Array2 d_;
+  }; // struct Operator
+
+  ConjGradFixture() : world(*GlobalFixture::world), trange(make_trange(tr1)),
+      d(make_array(2.0, 1.0, 4ul)), precond(world, trange),
+      b(make_array(1.0, 0.1, 3ul))
+  {
+    // The preconditioner is the inverse of the diagonal
+    for(std::size_t i = 0ul; i < trange.tiles().volume(); ++i)
+      if(precond.is_local(i))
+        precond.set(i, 1.0 / (2.0 + double(i % 4ul)));
+    world.gop.fence();
+  }
+
+  ~ConjGradFixture() {
+    GlobalFixture::world->gop.fence();
+  }
+
+  static TiledRange make_trange(const TiledRange1& tr1) {
+    const std::vector<TiledRange1> dims(2ul, tr1);
+    return TiledRange(dims.begin(), dims.end());
+  }
+
+  // Make an array where tile i is filled with first + step * (i % period)
+  Array2 make_array(const double first, const double step, const std::size_t period) {
+    Array2 result(world, trange);
+    for(std::size_t i = 0ul; i < trange.tiles().volume(); ++i)
+      if(result.is_local(i))
+        result.set(i, first + step * double(i % period));
+    return result;
+  }
+
+  // Check that the local tiles of result and expected are equal
+  static void check_array(const Array2& result, const Array2& expected, const double tolerance) {
+    for(std::size_t i = 0ul; i < expected.trange().tiles().volume(); ++i) {
+      if(! expected.is_local(i))
+        continue;
+      const Array2::value_type r = result.find(i).get();
+      const Array2::value_type e = expected.find(i).get();
+      BOOST_REQUIRE_EQUAL(r.range(), e.range());
+      for(std::size_t j = 0ul; j < e.size(); ++j)
+        BOOST_CHECK_CLOSE(r[j], e[j], tolerance);
+    }
+  }
+
+  madness::World& world;
+  TiledRange trange;
+  Array2 d; ///< The diagonal of the operator
+  Array2 precond; ///< The preconditioner
+  Array2 b; ///< The right-hand side
+}; // struct ConjGradFixture
+
+BOOST_FIXTURE_TEST_SUITE( conjgrad_suite , ConjGradFixture )
+
+BOOST_AUTO_TEST_CASE( pipelined_cg_update )
+{
+  const double alpha = 0.75;
+  const double beta = -0.25;
+  Array2 x = make_array(1.0, 0.5, 3ul), r = make_array(-1.0, 0.25, 5ul),
+      u = make_array(2.0, -0.5, 2ul), w = make_array(0.5, 1.0, 7ul),
+      p = make_array(-2.0, 0.5, 3ul), s = make_array(1.5, -0.25, 4ul),
+      q = make_array(3.0, 0.5, 6ul), z = make_array(-0.5, 0.75, 2ul);
+  const Array2 m = make_array(1.25, 0.5, 5ul), n = make_array(-1.5, 1.0, 3ul);
+  world.gop.fence();
+
+  // The recurrences evaluated with axpy
+  Array2 ez = n, eq = m, es = w, ep = u;
+  axpy(ez, beta, z);
+  axpy(eq, beta, q);
+  axpy(es, beta, s);
+  axpy(ep, beta, p);
+  Array2 ex = x, er = r, eu = u, ew = w;
+  axpy(ex, alpha, ep);
+  axpy(er, -alpha, es);
+  axpy(eu, -alpha, eq);
+  axpy(ew, -alpha, ez);
+
+  TiledArray::pipelined_cg_update(alpha, beta, x, r, u, w, p, s, q, z, m, n);
+  world.gop.fence();
+
+  check_array(x, ex, 1.0e-10);
+  check_array(r, er, 1.0e-10);
+  check_array(u, eu, 1.0e-10);
+  check_array(w, ew, 1.0e-10);
+  check_array(p, ep, 1.0e-10);
+  check_array(s, es, 1.0e-10);
+  check_array(q, eq, 1.0e-10);
+  check_array(z, ez, 1.0e-10);
+}
+
+BOOST_AUTO_TEST_CASE( pipelined_cg_update_first_iteration )
+{
+  // The initial directions are not read when beta is zero
+  const double alpha = 0.5;
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  Array2 x = make_array(1.0, 0.5, 3ul), r = make_array(-1.0, 0.25, 5ul),
+      u = make_array(2.0, -0.5, 2ul), w = make_array(0.5, 1.0, 7ul),
+      p = make_array(nan, 0.0, 1ul), s = make_array(nan, 0.0, 1ul),
+      q = make_array(nan, 0.0, 1ul), z = make_array(nan, 0.0, 1ul);
+  const Array2 m = make_array(1.25, 0.5, 5ul), n = make_array(-1.5, 1.0, 3ul);
+  world.gop.fence();
+
+  Array2 ex = x, er = r, eu = u, ew = w;
+  axpy(ex, alpha, u);
+  axpy(er, -alpha, w);
+  axpy(eu, -alpha, m);
+  axpy(ew, -alpha, n);
+  const Array2 eu_prev = u, ew_prev = w;
+
+  TiledArray::pipelined_cg_update(alpha, 0.0, x, r, u, w, p, s, q, z, m, n);
+  world.gop.fence();
+
+  check_array(x, ex, 1.0e-10);
+  check_array(r, er, 1.0e-10);
+  check_array(u, eu, 1.0e-10);
+  check_array(w, ew, 1.0e-10);
+  check_array(p, eu_prev, 1.0e-10);
+  check_array(s, ew_prev, 1.0e-10);
+  check_array(q, m, 1.0e-10);
+  check_array(z, n, 1.0e-10);
+}
+
+BOOST_AUTO_TEST_CASE( solve )
+{
+  Operator a(d);
+
+  // Solve with the textbook and the pipelined solvers
+  Array2 x_cg = b;
+  ConjugateGradientSolver<Array2, Operator> cg;
+  const double cg_residual = cg(a, b, x_cg, precond, 1.0e-12);
+  BOOST_CHECK(cg_residual < 1.0e-12);
+
+  Array2 x_pcg = b;
+  PipelinedConjugateGradientSolver<Array2, Operator> pcg;
+  const double pcg_residual = pcg(a, b, x_pcg, precond, 1.0e-12);
+  BOOST_CHECK(pcg_residual < 1.0e-12);
+  world.gop.fence();
+
+  // Both solvers converge to the same solution
+  check_array(x_pcg, x_cg, 1.0e-6);
+
+  // which solves the system
+  Array2 ax = clone(b);
+  a(x_pcg, ax);
+  world.gop.fence();
+  check_array(ax, b, 1.0e-6);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,145 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TiledArray/contraction_dispatch.h"
+#include "unit_test_config.h"
+#include <sstream>
+
+using namespace TiledArray;
+using TiledArray::expressions::detail::ContractionDispatch;
+
+struct ContractionDispatchFixture {
+  // A contraction of 100x100 tile matrices with 50x50 element tiles
+  ContractionDispatchFixture() :
+    elements(5000.0), flops(2.0 * elements * elements * elements),
+    bytes(elements * elements * sizeof(double))
+  { }
+
+  ~ContractionDispatchFixture() { }
+
+  ContractionDispatch make(const std::size_t procs, const double left_density,
+      const double right_density) const
+  {
+    return ContractionDispatch(procs, 100ul, 100ul, 100ul, flops, bytes, bytes,
+        left_density, right_density);
+  }
+
+  const double elements;
+  const double flops;
+  const double bytes;
+}; // struct ContractionDispatchFixture
+
+BOOST_FIXTURE_TEST_SUITE( contraction_dispatch_suite, ContractionDispatchFixture )
+
+BOOST_AUTO_TEST_CASE( process_grid )
+{
+  ContractionDispatch d = make(64ul, 1.0, 1.0);
+  BOOST_CHECK_EQUAL(d.procs(), 64ul);
+  BOOST_CHECK_EQUAL(d.proc_rows(), 8ul);
+  BOOST_CHECK_EQUAL(d.proc_cols(), 8ul);
+}
+
+BOOST_AUTO_TEST_CASE( node_aware )
+{
+  // Each process is on its own node by default
+  ContractionDispatch flat = make(64ul, 1.0, 1.0);
+  BOOST_CHECK_EQUAL(flat.procs_per_node(), 1ul);
+
+  // With eight processes per node, a process row is on one node, so SUMMA
+  // only sends the right argument over the network
+  ContractionDispatch d(64ul, 100ul, 100ul, 100ul, flops, bytes, bytes, 1.0, 1.0, 8ul);
+  BOOST_CHECK_EQUAL(d.procs_per_node(), 8ul);
+  BOOST_CHECK_EQUAL(d.proc_rows(), 8ul);
+  BOOST_CHECK_EQUAL(d.proc_cols(), 8ul);
+  BOOST_CHECK_LT(d.cost(ContractionDispatch::summa_engine),
+      flat.cost(ContractionDispatch::summa_engine));
+  BOOST_CHECK_EQUAL(d.cost(ContractionDispatch::vspgemm_engine),
+      flat.cost(ContractionDispatch::vspgemm_engine));
+}
+
+BOOST_AUTO_TEST_CASE( single_process )
+{
+  // Nothing is communicated, so SUMMA is selected
+  ContractionDispatch d = make(1ul, 0.5, 0.5);
+  BOOST_CHECK_EQUAL(d.engine(), ContractionDispatch::summa_engine);
+  BOOST_CHECK_CLOSE(d.cost(ContractionDispatch::summa_engine),
+      d.cost(ContractionDispatch::vspgemm_engine), 1.0e-8);
+}
+
+BOOST_AUTO_TEST_CASE( dense )
+{
+  BOOST_CHECK_EQUAL(make(64ul, 1.0, 1.0).engine(), ContractionDispatch::summa_engine);
+
+  // Nearly dense arguments are contracted with SUMMA
+  BOOST_CHECK_EQUAL(make(64ul, 0.9, 0.9).engine(), ContractionDispatch::summa_engine);
+}
+
+BOOST_AUTO_TEST_CASE( sparse )
+{
+  // Nearly empty arguments are contracted with VSpGemm
+  ContractionDispatch d = make(64ul, 0.01, 0.01);
+  BOOST_CHECK_EQUAL(d.engine(), ContractionDispatch::vspgemm_engine);
+  BOOST_CHECK_LT(d.cost(ContractionDispatch::vspgemm_engine),
+      d.cost(ContractionDispatch::summa_engine));
+  BOOST_CHECK_LT(d.cost(ContractionDispatch::vspgemm_engine),
+      make(64ul, 1.0, 1.0).cost(ContractionDispatch::vspgemm_engine));
+}
+
+BOOST_AUTO_TEST_CASE( density_range )
+{
+  ContractionDispatch d = make(4ul, -1.0, 2.0);
+  BOOST_CHECK_EQUAL(d.left_density(), 0.0);
+  BOOST_CHECK_EQUAL(d.right_density(), 1.0);
+}
+
+BOOST_AUTO_TEST_CASE( record )
+{
+  std::stringstream log;
+  ContractionDispatch::log(& log);
+  ContractionDispatch d = make(64ul, 0.01, 0.01);
+  d.record();
+  ContractionDispatch::log(NULL);
+
+  // The last selection is recorded and logged
+  ContractionDispatch last = ContractionDispatch::last();
+  BOOST_CHECK_EQUAL(last.engine(), d.engine());
+  BOOST_CHECK_EQUAL(last.procs(), d.procs());
+  BOOST_CHECK(log.str().find("-> vspgemm") != std::string::npos);
+
+  // Nothing is written after logging is disabled
+  const std::string str = log.str();
+  make(1ul, 1.0, 1.0).record();
+  BOOST_CHECK_EQUAL(log.str(), str);
+  BOOST_CHECK_EQUAL(ContractionDispatch::last().procs(), 1ul);
+}
+
+BOOST_AUTO_TEST_CASE( parameters )
+{
+  BOOST_CHECK_THROW(ContractionDispatch::latency(-1.0), Exception);
+  BOOST_CHECK_THROW(ContractionDispatch::bandwidth(0.0), Exception);
+  BOOST_CHECK_THROW(ContractionDispatch::flop_rate(0.0), Exception);
+
+  // Without message latency, SUMMA still moves less data for dense arguments
+  const double latency = ContractionDispatch::latency();
+  ContractionDispatch::latency(0.0);
+  BOOST_CHECK_EQUAL(make(64ul, 1.0, 1.0).engine(), ContractionDispatch::summa_engine);
+  ContractionDispatch::latency(latency);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,134 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TiledArray/contraction_order.h"
+#include "unit_test_config.h"
+
+using namespace TiledArray;
+using TiledArray::expressions::VariableList;
+using TiledArray::expressions::detail::ContractionOrder;
+using TiledArray::expressions::detail::contraction_permutations;
+
+struct ContractionOrderFixture {
+  ContractionOrderFixture() { }
+
+  ~ContractionOrderFixture() { }
+
+  /// Add a matrix operand with one tile per 10 elements
+  static void add_matrix(ContractionOrder& order, const char* vars,
+      const std::size_t m, const std::size_t n, const double density = 1.0)
+  {
+    std::vector<std::size_t> elements, tiles;
+    elements.push_back(m);
+    elements.push_back(n);
+    tiles.push_back((m + 9ul) / 10ul);
+    tiles.push_back((n + 9ul) / 10ul);
+    order.add(VariableList(vars), elements, tiles, density);
+  }
+}; // struct ContractionOrderFixture
+
+BOOST_FIXTURE_TEST_SUITE( contraction_order_suite, ContractionOrderFixture )
+
+BOOST_AUTO_TEST_CASE( matrix_chain )
+{
+  // (a*b)*c is cheaper when the middle dimension is large
+  ContractionOrder order1;
+  add_matrix(order1, "i,j", 10, 100);
+  add_matrix(order1, "j,k", 100, 5);
+  add_matrix(order1, "k,l", 5, 50);
+  order1.optimize();
+  BOOST_CHECK_EQUAL(order1.str(), "((0*1)*2)");
+  BOOST_CHECK_CLOSE(order1.flops(), 2.0 * (10 * 100 * 5 + 10 * 5 * 50), 1e-10);
+
+  // a*(b*c) is cheaper when the outer dimension is large
+  ContractionOrder order2;
+  add_matrix(order2, "i,j", 100, 5);
+  add_matrix(order2, "j,k", 5, 100);
+  add_matrix(order2, "k,l", 100, 10);
+  order2.optimize();
+  BOOST_CHECK_EQUAL(order2.str(), "(0*(1*2))");
+  BOOST_CHECK_CLOSE(order2.flops(), 2.0 * (5 * 100 * 10 + 100 * 5 * 10), 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE( sparse_chain )
+{
+  // With dense operands (a*b)*c is cheaper, but a very sparse c makes b*c
+  // cheaper.
+  ContractionOrder dense;
+  add_matrix(dense, "i,j", 50, 100);
+  add_matrix(dense, "j,k", 100, 50);
+  add_matrix(dense, "k,l", 50, 100);
+  dense.optimize();
+  BOOST_CHECK_EQUAL(dense.str(), "((0*1)*2)");
+
+  ContractionOrder sparse;
+  add_matrix(sparse, "i,j", 50, 100);
+  add_matrix(sparse, "j,k", 100, 50);
+  add_matrix(sparse, "k,l", 50, 100, 0.01);
+  sparse.optimize();
+  BOOST_CHECK_EQUAL(sparse.str(), "(0*(1*2))");
+  BOOST_CHECK(sparse.flops() < dense.flops());
+  BOOST_CHECK(sparse.density() < 1.0);
+}
+
+BOOST_AUTO_TEST_CASE( four_index )
+{
+  // A four index transformation: the one index at a time order is optimal
+  ContractionOrder order;
+  std::vector<std::size_t> elements(4, 40ul), tiles(4, 4ul);
+  order.add(VariableList("p,q,r,s"), elements, tiles, 1.0);
+  add_matrix(order, "p,a", 40, 40);
+  add_matrix(order, "q,b", 40, 40);
+  add_matrix(order, "r,c", 40, 40);
+  order.optimize();
+
+  const double n = 40.0;
+  BOOST_CHECK_CLOSE(order.flops(), 3.0 * 2.0 * n * n * n * n * n, 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE( errors )
+{
+  // Operands without common indices require an outer product
+  ContractionOrder disconnected;
+  add_matrix(disconnected, "i,j", 10, 10);
+  add_matrix(disconnected, "k,l", 10, 10);
+  BOOST_CHECK_THROW(disconnected.optimize(), Exception);
+
+  // Contracted dimensions must match
+  ContractionOrder mismatch;
+  add_matrix(mismatch, "i,j", 10, 10);
+  BOOST_CHECK_THROW(add_matrix(mismatch, "j,k", 20, 10), Exception);
+
+  // Variables may appear in at most two operands
+  ContractionOrder hyper;
+  add_matrix(hyper, "i,j", 10, 10);
+  add_matrix(hyper, "j,k", 10, 10);
+  BOOST_CHECK_THROW(add_matrix(hyper, "j,l", 10, 10), Exception);
+}
+
+BOOST_AUTO_TEST_CASE( permutations )
+{
+  BOOST_CHECK_EQUAL(contraction_permutations(VariableList("i,j"), VariableList("j,k")), 0u);
+  BOOST_CHECK_EQUAL(contraction_permutations(VariableList("j,i"), VariableList("j,k")), 1u);
+  BOOST_CHECK_EQUAL(contraction_permutations(VariableList("i,j"), VariableList("k,j")), 1u);
+  BOOST_CHECK_EQUAL(contraction_permutations(VariableList("j,i"), VariableList("k,j")), 2u);
+  BOOST_CHECK_EQUAL(contraction_permutations(VariableList("k,j"), VariableList("j,i")), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -17,6 +17,7 @@
  *
  */
 
+#include <cmath>
 #include "TiledArray/contraction_tensor.h"
 #include "TiledArray/array.h"
 #include "unit_test_config.h"
@@ -74,6 +75,33 @@ BOOST_AUTO_TEST_CASE( shape )
 #endif // TA_EXCEPTION_ERROR
 }
 
+BOOST_AUTO_TEST_CASE( density )
+{
+  BOOST_CHECK_EQUAL(ctt.density(), 1.0);
+
+  // The density of an unevaluated contraction is estimated from the density
+  // of its arguments and the number of contracted tiles
+  ArrayN b(world, tr, list.begin(), list.end());
+  b.set_all_local(1);
+  const double d = double(list.size()) / double(tr.tiles().volume());
+  const double k = double(tr.tiles().volume() / tr.tiles().size()[0]);
+  tensor_expression c = make_contraction_tensor(b(left_var), b(right_var));
+  BOOST_CHECK_CLOSE(c.density(), 1.0 - std::pow(1.0 - d * d, k), 1.0e-10);
+}
+
+BOOST_AUTO_TEST_CASE( result_pmap )
+{
+  // The result is evaluated on the process grid of the contraction
+  std::shared_ptr<tensor_expression::pmap_interface> pmap = ctt.result_pmap();
+  BOOST_REQUIRE(pmap);
+  BOOST_CHECK_EQUAL(pmap->size(), ctt.size());
+
+  std::shared_ptr<tensor_expression::pmap_interface> selected =
+      ctt.select_pmap(ctt.vars(), std::shared_ptr<tensor_expression::pmap_interface>());
+  for(std::size_t i = 0ul; i < ctt.size(); ++i)
+    BOOST_CHECK_EQUAL(selected->owner(i), pmap->owner(i));
+}
+
 BOOST_AUTO_TEST_CASE( result )
 {
   // Get tiling dimensions for contraction
@@ -0,0 +1,91 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TiledArray/coo.h"
+#include "unit_test_config.h"
+#include "array_fixture.h"
+
+using namespace TiledArray;
+
+struct CooFixture : public ArrayFixture {
+  typedef std::vector<std::pair<index, int> > element_list;
+
+  CooFixture() { }
+
+  ~CooFixture() { }
+
+  /// The first element of tile \c t
+  index first_element(const size_type t) const {
+    const ArrayN::range_type range = tr.make_tile_range(t);
+    return index(range.start().begin(), range.start().end());
+  }
+
+  /// The last element of tile \c t
+  index last_element(const size_type t) const {
+    const ArrayN::range_type range = tr.make_tile_range(t);
+    index result(range.finish().begin(), range.finish().end());
+    for(std::size_t d = 0ul; d < result.size(); ++d)
+      --result[d];
+    return result;
+  }
+}; // struct CooFixture
+
+BOOST_FIXTURE_TEST_SUITE( coo_suite, CooFixture )
+
+BOOST_AUTO_TEST_CASE( construct )
+{
+  const size_type last = tr.tiles().volume() - 1ul;
+
+  // Every process contributes to the first tile; the last process also sets
+  // an element in the last tile.
+  element_list elements;
+  elements.push_back(std::make_pair(first_element(0ul), 1));
+  if(world.rank() == (world.size() - 1))
+    elements.push_back(std::make_pair(last_element(last), 5));
+
+  ArrayN result = coo_to_array<ArrayN>(world, tr, elements);
+
+  BOOST_CHECK(! result.is_dense());
+  for(size_type i = 0ul; i <= last; ++i)
+    BOOST_CHECK_EQUAL(result.is_zero(i), (i != 0ul) && (i != last));
+
+  if(result.is_local(0ul)) {
+    const tile_type tile = result.find(0ul).get();
+    BOOST_CHECK_EQUAL(tile[0], int(world.size()));
+    for(std::size_t j = 1ul; j < tile.size(); ++j)
+      BOOST_CHECK_EQUAL(tile[j], 0);
+  }
+
+  if(result.is_local(last)) {
+    const tile_type tile = result.find(last).get();
+    BOOST_CHECK_EQUAL(tile[tile.size() - 1ul], 5);
+    for(std::size_t j = 0ul; j < tile.size() - 1ul; ++j)
+      BOOST_CHECK_EQUAL(tile[j], 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( errors )
+{
+  element_list elements;
+  elements.push_back(std::make_pair(index(tr.elements().finish().begin(),
+      tr.elements().finish().end()), 1));
+  BOOST_CHECK_THROW(coo_to_array<ArrayN>(world, tr, elements), Exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
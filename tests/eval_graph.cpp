@@ -0,0 +1,156 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TiledArray/eval_graph.h"
+#include "TiledArray/expressions.h"
+#include "unit_test_config.h"
+#include "array_fixture.h"
+
+using namespace TiledArray;
+using TiledArray::expressions::EvalGraph;
+
+struct EvalGraphFixture : public AnnotatedTensorFixture {
+  typedef expressions::TensorExpression<ArrayN::value_type> expression_type;
+
+  // Builds left(vars) + right(vars), or left(vars) - right(vars)
+  class Sum {
+  public:
+    Sum(const ArrayN& left, const ArrayN& right, const expressions::VariableList& vars,
+        const bool subtract) :
+      left_(left), right_(right), vars_(vars), subtract_(subtract)
+    { }
+
+    expression_type operator()() const {
+      if(subtract_)
+        return left_(vars_) - right_(vars_);
+      return left_(vars_) + right_(vars_);
+    }
+
+  private:
+    const ArrayN& left_;
+    const ArrayN& right_;
+    expressions::VariableList vars_;
+    bool subtract_;
+  }; // class Sum
+
+  Sum add(const ArrayN& left, const ArrayN& right) const { return Sum(left, right, vars, false); }
+  Sum subt(const ArrayN& left, const ArrayN& right) const { return Sum(left, right, vars, true); }
+
+  EvalGraphFixture() : b(world, tr), c(world, tr), t(world, tr) { }
+
+  ~EvalGraphFixture() { }
+
+  ArrayN b;
+  ArrayN c;
+  ArrayN t;
+}; // struct EvalGraphFixture
+
+BOOST_FIXTURE_TEST_SUITE( eval_graph_suite, EvalGraphFixture )
+
+BOOST_AUTO_TEST_CASE( key )
+{
+  BOOST_CHECK_EQUAL(a(vars).key(), a(vars).key());
+  BOOST_CHECK_EQUAL((a(vars) + b(vars)).key(), (a(vars) + b(vars)).key());
+  BOOST_CHECK(a(vars).key() != b(vars).key());
+  BOOST_CHECK((a(vars) + b(vars)).key() != (a(vars) - b(vars)).key());
+
+  std::vector<const void*> arrays;
+  (a(vars) + b(vars)).collect_arrays(arrays);
+  BOOST_REQUIRE_EQUAL(arrays.size(), 2ul);
+  BOOST_CHECK_EQUAL(arrays[0], static_cast<const void*>(&a));
+  BOOST_CHECK_EQUAL(arrays[1], static_cast<const void*>(&b));
+}
+
+BOOST_AUTO_TEST_CASE( independent )
+{
+  EvalGraph graph;
+  graph.add(b, vars, add(a, a));
+  graph.add(c, vars, subt(a, a));
+  BOOST_CHECK_EQUAL(graph.size(), 2ul);
+
+  BOOST_REQUIRE_NO_THROW(graph.run());
+  BOOST_CHECK_EQUAL(graph.size(), 0ul);
+  BOOST_CHECK_EQUAL(graph.eliminated(), 0ul);
+
+  check_linear(b, 2);
+  check_linear(c, 0);
+}
+
+BOOST_AUTO_TEST_CASE( common_subexpression )
+{
+  EvalGraph graph;
+  graph.add(b, vars, add(a, a));
+  graph.add(c, vars, add(a, a));
+
+  BOOST_REQUIRE_NO_THROW(graph.run());
+  BOOST_CHECK_EQUAL(graph.eliminated(), 1ul);
+
+  check_linear(b, 2);
+  check_linear(c, 2);
+}
+
+BOOST_AUTO_TEST_CASE( dependency )
+{
+  EvalGraph graph;
+  graph.add(t, vars, add(a, a));
+  graph.add(b, vars, subt(t, a));
+  graph.temporary(t);
+
+  BOOST_REQUIRE_NO_THROW(graph.run());
+  BOOST_CHECK_EQUAL(graph.eliminated(), 0ul);
+
+  check_linear(b, 1);
+
+  // The temporary is released after it has been used
+  BOOST_CHECK_THROW(t.get_world(), Exception);
+}
+
+BOOST_AUTO_TEST_CASE( default_constructed_temporary )
+{
+  // The temporary has no tiled range or shape until it is assigned
+  ArrayN temp;
+  EvalGraph graph;
+  graph.add(temp, vars, add(a, a));
+  graph.add(b, vars, add(temp, a));
+  graph.add(c, vars, subt(temp, a));
+  graph.temporary(temp);
+
+  BOOST_REQUIRE_NO_THROW(graph.run());
+  BOOST_CHECK_EQUAL(graph.eliminated(), 0ul);
+
+  check_linear(b, 3);
+  check_linear(c, 1);
+  BOOST_CHECK(! temp.is_initialized());
+}
+
+BOOST_AUTO_TEST_CASE( reads_current_array )
+{
+  // The second statement reads the value of b written by the first
+  EvalGraph graph;
+  graph.add(b, vars, add(a, a));
+  graph.add(c, vars, add(b, a));
+  graph.add(b, vars, subt(c, b));
+
+  BOOST_REQUIRE_NO_THROW(graph.run());
+
+  check_linear(c, 3);
+  check_linear(b, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,111 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TiledArray/fixed_range.h"
+#include "TiledArray/permutation.h"
+#include "unit_test_config.h"
+
+using namespace TiledArray;
+using TiledArray::detail::FixedRange;
+
+struct FixedRangeFixture {
+  FixedRangeFixture() { }
+
+  ~FixedRangeFixture() { }
+
+  // Make a range of rank n that does not start at zero
+  static Range make_range(const unsigned int n) {
+    std::vector<std::size_t> start(n, 0ul);
+    std::vector<std::size_t> finish(n, 0ul);
+    for(unsigned int d = 0u; d < n; ++d) {
+      start[d] = d;
+      finish[d] = d + 2ul + (d % 3ul);
+    }
+    return Range(start, finish);
+  }
+
+  // Make a permutation of rank n that reverses the dimensions
+  static Permutation make_perm(const unsigned int n) {
+    std::vector<std::size_t> p(n, 0ul);
+    for(unsigned int d = 0u; d < n; ++d)
+      p[d] = n - d - 1u;
+    return Permutation(p);
+  }
+
+  // Visitor that records the permuted ordinal of each element
+  class Record {
+  public:
+    Record(std::vector<std::size_t>& result) : result_(result) { }
+
+    void operator()(const std::size_t i, const std::size_t o) const {
+      result_[i] = o;
+    }
+
+  private:
+    std::vector<std::size_t>& result_;
+  }; // class Record
+
+  // Check permute_each against calc_ordinal for a sub-range of elements
+  static void check_permute(const unsigned int n, const std::size_t first_denom) {
+    const Range range = make_range(n);
+    const Permutation perm = make_perm(n);
+    const Range result_range = perm ^ range;
+    const std::vector<std::size_t> ip_weight = (-perm) ^ result_range.weight();
+
+    const std::size_t first = range.volume() / first_denom;
+    const std::size_t last = range.volume();
+    std::vector<std::size_t> result(last, 0ul);
+    detail::permute_each(range, ip_weight, first, last, Record(result));
+
+    Range::const_iterator it = range.begin();
+    for(std::size_t i = 0ul; i < last; ++i, ++it)
+      if(i >= first)
+        BOOST_CHECK_EQUAL(result[i],
+            detail::calc_ordinal(*it, ip_weight, range.start()));
+  }
+}; // struct FixedRangeFixture
+
+BOOST_FIXTURE_TEST_SUITE( fixed_range_suite, FixedRangeFixture )
+
+BOOST_AUTO_TEST_CASE( constructor )
+{
+  const Range range = make_range(3u);
+  FixedRange<3u> r(range);
+  BOOST_CHECK_EQUAL(r.dim(), 3u);
+  BOOST_CHECK_EQUAL(r.volume(), range.volume());
+  for(unsigned int d = 0u; d < 3u; ++d) {
+    BOOST_CHECK_EQUAL(r.size()[d], range.size()[d]);
+    BOOST_CHECK_EQUAL(r.weight()[d], range.weight()[d]);
+  }
+
+#ifdef TA_EXCEPTION_ERROR
+  BOOST_CHECK_THROW(FixedRange<2u> r2(range), Exception);
+#endif // TA_EXCEPTION_ERROR
+}
+
+BOOST_AUTO_TEST_CASE( permute_each )
+{
+  // Rank seven is visited by the dynamic implementation
+  for(unsigned int n = 1u; n <= 7u; ++n) {
+    check_permute(n, 1ul);
+    check_permute(n, 3ul);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,117 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TiledArray/labeled_tiled_range1.h"
+#include "unit_test_config.h"
+
+using namespace TiledArray;
+
+struct LabeledTiledRange1Fixture {
+  LabeledTiledRange1Fixture() : element_labels(), r() {
+    // Element irreps: 0 0 0 1 1 2 3 3
+    const long labels[] = { 0, 0, 0, 1, 1, 2, 3, 3 };
+    element_labels.assign(labels, labels + 8);
+    r = LabeledTiledRange1::make_blocked(element_labels.begin(), element_labels.end());
+  }
+
+  ~LabeledTiledRange1Fixture() { }
+
+  std::vector<long> element_labels;
+  LabeledTiledRange1 r;
+}; // struct LabeledTiledRange1Fixture
+
+BOOST_FIXTURE_TEST_SUITE( labeled_range1_suite, LabeledTiledRange1Fixture )
+
+BOOST_AUTO_TEST_CASE( make_blocked )
+{
+  // Check that one tile is created for each block of equal labels
+  BOOST_CHECK_EQUAL(r.trange1().tiles().first, 0ul);
+  BOOST_CHECK_EQUAL(r.trange1().tiles().second, 4ul);
+  BOOST_CHECK_EQUAL(r.trange1().elements().first, 0ul);
+  BOOST_CHECK_EQUAL(r.trange1().elements().second, 8ul);
+
+  const std::size_t boundaries[] = { 0, 3, 5, 6, 8 };
+  for(std::size_t t = 0ul; t < 4ul; ++t) {
+    BOOST_CHECK_EQUAL(r.trange1().tile(t).first, boundaries[t]);
+    BOOST_CHECK_EQUAL(r.trange1().tile(t).second, boundaries[t + 1]);
+    BOOST_CHECK_EQUAL(r.label(t), long(t));
+  }
+
+  // Check element offset
+  LabeledTiledRange1 r2 = LabeledTiledRange1::make_blocked(element_labels.begin() + 3,
+      element_labels.end(), 3ul);
+  BOOST_CHECK_EQUAL(r2.trange1().elements().first, 3ul);
+  BOOST_CHECK_EQUAL(r2.trange1().elements().second, 8ul);
+  BOOST_CHECK_EQUAL(r2.trange1().tiles().second, 3ul);
+  BOOST_CHECK_EQUAL(r2.label(0), 1l);
+}
+
+BOOST_AUTO_TEST_CASE( constructor )
+{
+  const std::size_t boundaries[] = { 0, 3, 5, 6, 8 };
+  const long labels[] = { 0, 1, 2, 3 };
+  BOOST_REQUIRE_NO_THROW(LabeledTiledRange1 r1(boundaries, boundaries + 5, labels));
+  LabeledTiledRange1 r1(boundaries, boundaries + 5, labels);
+  BOOST_CHECK(r1 == r);
+
+  LabeledTiledRange1 r2(r);
+  BOOST_CHECK(r2 == r);
+
+  LabeledTiledRange1 r3;
+  BOOST_CHECK(r3 != r);
+  r3 = r;
+  BOOST_CHECK(r3 == r);
+}
+
+BOOST_AUTO_TEST_CASE( irrep_shape )
+{
+  const std::vector<LabeledTiledRange1> ranges(2, r);
+  const TiledRange tr = make_trange(ranges.begin(), ranges.end());
+  const detail::Bitset<> shape = make_block_shape<AbelianIrrep>(ranges.begin(), ranges.end(), 2ul);
+  BOOST_CHECK_EQUAL(shape.size(), tr.tiles().volume());
+
+  // Only the diagonal blocks of a totally symmetric matrix are allowed
+  for(std::size_t i = 0ul; i < 4ul; ++i)
+    for(std::size_t j = 0ul; j < 4ul; ++j)
+      BOOST_CHECK_EQUAL(bool(shape[i * 4ul + j]), (i == j));
+
+  // Blocks of a matrix that transforms as irrep 1
+  const detail::Bitset<> shape1 = make_block_shape<AbelianIrrep>(ranges.begin(), ranges.end(), 2ul, 1l);
+  for(std::size_t i = 0ul; i < 4ul; ++i)
+    for(std::size_t j = 0ul; j < 4ul; ++j)
+      BOOST_CHECK_EQUAL(bool(shape1[i * 4ul + j]), ((i ^ j) == 1ul));
+}
+
+BOOST_AUTO_TEST_CASE( spin_shape )
+{
+  const long spin[] = { 1, 1, -1, -1 };
+  LabeledTiledRange1 s = LabeledTiledRange1::make_blocked(spin, spin + 4);
+  BOOST_CHECK_EQUAL(s.trange1().tiles().second, 2ul);
+
+  // <pq|rs> integrals conserve the spin projection: s(p) + s(q) == s(r) + s(s)
+  const std::vector<LabeledTiledRange1> ranges(4, s);
+  const detail::Bitset<> shape = make_block_shape<SpinProjection>(ranges.begin(), ranges.end(), 2ul);
+  for(std::size_t i = 0ul; i < shape.size(); ++i) {
+    const long p = s.label((i >> 3) & 1ul), q = s.label((i >> 2) & 1ul),
+        r = s.label((i >> 1) & 1ul), t = s.label(i & 1ul);
+    BOOST_CHECK_EQUAL(bool(shape[i]), (p + q == r + t));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,93 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TiledArray/profile.h"
+#include "TiledArray/tensor.h"
+#include "unit_test_config.h"
+#include <sstream>
+
+using namespace TiledArray;
+
+struct ProfileFixture {
+  ProfileFixture() : profiler(detail::Profiler::instance()) { profiler.reset(); }
+  ~ProfileFixture() { profiler.reset(); }
+
+  detail::Profiler& profiler;
+}; // struct ProfileFixture
+
+BOOST_FIXTURE_TEST_SUITE( profile_suite, ProfileFixture )
+
+BOOST_AUTO_TEST_CASE( counters )
+{
+  profiler.add_flops("op", 10.0);
+  profiler.add_flops("op", 5.0);
+  profiler.add_send("op", 100ul);
+  profiler.add_recv("op", 40ul);
+  profiler.add_recv("op", 60ul);
+  profiler.add_event("op", 1.0, 3.0);
+
+  detail::Profiler::counter_map counters = profiler.counters();
+  BOOST_REQUIRE_EQUAL(counters.size(), 1ul);
+  BOOST_CHECK_CLOSE(counters["op"].flops, 15.0, 1e-10);
+  BOOST_CHECK_EQUAL(counters["op"].tiles_sent, 1ul);
+  BOOST_CHECK_EQUAL(counters["op"].bytes_sent, 100ul);
+  BOOST_CHECK_EQUAL(counters["op"].tiles_received, 2ul);
+  BOOST_CHECK_EQUAL(counters["op"].bytes_received, 100ul);
+  BOOST_CHECK_EQUAL(counters["op"].tasks, 1ul);
+  BOOST_CHECK_CLOSE(counters["op"].busy_time, 2.0, 1e-10);
+
+  profiler.reset();
+  BOOST_CHECK(profiler.counters().empty());
+}
+
+BOOST_AUTO_TEST_CASE( scope )
+{
+  {
+    detail::ProfileScope scope("scope");
+  }
+
+  detail::Profiler::counter_map counters = profiler.counters();
+  BOOST_CHECK_EQUAL(counters["scope"].tasks, 1ul);
+  BOOST_CHECK(counters["scope"].busy_time >= 0.0);
+}
+
+BOOST_AUTO_TEST_CASE( trace )
+{
+  profiler.add_event("op", madness::wall_time(), madness::wall_time());
+  profiler.add_flops("op", 2.0);
+
+  std::stringstream ss;
+  profiler.write_trace(ss, 0);
+  const std::string trace = ss.str();
+
+  BOOST_CHECK_EQUAL(trace.find("{\"traceEvents\":["), 0ul);
+  BOOST_CHECK(trace.find("\"ph\":\"X\"") != std::string::npos);
+  BOOST_CHECK(trace.find("\"ph\":\"C\"") != std::string::npos);
+  BOOST_CHECK(trace.find("\"flops\":2") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE( tile_bytes )
+{
+  Tensor<double> t(Range(std::vector<std::size_t>(2, 0), std::vector<std::size_t>(2, 3)));
+  BOOST_CHECK_EQUAL(detail::tile_bytes(t), 9ul * sizeof(double));
+  BOOST_CHECK_EQUAL(detail::tile_bytes(madness::Future<Tensor<double> >(t)), 9ul * sizeof(double));
+  BOOST_CHECK_EQUAL(detail::tile_bytes(madness::Future<Tensor<double> >()), 0ul);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
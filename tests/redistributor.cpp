@@ -0,0 +1,136 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TiledArray/redistributor.h"
+#include "unit_test_config.h"
+
+using namespace TiledArray;
+using TiledArray::detail::Bitset;
+
+struct RedistributorFixture {
+  // The old tiles are [0,2), [2,5), [5,10), [10,17) and the new tiles are
+  // [0,4), [4,8), [8,12), [12,16), [16,17)
+  RedistributorFixture() : source(make_trange(old_boundaries())),
+      result(make_trange(new_boundaries()))
+  { }
+
+  ~RedistributorFixture() { }
+
+  static std::vector<std::size_t> old_boundaries() {
+    std::vector<std::size_t> b;
+    b.push_back(0ul);
+    b.push_back(2ul);
+    b.push_back(5ul);
+    b.push_back(10ul);
+    b.push_back(17ul);
+    return b;
+  }
+
+  static std::vector<std::size_t> new_boundaries() {
+    std::vector<std::size_t> b;
+    for(std::size_t e = 0ul; e < 17ul; e += 4ul)
+      b.push_back(e);
+    b.push_back(17ul);
+    return b;
+  }
+
+  static TiledRange make_trange(const std::vector<std::size_t>& b) {
+    const std::vector<TiledRange1> dims(2ul, TiledRange1(b.begin(), b.end()));
+    return TiledRange(dims.begin(), dims.end());
+  }
+
+  // Make a range with two dimensions
+  static Range make_range(const std::size_t s0, const std::size_t s1,
+      const std::size_t f0, const std::size_t f1)
+  {
+    Range::index start(2ul, 0ul);
+    Range::index finish(2ul, 0ul);
+    start[0] = s0;
+    start[1] = s1;
+    finish[0] = f0;
+    finish[1] = f1;
+    return Range(start, finish);
+  }
+
+  // Check that pack_block copies the elements of a block in order
+  static void check_block(const Range& range, const Range& block) {
+    std::vector<int> tile(range.volume());
+    for(std::size_t i = 0ul; i < tile.size(); ++i)
+      tile[i] = i;
+
+    std::vector<int> packed(block.volume(), -1);
+    detail::pack_block(range, & tile.front(), block.start(), block.finish(), & packed.front());
+    std::vector<int>::const_iterator p = packed.begin();
+    for(Range::const_iterator it = block.begin(); it != block.end(); ++it, ++p)
+      BOOST_CHECK_EQUAL(*p, int(range.ord(*it)));
+
+    // Unpacking the block restores the elements
+    std::vector<int> unpacked(range.volume(), -1);
+    detail::unpack_block(range, & unpacked.front(), block.start(), block.finish(), & packed.front());
+    for(Range::const_iterator it = range.begin(); it != range.end(); ++it)
+      BOOST_CHECK_EQUAL(unpacked[range.ord(*it)], (block.includes(*it) ? int(range.ord(*it)) : -1));
+  }
+
+  const TiledRange source;
+  const TiledRange result;
+}; // struct RedistributorFixture
+
+BOOST_FIXTURE_TEST_SUITE( redistributor_suite, RedistributorFixture )
+
+BOOST_AUTO_TEST_CASE( tile_overlap )
+{
+  // Old tile (2,3) has elements [5,10) x [10,17)
+  const Range overlap = detail::tile_overlap(result, source.make_tile_range(2ul * 4ul + 3ul));
+  BOOST_CHECK_EQUAL(overlap, make_range(1ul, 2ul, 3ul, 5ul));
+
+  // A range that is inside one tile
+  BOOST_CHECK_EQUAL(detail::tile_overlap(source, make_range(5ul, 11ul, 6ul, 12ul)),
+      make_range(2ul, 3ul, 3ul, 4ul));
+}
+
+BOOST_AUTO_TEST_CASE( retile_shape )
+{
+  Bitset<> shape(source.tiles().volume());
+  shape.set(0ul); // Elements [0,2) x [0,2)
+  shape.set(2ul * 4ul + 3ul); // Elements [5,10) x [10,17)
+  const Bitset<> result_shape = detail::retile_shape(source, shape, result);
+
+  BOOST_CHECK_EQUAL(result_shape.size(), result.tiles().volume());
+  const Range r0 = detail::tile_overlap(result, source.make_tile_range(0ul));
+  const Range r1 = detail::tile_overlap(result, source.make_tile_range(2ul * 4ul + 3ul));
+  for(Range::const_iterator it = result.tiles().begin(); it != result.tiles().end(); ++it)
+    BOOST_CHECK_EQUAL(bool(result_shape[result.tiles().ord(*it)]),
+        r0.includes(*it) || r1.includes(*it));
+}
+
+BOOST_AUTO_TEST_CASE( pack_block )
+{
+  const Range range = make_range(3ul, 4ul, 9ul, 11ul);
+
+  // Rows are not contiguous
+  check_block(range, make_range(4ul, 5ul, 7ul, 8ul));
+  // Rows span the last dimension and are merged
+  check_block(range, make_range(4ul, 4ul, 7ul, 11ul));
+  // The whole range
+  check_block(range, range);
+  // A single element
+  check_block(range, make_range(8ul, 10ul, 9ul, 11ul));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,95 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TiledArray/shape_contract.h"
+#include "unit_test_config.h"
+
+using namespace TiledArray;
+using TiledArray::detail::Bitset;
+
+struct ShapeContractFixture {
+  // The sizes are chosen so that rows do not start on block boundaries
+  ShapeContractFixture() : m(37), k(101), n(71), left(m * k), right(k * n) {
+    for(std::size_t i = 0ul; i < left.size(); ++i)
+      if((i * 7ul) % 11ul == 0ul)
+        left.set(i);
+    for(std::size_t i = 0ul; i < right.size(); ++i)
+      if((i * 5ul) % 13ul == 0ul)
+        right.set(i);
+  }
+
+  ~ShapeContractFixture() { }
+
+  // Check result against a direct boolean matrix product, where empty
+  // argument shapes are dense.
+  void check(const Bitset<>& result, const Bitset<>& l, const Bitset<>& r) const {
+    for(std::size_t i = 0ul; i < m; ++i) {
+      for(std::size_t j = 0ul; j < n; ++j) {
+        bool expected = false;
+        for(std::size_t x = 0ul; x < k; ++x)
+          if((l.size() == 0ul || l[i * k + x]) && (r.size() == 0ul || r[x * n + j]))
+            expected = true;
+        BOOST_CHECK_EQUAL(bool(result[i * n + j]), expected);
+      }
+    }
+  }
+
+  const std::size_t m;
+  const std::size_t k;
+  const std::size_t n;
+  Bitset<> left;
+  Bitset<> right;
+}; // struct ShapeContractFixture
+
+BOOST_FIXTURE_TEST_SUITE( shape_contract_suite, ShapeContractFixture )
+
+BOOST_AUTO_TEST_CASE( sparse )
+{
+  Bitset<> result(m * n);
+  detail::contract_shape(result, left, right, m, k, n);
+  check(result, left, right);
+}
+
+BOOST_AUTO_TEST_CASE( dense_left )
+{
+  Bitset<> result(m * n);
+  detail::contract_shape(result, Bitset<>(0ul), right, m, k, n);
+  check(result, Bitset<>(0ul), right);
+}
+
+BOOST_AUTO_TEST_CASE( dense_right )
+{
+  Bitset<> result(m * n);
+  detail::contract_shape(result, left, Bitset<>(0ul), m, k, n);
+  check(result, left, Bitset<>(0ul));
+}
+
+BOOST_AUTO_TEST_CASE( zero )
+{
+  // A zero row of the left shape gives a zero row of the result
+  Bitset<> l(m * k);
+  l.set(3ul * k + 5ul);
+  Bitset<> result(m * n);
+  detail::contract_shape(result, l, right, m, k, n);
+  check(result, l, right);
+  for(std::size_t j = 0ul; j < n; ++j)
+    BOOST_CHECK(! result[j]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
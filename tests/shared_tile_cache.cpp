@@ -0,0 +1,118 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TiledArray/shared_tile_cache.h"
+#include "TiledArray/tensor.h"
+#include "unit_test_config.h"
+#include "global_fixture.h"
+
+using namespace TiledArray;
+using TiledArray::detail::SharedTileCache;
+
+struct SharedTileCacheFixture {
+  SharedTileCacheFixture() :
+    cache(SharedTileCache::instance(* GlobalFixture::world)),
+    tile(Range(std::vector<std::size_t>(2, 0ul), std::vector<std::size_t>(2, 10ul)))
+  {
+    for(std::size_t i = 0ul; i < tile.size(); ++i)
+      tile[i] = i;
+  }
+
+  ~SharedTileCacheFixture() { }
+
+  // Make a key that is unique to this process and test
+  SharedTileCache::key_type key(const unsigned long tag, const unsigned long index) const {
+    SharedTileCache::key_type k;
+    k.world = GlobalFixture::world->id();
+    k.object = ~0ul - GlobalFixture::world->rank();
+    k.tag = tag;
+    k.index = index;
+    return k;
+  }
+
+  SharedTileCache& cache;
+  Tensor<int> tile;
+}; // struct SharedTileCacheFixture
+
+BOOST_FIXTURE_TEST_SUITE( shared_tile_cache_suite, SharedTileCacheFixture )
+
+BOOST_AUTO_TEST_CASE( instance )
+{
+  // The same cache is returned for a world
+  BOOST_CHECK_EQUAL(& SharedTileCache::instance(* GlobalFixture::world), & cache);
+  BOOST_CHECK_THROW(SharedTileCache::size(0ul), Exception);
+  BOOST_CHECK_THROW(SharedTileCache::entries(0ul), Exception);
+}
+
+BOOST_AUTO_TEST_CASE( insert_find )
+{
+  Tensor<int> result;
+  if(cache.enabled()) {
+    // A pinned tile is kept until it has been read
+    BOOST_CHECK(cache.insert(key(0ul, 0ul), tile, 1l));
+    BOOST_CHECK(cache.find(key(0ul, 0ul), result, true));
+    BOOST_CHECK_EQUAL(result.range(), tile.range());
+    for(std::size_t i = 0ul; i < tile.size(); ++i)
+      BOOST_CHECK_EQUAL(result[i], tile[i]);
+
+    // Missing tiles are not found
+    BOOST_CHECK(! cache.find(key(0ul, 1ul), result, false));
+    BOOST_CHECK(! cache.find(key(1ul, 0ul), result, false));
+  } else {
+    // An inactive cache does not store tiles
+    BOOST_CHECK(! cache.insert(key(0ul, 0ul), tile, 1l));
+    BOOST_CHECK(! cache.find(key(0ul, 0ul), result, true));
+  }
+}
+
+BOOST_AUTO_TEST_CASE( erase )
+{
+  Tensor<int> result;
+  if(cache.enabled()) {
+    // An erased tile is not found, even when it is pinned
+    BOOST_CHECK(cache.insert(key(3ul, 0ul), tile, 1l));
+    cache.erase(key(3ul, 0ul));
+    BOOST_CHECK(! cache.find(key(3ul, 0ul), result, true));
+
+    // The tile can be stored again
+    BOOST_CHECK(cache.insert(key(3ul, 0ul), tile, 0l));
+    BOOST_CHECK(cache.find(key(3ul, 0ul), result, false));
+  }
+
+  // Erasing a missing tile has no effect
+  cache.erase(key(3ul, 1ul));
+  BOOST_CHECK(! cache.find(key(3ul, 1ul), result, false));
+}
+
+BOOST_AUTO_TEST_CASE( eviction )
+{
+  // Other processes on this node would share the cache
+  if(cache.enabled() && (GlobalFixture::world->size() == 1)) {
+    // Store more unpinned tiles than there are cache entries
+    const std::size_t n = SharedTileCache::entries() + 1ul;
+    for(std::size_t i = 0ul; i < n; ++i)
+      BOOST_CHECK(cache.insert(key(2ul, i), tile, 0l));
+
+    Tensor<int> result;
+    BOOST_CHECK(! cache.find(key(2ul, 0ul), result, false));
+    BOOST_CHECK(cache.find(key(2ul, n - 1ul), result, false));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,218 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TiledArray/symmetry.h"
+#include "TiledArray/array.h"
+#include "TiledArray/expressions.h"
+#include "unit_test_config.h"
+#include "range_fixture.h"
+#include <sstream>
+
+using namespace TiledArray;
+
+struct SymmetryFixture : public TiledRangeFixture {
+  SymmetryFixture() : world(*GlobalFixture::world), sym(GlobalFixture::dim) {
+    // Symmetric in the first two indices
+    std::vector<std::size_t> p(GlobalFixture::dim);
+    for(std::size_t i = 0ul; i < GlobalFixture::dim; ++i)
+      p[i] = i;
+    std::swap(p[0], p[1]);
+    sym.add(Permutation(p.begin(), p.end()));
+  }
+
+  ~SymmetryFixture() {
+    GlobalFixture::world->gop.fence();
+  }
+
+  madness::World& world;
+  Symmetry sym;
+}; // struct SymmetryFixture
+
+BOOST_FIXTURE_TEST_SUITE( symmetry_suite, SymmetryFixture )
+
+BOOST_AUTO_TEST_CASE( constructor )
+{
+  BOOST_REQUIRE_NO_THROW(Symmetry s(3));
+  Symmetry s(3);
+  BOOST_CHECK_EQUAL(s.dim(), 3u);
+  BOOST_CHECK_EQUAL(s.order(), 1ul);
+  BOOST_CHECK(s.is_trivial());
+  BOOST_CHECK_EQUAL(s.perm(0), Permutation(0,1,2));
+  BOOST_CHECK_EQUAL(s.sign(0), 1);
+}
+
+BOOST_AUTO_TEST_CASE( group_closure )
+{
+  // A single 3-cycle generates the cyclic group of order 3
+  Symmetry s(3);
+  s.add(Permutation(1,2,0));
+  BOOST_CHECK_EQUAL(s.order(), 3ul);
+
+  // Adding a transposition generates the full symmetric group S3
+  s.add(Permutation(1,0,2));
+  BOOST_CHECK_EQUAL(s.order(), 6ul);
+
+  // Antisymmetry is propagated through the group
+  Symmetry a(3);
+  a.add(Permutation(1,0,2), -1);
+  a.add(Permutation(0,2,1), -1);
+  BOOST_CHECK_EQUAL(a.order(), 6ul);
+  for(Symmetry::size_type g = 0ul; g < a.order(); ++g) {
+    if(a.perm(g) == Permutation(1,2,0) || a.perm(g) == Permutation(2,0,1)
+        || a.perm(g) == Permutation(0,1,2))
+      BOOST_CHECK_EQUAL(a.sign(g), 1);
+    else
+      BOOST_CHECK_EQUAL(a.sign(g), -1);
+  }
+
+  // Inconsistent generators
+  Symmetry bad(3);
+  bad.add(Permutation(1,0,2), -1);
+  BOOST_CHECK_THROW(bad.add(Permutation(1,0,2), 1), TiledArray::Exception);
+}
+
+BOOST_AUTO_TEST_CASE( canonical )
+{
+  Symmetry s(3);
+  s.add(Permutation(1,0,2), -1);
+
+  std::vector<std::size_t> i(3);
+  i[0] = 3; i[1] = 1; i[2] = 2;
+  Permutation perm;
+  int sign = 0;
+  std::vector<std::size_t> c = s.canonical(i, perm, sign);
+  BOOST_CHECK_EQUAL(c[0], 1ul);
+  BOOST_CHECK_EQUAL(c[1], 3ul);
+  BOOST_CHECK_EQUAL(c[2], 2ul);
+  BOOST_CHECK_EQUAL(sign, -1);
+  BOOST_CHECK((perm ^ c) == i);
+
+  BOOST_CHECK(! s.is_unique(i));
+  BOOST_CHECK(s.is_unique(c));
+
+  // Canonical indices map onto themselves
+  c = s.canonical(c, perm, sign);
+  BOOST_CHECK_EQUAL(sign, 1);
+  BOOST_CHECK_EQUAL(perm, Permutation(0,1,2));
+}
+
+BOOST_AUTO_TEST_CASE( symmetric_array )
+{
+  typedef Array<int, GlobalFixture::dim> ArrayN;
+  ArrayN a(world, tr, sym);
+
+  BOOST_CHECK(! a.is_dense());
+  BOOST_REQUIRE(a.get_symmetry());
+
+  // Only unique tiles are stored
+  for(ArrayN::range_type::const_iterator it = a.range().begin(); it != a.range().end(); ++it) {
+    BOOST_CHECK_EQUAL(a.is_unique(*it), sym.is_unique(*it));
+    BOOST_CHECK_EQUAL(bool(a.get_shape()[a.range().ord(*it)]), sym.is_unique(*it));
+    BOOST_CHECK(! a.is_zero(*it));
+  }
+
+  // Fill the unique tiles with their ordinal element index
+  for(ArrayN::range_type::const_iterator it = a.range().begin(); it != a.range().end(); ++it)
+    if(a.is_local(*it) && a.is_unique(*it)) {
+      ArrayN::value_type tile(a.trange().make_tile_range(*it));
+      for(std::size_t i = 0ul; i < tile.size(); ++i)
+        tile[i] = a.elements().ord(tile.range().idx(i));
+      a.set(*it, tile);
+    }
+  world.gop.fence();
+
+  // Check that non-unique tiles are the transpose of the unique tiles
+  for(ArrayN::range_type::const_iterator it = a.range().begin(); it != a.range().end(); ++it) {
+    ArrayN::value_type tile = a.find(*it).get();
+    BOOST_CHECK(tile.range() == a.trange().make_tile_range(*it));
+    const bool unique = a.is_unique(*it);
+    for(std::size_t i = 0ul; i < tile.size(); ++i) {
+      ArrayN::index e = tile.range().idx(i);
+      if(! unique)
+        std::swap(e[0], e[1]);
+      BOOST_CHECK_EQUAL(tile[i], int(a.elements().ord(e)));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( symmetric_expression )
+{
+  typedef Array<int, GlobalFixture::dim> ArrayN;
+  ArrayN a(world, tr, sym);
+  for(ArrayN::range_type::const_iterator it = a.range().begin(); it != a.range().end(); ++it)
+    if(a.is_local(*it) && a.is_unique(*it))
+      a.set(*it, int(a.range().ord(*it)) + 1);
+  world.gop.fence();
+
+  std::stringstream vars;
+  vars << "a0";
+  for(std::size_t i = 1ul; i < GlobalFixture::dim; ++i)
+    vars << ",a" << i;
+
+  // The expression holds every tile of the symmetric array
+  ArrayN b(world, tr);
+  BOOST_REQUIRE_NO_THROW(b(vars.str()) = a(vars.str()));
+  world.gop.fence();
+
+  BOOST_CHECK(b.is_dense() || (b.get_shape().count() == b.size()));
+  for(ArrayN::range_type::const_iterator it = b.range().begin(); it != b.range().end(); ++it) {
+    BOOST_CHECK(! b.is_zero(*it));
+    const ArrayN::value_type tile = b.find(*it).get();
+    const ArrayN::value_type expected = a.find(*it).get();
+    BOOST_CHECK(tile.range() == expected.range());
+    BOOST_CHECK_EQUAL_COLLECTIONS(tile.begin(), tile.end(), expected.begin(), expected.end());
+  }
+}
+
+BOOST_AUTO_TEST_CASE( assign_symmetric_result )
+{
+  typedef Array<int, GlobalFixture::dim> ArrayN;
+  ArrayN a(world, tr, sym);
+  for(ArrayN::range_type::const_iterator it = a.range().begin(); it != a.range().end(); ++it)
+    if(a.is_local(*it) && a.is_unique(*it))
+      a.set(*it, int(a.range().ord(*it)) + 1);
+  world.gop.fence();
+
+  std::stringstream vars;
+  vars << "a0";
+  for(std::size_t i = 1ul; i < GlobalFixture::dim; ++i)
+    vars << ",a" << i;
+
+  // The result keeps the symmetry of the target and stores only the
+  // canonical tiles
+  ArrayN b(world, tr, sym);
+  BOOST_REQUIRE_NO_THROW(b(vars.str()) = a(vars.str()) + a(vars.str()));
+  world.gop.fence();
+
+  BOOST_REQUIRE(b.get_symmetry());
+  BOOST_CHECK(! b.get_symmetry()->is_trivial());
+  BOOST_CHECK(! b.is_dense());
+  BOOST_CHECK_EQUAL(b.get_shape().count(), a.get_shape().count());
+  for(ArrayN::range_type::const_iterator it = b.range().begin(); it != b.range().end(); ++it) {
+    BOOST_CHECK_EQUAL(bool(b.get_shape()[b.range().ord(*it)]), sym.is_unique(*it));
+    BOOST_CHECK(! b.is_zero(*it));
+    const ArrayN::value_type tile = b.find(*it).get();
+    const ArrayN::value_type expected = a.find(*it).get();
+    BOOST_CHECK(tile.range() == expected.range());
+    for(std::size_t i = 0ul; i < expected.size(); ++i)
+      BOOST_CHECK_EQUAL(tile[i], 2 * expected[i]);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
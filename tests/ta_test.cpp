@@ -20,12 +20,16 @@
 #define BOOST_TEST_MAIN TiledArray Tests
 #include "unit_test_config.h"
 #include <world/world.h>
+#include "TiledArray/initialize.h"
 
 GlobalFixture::GlobalFixture() {
   world = & madness::initialize(
       boost::unit_test::framework::master_test_suite().argc,
       boost::unit_test::framework::master_test_suite().argv);
 
+  // Exchange the node ids and open the node shared tile cache (collective)
+  TiledArray::initialize(*world);
+
   world->gop.fence();
 }
 
@@ -0,0 +1,84 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TiledArray/task_granularity.h"
+#include "TiledArray/expressions.h"
+#include "unit_test_config.h"
+#include "array_fixture.h"
+
+using namespace TiledArray;
+using TiledArray::detail::TaskGranularity;
+
+struct TaskGranularityFixture : public AnnotatedTensorFixture {
+  TaskGranularityFixture() : target(TaskGranularity::target()), b(world, tr) { }
+
+  ~TaskGranularityFixture() { TaskGranularity::target(target); }
+
+  const std::size_t target;
+  ArrayN b;
+}; // struct TaskGranularityFixture
+
+BOOST_FIXTURE_TEST_SUITE( task_granularity_suite, TaskGranularityFixture )
+
+BOOST_AUTO_TEST_CASE( policy )
+{
+  TaskGranularity::target(1000ul);
+  BOOST_CHECK_EQUAL(TaskGranularity::target(), 1000ul);
+  BOOST_CHECK_THROW(TaskGranularity::target(0ul), Exception);
+
+  BOOST_CHECK(TaskGranularity::is_small(10ul));
+  BOOST_CHECK(! TaskGranularity::is_small(1000ul));
+
+  BOOST_CHECK_EQUAL(TaskGranularity::splits(1000ul), 1ul);
+  BOOST_CHECK_EQUAL(TaskGranularity::splits(3999ul), 1ul);
+  BOOST_CHECK(TaskGranularity::splits(1000000ul) >= 1ul);
+  BOOST_CHECK(TaskGranularity::splits(1000000ul) <= madness::ThreadPool::size() + 1ul);
+
+  // The parts cover the whole tile without gaps
+  BOOST_CHECK_EQUAL(TaskGranularity::first(10ul, 3ul, 0ul), 0ul);
+  BOOST_CHECK_EQUAL(TaskGranularity::first(10ul, 3ul, 1ul), 4ul);
+  BOOST_CHECK_EQUAL(TaskGranularity::first(10ul, 3ul, 2ul), 7ul);
+  BOOST_CHECK_EQUAL(TaskGranularity::first(10ul, 3ul, 3ul), 10ul);
+}
+
+BOOST_AUTO_TEST_CASE( batch )
+{
+  // All tiles are small compared to the target
+  TaskGranularity::target(1000000ul);
+
+  b(vars) = a(vars) + a(vars);
+  check_linear(b, 2, 0);
+
+  b(vars) = a(vars) + 1;
+  check_linear(b, 1, 1);
+}
+
+BOOST_AUTO_TEST_CASE( split )
+{
+  // All tiles are large compared to the target
+  TaskGranularity::target(1ul);
+
+  b(vars) = a(vars) - 3 * a(vars);
+  check_linear(b, -2, 0);
+
+  b(vars) = a(vars) - 1;
+  check_linear(b, 1, -1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,116 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TiledArray/math/team.h"
+#include "TiledArray/tile_op/permute.h"
+#include "unit_test_config.h"
+
+using namespace TiledArray;
+using TiledArray::math::Team;
+
+struct TeamFixture {
+  TeamFixture() : threshold(Team::threshold()) {
+    // Make every kernel large enough to use a team
+    Team::threshold(1ul);
+  }
+
+  ~TeamFixture() { Team::threshold(threshold); }
+
+  /// Kernel that counts the number of times each item is visited
+  class CountOp {
+  private:
+    std::vector<int>& count_;
+
+  public:
+    CountOp(std::vector<int>& count) : count_(count) { }
+
+    void operator()(const std::size_t first, const std::size_t last) const {
+      for(std::size_t i = first; i < last; ++i)
+        ++count_[i];
+    }
+  }; // class CountOp
+
+  const std::size_t threshold;
+}; // struct TeamFixture
+
+BOOST_FIXTURE_TEST_SUITE( team_suite, TeamFixture )
+
+BOOST_AUTO_TEST_CASE( size )
+{
+  BOOST_CHECK_EQUAL(Team::size(0ul), 1ul);
+  BOOST_CHECK(Team::size(1000000ul) >= 1ul);
+  BOOST_CHECK(Team::size(1000000ul) <= madness::ThreadPool::size() + 1ul);
+  BOOST_CHECK_THROW(Team::threshold(0ul), Exception);
+}
+
+BOOST_AUTO_TEST_CASE( team_for )
+{
+  // Each work item is visited exactly once
+  std::vector<int> count(1001, 0);
+  math::team_for(count.size(), count.size(), CountOp(count));
+  for(std::size_t i = 0ul; i < count.size(); ++i)
+    BOOST_CHECK_EQUAL(count[i], 1);
+}
+
+BOOST_AUTO_TEST_CASE( gemm )
+{
+  const integer m = 37, n = 23, k = 11;
+  std::vector<double> a(m * k), b(k * n), c(m * n, 1.0), c0(m * n, 1.0);
+  for(std::size_t i = 0ul; i < a.size(); ++i)
+    a[i] = double(i % 7) - 3.0;
+  for(std::size_t i = 0ul; i < b.size(); ++i)
+    b[i] = double(i % 5) + 0.5;
+
+  math::gemm(m, n, k, 2.0, & a.front(), & b.front(), & c0.front());
+  math::team_gemm(m, n, k, 2.0, & a.front(), & b.front(), & c.front());
+
+  for(std::size_t i = 0ul; i < c.size(); ++i)
+    BOOST_CHECK_CLOSE(c[i], c0[i], 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE( vector_assign )
+{
+  std::vector<int> t(1000), u(1000, 1);
+  for(std::size_t i = 0ul; i < t.size(); ++i)
+    t[i] = i;
+
+  math::team_vector_assign(t.size(), & t.front(), & u.front(), math::PlusAssign<int, int>());
+  for(std::size_t i = 0ul; i < u.size(); ++i)
+    BOOST_CHECK_EQUAL(u[i], int(i) + 1);
+}
+
+BOOST_AUTO_TEST_CASE( permute )
+{
+  // A permutation by a team gives the same result as a serial permutation
+  std::vector<std::size_t> start(3, 0ul), finish(3, 20ul);
+  finish[1] = 30ul;
+  Tensor<int> t((Range(start, finish)));
+  for(std::size_t i = 0ul; i < t.size(); ++i)
+    t[i] = i;
+
+  const Permutation perm(2,0,1);
+  Tensor<int> result;
+  math::permute(result, perm, t);
+
+  BOOST_REQUIRE_EQUAL(result.size(), t.size());
+  for(std::size_t i = 0ul; i < t.size(); ++i)
+    BOOST_CHECK_EQUAL(result[perm ^ t.range().idx(i)], t[i]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,61 @@
+/*
+ * This file is a part of TiledArray.
+ * Copyright (C) 2013  Virginia Tech
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TiledArray/tile_truncation.h"
+#include "TiledArray/tensor.h"
+#include "unit_test_config.h"
+
+using namespace TiledArray;
+using TiledArray::detail::TileTruncation;
+
+struct TileTruncationFixture {
+  TileTruncationFixture() :
+    tile(Range(std::vector<std::size_t>(2, 0ul), std::vector<std::size_t>(2, 3ul)), -2.0)
+  { }
+
+  ~TileTruncationFixture() {
+    TileTruncation::threshold(0.0);
+  }
+
+  Tensor<double> tile;
+}; // struct TileTruncationFixture
+
+BOOST_FIXTURE_TEST_SUITE( tile_truncation_suite, TileTruncationFixture )
+
+BOOST_AUTO_TEST_CASE( threshold )
+{
+  // Automatic truncation is disabled by default
+  BOOST_CHECK_EQUAL(TileTruncation::threshold(), 0.0);
+
+  TileTruncation::threshold(1.0e-8);
+  BOOST_CHECK_EQUAL(TileTruncation::threshold(), 1.0e-8);
+
+#ifdef TA_EXCEPTION_ERROR
+  BOOST_CHECK_THROW(TileTruncation::threshold(-1.0), Exception);
+#endif // TA_EXCEPTION_ERROR
+}
+
+BOOST_AUTO_TEST_CASE( norm )
+{
+  // Nine elements with a magnitude of two
+  BOOST_CHECK_CLOSE(TileTruncation::norm(tile), 6.0, 1.0e-10);
+  BOOST_CHECK_EQUAL(TileTruncation::norm(Tensor<double>()), 0.0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -135,6 +135,19 @@ BOOST_AUTO_TEST_CASE( assignment )
   BOOST_CHECK_EQUAL(r1, tr);
 }
 
+BOOST_AUTO_TEST_CASE( element_to_tile )
+{
+  TiledRange::index result;
+  for(TiledRange::tile_range_type::const_iterator it = tr.elements().begin(); it != tr.elements().end(); ++it) {
+    const TiledRange::index t = tr.element_to_tile(*it);
+    BOOST_CHECK(tr.make_tile_range(t).includes(*it));
+
+    tr.element_to_tile(*it, result);
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), t.begin(), t.end());
+    BOOST_CHECK_EQUAL(tr.element_to_tile_ord(*it), tr.tiles().ord(t));
+  }
+}
+
 BOOST_AUTO_TEST_CASE( permutation )
 {
   Permutation p(2,0,1);
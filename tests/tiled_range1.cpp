@@ -169,6 +169,46 @@ BOOST_AUTO_TEST_CASE( element2tile )
   BOOST_CHECK_EQUAL_COLLECTIONS(c.begin(), c.end(), e.begin(), e.end());
 }
 
+BOOST_AUTO_TEST_CASE( element2tile_uniform )
+{
+  // Uniform tiles with a short last tile, an offset element range and an
+  // offset tile range.
+  std::vector<std::size_t> b;
+  for(std::size_t i = 3ul; i < 40ul; i += 4ul)
+    b.push_back(i);
+  b.push_back(41ul);
+  TiledRange1 r(b.begin(), b.end(), 2ul);
+
+  for(std::size_t t = r.tiles().first; t < r.tiles().second; ++t)
+    for(std::size_t i = r.tile(t).first; i < r.tile(t).second; ++i)
+      BOOST_CHECK_EQUAL(r.element2tile(i), t);
+
+  // A large last tile is not uniform
+  b.back() = 50ul;
+  TiledRange1 r2(b.begin(), b.end(), 2ul);
+  for(std::size_t t = r2.tiles().first; t < r2.tiles().second; ++t)
+    for(std::size_t i = r2.tile(t).first; i < r2.tile(t).second; ++i)
+      BOOST_CHECK_EQUAL(r2.element2tile(i), t);
+}
+
+BOOST_AUTO_TEST_CASE( element2tile_batch )
+{
+  // Elements in forward and reverse order
+  std::vector<std::size_t> elements;
+  for(std::size_t i = tr1.elements().first; i < tr1.elements().second; ++i)
+    elements.push_back(i);
+  for(std::size_t i = tr1.elements().second; i > tr1.elements().first; --i)
+    elements.push_back(i - 1ul);
+
+  std::vector<std::size_t> e;
+  for(std::vector<std::size_t>::const_iterator it = elements.begin(); it != elements.end(); ++it)
+    e.push_back(tr1.element2tile(*it));
+
+  std::vector<std::size_t> c(elements.size(), 0ul);
+  BOOST_CHECK(tr1.element2tile(elements.begin(), elements.end(), c.begin()) == c.end());
+  BOOST_CHECK_EQUAL_COLLECTIONS(c.begin(), c.end(), e.begin(), e.end());
+}
+
 BOOST_AUTO_TEST_CASE( comparison )
 {
   TiledRange1 r1(tr1);
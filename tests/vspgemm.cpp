@@ -18,17 +18,198 @@
  */
 
 #include "TiledArray/vspgemm.h"
+#include "TiledArray/summa.h"
+#include "TiledArray/array.h"
 #include "unit_test_config.h"
+#include "array_fixture.h"
 
-struct VSpGemmFixture {
+using namespace TiledArray;
+using namespace TiledArray::expressions;
+using TiledArray::detail::StealQueue;
 
+struct VSpGemmFixture : public AnnotatedTensorFixture {
+  typedef TensorExpression<array_annotation::value_type> tensor_expression;
+  typedef TiledArray::expressions::detail::TensorExpressionImpl<tensor_expression::value_type> impl_type;
+  typedef StealQueue<int> queue_type;
+
+  VSpGemmFixture() { }
+
+  ~VSpGemmFixture() { }
+
+  // Construct the contraction of left and right with the algorithm Impl
+  template <typename Impl>
+  static tensor_expression make(const array_annotation& left, const array_annotation& right) {
+    return tensor_expression(std::shared_ptr<impl_type>(new Impl(left, right),
+        madness::make_deferred_deleter<impl_type>(left.get_world())));
+  }
+
+  // Evaluate a contraction
+  void eval(tensor_expression& expr) {
+    expr.eval(expr.vars(), std::shared_ptr<tensor_expression::pmap_interface>(
+        new TiledArray::detail::BlockedPmap(world, expr.size()))).get();
+  }
+
+  // Check that VSpGemm and SUMMA compute the same contraction of x with itself
+  void check_contraction(const ArrayN& x) {
+    const array_annotation vleft(x(left_var));
+    const array_annotation vright(x(right_var));
+    const array_annotation sleft(x(left_var));
+    const array_annotation sright(x(right_var));
+    tensor_expression vspgemm = make<VSpGemm<array_annotation, array_annotation> >(vleft, vright);
+    tensor_expression summa = make<Summa<array_annotation, array_annotation> >(sleft, sright);
+
+    eval(vspgemm);
+    eval(summa);
+    world.gop.fence();
+
+    BOOST_REQUIRE_EQUAL(vspgemm.size(), summa.size());
+    for(std::size_t i = 0ul; i < summa.size(); ++i) {
+      BOOST_CHECK_EQUAL(vspgemm.is_zero(i), summa.is_zero(i));
+      if(! summa.is_zero(i)) {
+        const tensor_expression::value_type expected = summa[i].get();
+        const tensor_expression::value_type result = vspgemm[i].get();
+        BOOST_CHECK_EQUAL(result.range(), expected.range());
+        BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(),
+            expected.begin(), expected.end());
+      }
+    }
+  }
+
+  static const VariableList left_var;
+  static const VariableList right_var;
 }; // struct VSpGemmFixture
 
+const VariableList VSpGemmFixture::left_var(
+    AnnotatedTensorFixture::make_var_list(0, GlobalFixture::dim));
+const VariableList VSpGemmFixture::right_var(
+    AnnotatedTensorFixture::make_var_list(1, GlobalFixture::dim + 1));
+
 BOOST_FIXTURE_TEST_SUITE( vspgemm_suite , VSpGemmFixture )
 
-BOOST_AUTO_TEST_CASE( constructor )
+BOOST_AUTO_TEST_CASE( steal_size )
+{
+  // A victim keeps a full window
+  BOOST_CHECK_EQUAL(queue_type::steal_size(0ul, 4ul, 16ul), 0ul);
+  BOOST_CHECK_EQUAL(queue_type::steal_size(4ul, 4ul, 16ul), 0ul);
+
+  // and hands over half of the rest, rounded up
+  BOOST_CHECK_EQUAL(queue_type::steal_size(5ul, 4ul, 16ul), 1ul);
+  BOOST_CHECK_EQUAL(queue_type::steal_size(10ul, 4ul, 16ul), 3ul);
+
+  // up to the maximum
+  BOOST_CHECK_EQUAL(queue_type::steal_size(100ul, 4ul, 16ul), 16ul);
+}
+
+BOOST_AUTO_TEST_CASE( start_and_split )
+{
+  queue_type queue(1, 3, 2);
+  for(int i = 0; i < 9; ++i)
+    queue.push(i);
+
+  // One window is started and the next window is prefetched
+  std::vector<int> start, prefetch;
+  BOOST_CHECK_EQUAL(queue.start(start, prefetch), -1);
+  BOOST_REQUIRE_EQUAL(start.size(), 2ul);
+  BOOST_CHECK_EQUAL(start[0], 0);
+  BOOST_CHECK_EQUAL(start[1], 1);
+  BOOST_REQUIRE_EQUAL(prefetch.size(), 2ul);
+  BOOST_CHECK_EQUAL(prefetch[0], 2);
+  BOOST_CHECK_EQUAL(prefetch[1], 3);
+  BOOST_CHECK_EQUAL(queue.running(), 2ul);
+
+  // A thief gets half of the items beyond a window from the back
+  std::vector<int> work;
+  queue.steal(0, work);
+  BOOST_REQUIRE_EQUAL(work.size(), 3ul);
+  BOOST_CHECK_EQUAL(work[0], 8);
+  BOOST_CHECK_EQUAL(work[2], 6);
+  BOOST_CHECK_EQUAL(queue.size(), 4ul);
+
+  // A finished item makes room for the next one, which was prefetched
+  queue.finish();
+  start.clear();
+  prefetch.clear();
+  BOOST_CHECK_EQUAL(queue.start(start, prefetch), -1);
+  BOOST_REQUIRE_EQUAL(start.size(), 1ul);
+  BOOST_CHECK_EQUAL(start[0], 2);
+  BOOST_REQUIRE_EQUAL(prefetch.size(), 1ul);
+  BOOST_CHECK_EQUAL(prefetch[0], 4);
+}
+
+BOOST_AUTO_TEST_CASE( refusals )
+{
+  queue_type queue(0, 3, 2);
+  std::vector<int> start, prefetch;
+  const std::vector<int> none;
+
+  // An empty queue asks the other processes in turn
+  BOOST_CHECK_EQUAL(queue.start(start, prefetch), 1);
+  BOOST_CHECK(queue.stealing());
+  BOOST_CHECK_EQUAL(queue.start(start, prefetch), -1); // One request at a time
+  queue.receive(none);
+  BOOST_CHECK_EQUAL(queue.start(start, prefetch), 2);
+  queue.receive(none);
+  BOOST_CHECK_EQUAL(queue.refusals(), 2);
+
+  // Every other process has refused, so no more requests are sent
+  BOOST_CHECK_EQUAL(queue.start(start, prefetch), -1);
+
+  // until a victim that refused has work
+  queue.woken(2);
+  BOOST_CHECK_EQUAL(queue.refusals(), 0);
+  BOOST_CHECK_EQUAL(queue.start(start, prefetch), 2);
+
+  // Received work is started, and the empty queue asks the next process
+  std::vector<int> work(1, 7);
+  queue.receive(work);
+  BOOST_CHECK_EQUAL(queue.start(start, prefetch), 1);
+  BOOST_REQUIRE_EQUAL(start.size(), 1ul);
+  BOOST_CHECK_EQUAL(start[0], 7);
+}
+
+BOOST_AUTO_TEST_CASE( wake )
 {
+  // A request that arrives before the victim has queued its work is refused
+  queue_type queue(1, 3, 2);
+  std::vector<int> work;
+  queue.steal(0, work);
+  queue.steal(2, work);
+  queue.steal(0, work);
+  BOOST_CHECK(work.empty());
+
+  // Refused thieves are not woken until there is work to hand over
+  std::vector<ProcessID> thieves;
+  queue.push(0);
+  queue.push(1);
+  queue.wake(thieves);
+  BOOST_CHECK(thieves.empty());
+
+  queue.push(2);
+  queue.wake(thieves);
+  BOOST_REQUIRE_EQUAL(thieves.size(), 2ul);
+  BOOST_CHECK_EQUAL(thieves[0], 0);
+  BOOST_CHECK_EQUAL(thieves[1], 2);
+
+  // Each thief is woken once
+  thieves.clear();
+  queue.wake(thieves);
+  BOOST_CHECK(thieves.empty());
 }
 
+BOOST_AUTO_TEST_CASE( dense_result )
+{
+  check_contraction(a);
+}
+
+BOOST_AUTO_TEST_CASE( sparse_result )
+{
+  ArrayN b(world, tr, list.begin(), list.end());
+  for(std::vector<std::size_t>::const_iterator it = list.begin(); it != list.end(); ++it)
+    if(b.is_local(*it))
+      b.set(*it, world.rank() + int(*it) + 1);
+  world.gop.fence();
+
+  check_contraction(b);
+}
 
 BOOST_AUTO_TEST_SUITE_END()